@@ -0,0 +1,161 @@
+/* Copyright (c) 2019 Emily McDonough
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "mmu/mmu.h"
+#include "cpu/cpu.h"
+#include "gpu/gfx.h"
+#include "gpu/gpu.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Throughput benchmark.
+ * Runs a rom for a fixed number of emulated frames as fast as possible, and
+ * reports how fast the core went. Build this with BACKEND=headless, otherwise
+ * we are also benchmarking the window system.
+ * -j picks the JIT mode, which is off unless this says otherwise. It is one of
+ * off, on or check.
+ * In a GG_PROFILE build, -p writes the profile afterwards. It is JSON if the
+ * path ends in .json, and CSV otherwise.
+ */
+#if (defined _WIN32) || (defined WIN32) || (defined __CYGWIN__)
+#include "bufferfile_win32.c"
+
+static double gg_bench_now(void){
+    LARGE_INTEGER freq, now;
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&now);
+    return (double)now.QuadPart / (double)freq.QuadPart;
+}
+
+#else
+/* The MMU maps the ROM straight out of the file where it can */
+#if (defined __unix) && (!defined GG_NO_MMAP)
+#include "bufferfile_mmap.c"
+#else
+#include "bufferfile_unix.c"
+#endif
+#include <time.h>
+
+static double gg_bench_now(void){
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + ((double)now.tv_nsec / 1000000000.0);
+}
+
+#endif
+
+/* Get alloca */
+#if (defined _MSC_VER) || (defined __WATCOMC__)
+#include <malloc.h>
+#elif (defined __TINYC__)
+#include <stddef.h>
+#else
+#include <alloca.h>
+#endif
+
+#define GG_BENCH_DEFAULT_FRAMES 600
+
+int main(int argc, char **argv){
+    GG_MMU *const mmu = GG_CreateMMU();
+    GG_CPU *const cpu = alloca(gg_cpu_struct_size);
+    GG_GPU *const gpu = alloca(gg_gpu_struct_size);
+    GG_Window *win;
+    const void *rom;
+    const char *profile_path = NULL;
+    unsigned jit_mode = GG_CPU_JIT_OFF;
+    int rom_size;
+    unsigned long frame, num_frames = GG_BENCH_DEFAULT_FRAMES;
+    double start, seconds;
+
+    while(argc >= 3 && argv[1][0] == '-'){
+        if(strcmp(argv[1], "-p") == 0){
+            profile_path = argv[2];
+        }
+        else if(strcmp(argv[1], "-j") == 0){
+            if(strcmp(argv[2], "off") == 0)
+                jit_mode = GG_CPU_JIT_OFF;
+            else if(strcmp(argv[2], "on") == 0)
+                jit_mode = GG_CPU_JIT_ON;
+            else if(strcmp(argv[2], "check") == 0)
+                jit_mode = GG_CPU_JIT_CHECK;
+            else{
+                printf("Invalid JIT mode %s\n", argv[2]);
+                return 1;
+            }
+        }
+        else{
+            break;
+        }
+        argv += 2;
+        argc -= 2;
+    }
+
+    if(argc < 2 || argc > 3){
+        puts("Usage: gg_bench [-p <profile>] [-j off|on|check] <rom>"
+            " [frames]");
+        return 1;
+    }
+
+    if(argc == 3 && (num_frames = strtoul(argv[2], NULL, 10)) == 0){
+        printf("Invalid number of frames %s\n", argv[2]);
+        return 1;
+    }
+
+    rom = BufferFile(argv[1], &rom_size);
+    if(rom == NULL){
+        printf("Could not open rom %s\n", argv[1]);
+        return 1;
+    }
+
+    GG_InitGraphics();
+    win = GG_CreateWindow();
+
+    GG_SetMMURom(mmu, rom, rom_size);
+    GG_CPU_Init(cpu, mmu);
+    GG_CPU_SetJIT(cpu, jit_mode);
+    GG_GPU_Init(gpu);
+
+    start = gg_bench_now();
+    for(frame = 0; frame < num_frames; frame++)
+        GG_CPU_RunFrame(cpu, mmu, gpu, win, NULL, NULL, NULL);
+    seconds = gg_bench_now() - start;
+
+    {
+        const double cycles = (double)GG_CPU_GetCycles(cpu);
+        const double instructions = (double)GG_CPU_GetInstructions(cpu);
+        const double frames = (double)num_frames;
+
+        printf("rom:            %s\n", argv[1]);
+        printf("frames:         %lu\n", num_frames);
+        printf("seconds:        %f\n", seconds);
+        printf("emulated MHz:   %f\n", cycles / seconds / 1000000.0);
+        printf("frames/s:       %f\n", frames / seconds);
+        printf("instructions/s: %f\n", instructions / seconds);
+        printf("ns/frame:       %f\n", seconds * 1000000000.0 / frames);
+        printf("idle skips:     %lu\n", GG_CPU_GetIdleSkips(cpu));
+        if(jit_mode == GG_CPU_JIT_CHECK)
+            printf("JIT mismatches: %lu\n", GG_CPU_GetJITMismatches(cpu));
+    }
+
+    if(profile_path != NULL){
+        const size_t length = strlen(profile_path);
+        const unsigned format = (length >= 5 &&
+            strcmp(profile_path + length - 5, ".json") == 0) ?
+            GG_CPU_PROFILE_JSON : GG_CPU_PROFILE_CSV;
+        if(GG_CPU_WriteProfile(cpu, mmu, profile_path, format) != 0)
+            printf("Could not write profile %s\n", profile_path);
+    }
+
+    GG_DestroyWindow(win);
+    GG_DestroyMMU(mmu);
+    GG_CPU_Fini(cpu);
+    GG_GPU_Fini(gpu);
+    FreeBufferFile(rom, rom_size);
+    return 0;
+}
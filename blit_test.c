@@ -0,0 +1,93 @@
+/* Copyright (c) 2019 Emily McDonough
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "gpu/blit.h"
+#include "test_random.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Checks every scanline path against GG_BlitScanlineScalar.
+ * Each path draws lines of random colors with random palettes, and the whole
+ * screen has to come out the same as the scalar version. Paths that are not
+ * built in or that the CPU does not have are skipped. Returns non-zero if any
+ * path got a pixel wrong.
+ */
+#define GG_BLIT_TEST_LINES 20000
+
+static const char *const gg_blit_test_names[] = {
+    "auto",
+    "scalar",
+    "sse2",
+    "ssse3"
+};
+
+int main(int argc, char **argv){
+    GG_Screen *const expected = GG_CreateScreen();
+    GG_Screen *const actual = GG_CreateScreen();
+    unsigned char colors[160];
+    unsigned short palette[4];
+    unsigned path, failed = 0;
+
+    (void)argc;
+    (void)argv;
+
+    if(expected == NULL || actual == NULL){
+        puts("Could not create the screens");
+        return 1;
+    }
+
+    for(path = GG_BLIT_PATH_AUTO; path <= GG_BLIT_PATH_SSSE3; path++){
+        unsigned line, mismatches = 0;
+
+        if(GG_SetBlitPath(path) != 0){
+            printf("%-8s skipped\n", gg_blit_test_names[path]);
+            continue;
+        }
+
+        memset(expected->pixels, 0, sizeof(expected->pixels));
+        memset(actual->pixels, 0, sizeof(actual->pixels));
+
+        for(line = 0; line < GG_BLIT_TEST_LINES; line++){
+            const unsigned y = gg_test_random() % 144;
+            unsigned i;
+
+            /* The high bits of the colors must be ignored */
+            for(i = 0; i < 160; i++)
+                colors[i] = (unsigned char)gg_test_random();
+            for(i = 0; i < 4; i++)
+                palette[i] = (unsigned short)gg_test_random();
+
+            GG_BlitScanlineScalar(expected, colors, palette, y);
+            GG_BlitScanline(actual, colors, palette, y);
+
+            if(memcmp(expected->pixels, actual->pixels,
+                sizeof(expected->pixels)) != 0){
+                if(mismatches++ == 0)
+                    printf("%-8s first mismatch on line %u, y %u\n",
+                        gg_blit_test_names[path], line, y);
+                memcpy(actual->pixels, expected->pixels,
+                    sizeof(actual->pixels));
+            }
+        }
+
+        if(mismatches != 0){
+            printf("%-8s FAILED %u of %u lines\n",
+                gg_blit_test_names[path], mismatches, GG_BLIT_TEST_LINES);
+            failed = 1;
+        }
+        else{
+            printf("%-8s ok\n", gg_blit_test_names[path]);
+        }
+    }
+
+    GG_SetBlitPath(GG_BLIT_PATH_AUTO);
+    GG_DestroyScreen(expected);
+    GG_DestroyScreen(actual);
+    return (int)failed;
+}
@@ -10,6 +10,15 @@
 #include <sys/mman.h>
 #include <assert.h>
 
+/* The MMU reads the ROM straight out of this mapping, so it is shared with
+ * the page cache and any other process running the same file.
+ */
+#ifdef MAP_POPULATE
+#define GG_BUFFERFILE_MAP_FLAGS (MAP_SHARED|MAP_POPULATE)
+#else
+#define GG_BUFFERFILE_MAP_FLAGS MAP_SHARED
+#endif
+
 const void *BufferFile(const char *file, int *size){
     if(!file || !size){
         return NULL;
@@ -17,23 +26,35 @@ const void *BufferFile(const char *file, int *size){
     else{
         const int fd = open(file, O_RDONLY);
         struct stat lstat;
+        void *data;
 
         if(fd < 0){
             return NULL;
         }
 
-        fstat(fd, &lstat);
-        {
-            void *const data =
-                mmap(NULL, lstat.st_size, PROT_READ, MAP_SHARED, fd, 0);
-            if(data!=MAP_FAILED){
-                size[0] = lstat.st_size;
-                return data;
-            }
-            else{
-                return NULL;
-            }
+        if(fstat(fd, &lstat) != 0 || lstat.st_size == 0){
+            close(fd);
+            return NULL;
         }
+
+        data = mmap(NULL,
+            lstat.st_size,
+            PROT_READ,
+            GG_BUFFERFILE_MAP_FLAGS,
+            fd, 0);
+        /* The mapping keeps the file open */
+        close(fd);
+
+        if(data == MAP_FAILED){
+            return NULL;
+        }
+
+#ifndef MAP_POPULATE
+        /* Bank switches jump all over the file, so read it all in now */
+        madvise(data, lstat.st_size, MADV_WILLNEED);
+#endif
+        size[0] = lstat.st_size;
+        return data;
     }
 }
 
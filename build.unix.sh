@@ -0,0 +1,6 @@
+#!/bin/sh
+
+# Any copyright is dedicated to the Public Domain.
+# http://creativecommons.org/publicdomain/zero/1.0/
+
+make BACKEND=headless GFXLIBRARY="" ARCH=amd64 PLATFORM=elf64 DELETE=rm COMPILER=cc COMPILERFLAGS="-c -Immu -Icpu -Igpu -Idbg_core -Idbg_ui -D_DEFAULT_SOURCE -O2 -Wall -Wextra -pedantic -g -ansi" COMPILEOUT="-o " LINKER=cc LINKFLAGS="-g" LINKOUT="-o " EXE= SO=.so OBJ=.o LIB=.a $*
@@ -6,6 +6,8 @@
  */
 
 #include "cpu.h"
+#include "cpu_defs.h"
+#include "cpu_block.h"
 
 #include "mmu.h"
 #include "gpu.h"
@@ -17,50 +19,12 @@
 #endif
 
 #include <assert.h>
+#include <stdlib.h>
+#include <string.h>
 
 /* Dummy out the meta */
 #include "cpu_dummy_meta.h"
 
-#define GG_REGISTER(X, Y) \
-    union { \
-        unsigned short X ## Y ; \
-        unsigned short reg; \
-        unsigned char array[2]; \
-        struct { unsigned short X ## Y ; } reg16; \
-        struct { unsigned char Y; unsigned char X; } reg8; \
-    } X ## Y
-
-#if (__STDC_VERSION__ >= 201112L)
-
-typedef _Bool gg_bool_t;
-#define GG_TRUE true
-#define GG_FALSE false
-
-#elif defined __cplusplus
-
-typedef bool gg_bool_t;
-#define GG_TRUE true
-#define GG_FALSE false
-
-#else
-
-typedef char gg_bool_t;
-#define GG_TRUE 1
-#define GG_FALSE 0
-
-#endif
-
-struct GG_CPU_s{
-    GG_REGISTER(A, F);
-    GG_REGISTER(B, C);
-    GG_REGISTER(D, E);
-    GG_REGISTER(H, L);
-    unsigned short SP;
-    unsigned short IP;
-    unsigned short M;
-    gg_bool_t interrupts_enabled;
-};
-
 #define GG_AF(CPU) ((CPU)->AF.reg)
 #define GG_A(CPU)  ((CPU)->AF.reg8.A)
 #define GG_F(CPU)  ((CPU)->AF.reg8.F)
@@ -91,6 +55,22 @@ void GG_CPU_Set ## R(struct GG_CPU_s *cpu, unsigned val){ \
 
 GG_ALL_REGISTERS( GG_REGISTER_ACCESS )
 
+GG_CPU_FUNC(unsigned long) GG_CPU_GetCycles(const GG_CPU *cpu){
+    return (unsigned long)cpu->sched.now;
+}
+
+GG_CPU_FUNC(unsigned long) GG_CPU_GetInstructions(const GG_CPU *cpu){
+    return cpu->instructions;
+}
+
+GG_CPU_FUNC(unsigned long) GG_CPU_GetIdleSkips(const GG_CPU *cpu){
+    return cpu->idle_skips;
+}
+
+GG_CPU_FUNC(unsigned long) GG_CPU_GetJITMismatches(const GG_CPU *cpu){
+    return cpu->jit_mismatches;
+}
+
 
 /* Creates the "TMP" 8-bit register for local use by our pseudo-op file */
 #define GG_TMP8( N ) \
@@ -128,10 +108,58 @@ const unsigned gg_cpu_struct_size = sizeof(struct GG_CPU_s);
 #define DEBUG_ONLY(X) X
 #endif
 
+/* The interpreter notes where each op started, and counts it at the end */
+#ifdef GG_PROFILE
+#define GG_CPU_PROFILE_LOCALS() \
+    unsigned profile_address = 0, profile_op = 0, profile_m = 0;
+#define GG_CPU_PROFILE_OP(N) \
+    profile_address = (ip - 1) & 0xFFFF; \
+    profile_op = (N); \
+    profile_m = m;
+#define GG_CPU_PROFILE_CB_OP(N) \
+    profile_op = GG_CPU_PROFILE_CB(N);
+#define GG_CPU_PROFILE_END() \
+    gg_cpu_profile_add(cpu->profile, \
+        GG_CPU_BLOCK_BANK(mmu, profile_address), \
+        profile_address, \
+        profile_op, \
+        m - profile_m);
+#else
+#define GG_CPU_PROFILE_LOCALS()
+#define GG_CPU_PROFILE_OP(N)
+#define GG_CPU_PROFILE_CB_OP(N)
+#define GG_CPU_PROFILE_END()
+#endif
+
+/* Threaded dispatch, using the labels-as-values extension. Every opcode
+ * fetches and jumps to the next opcode itself instead of going back through
+ * one switch, which gives the branch predictor one indirect jump per opcode.
+ * The switch is still used for any other compiler.
+ */
+#if (defined __GNUC__) && (!defined GG_NO_THREADED_DISPATCH)
+#define GG_CPU_THREADED_DISPATCH
+#endif
+
 /* Macros to turn the cpu.inc into C code */
 
+#ifdef GG_CPU_THREADED_DISPATCH
+
+#define GG_OPCODE(N, BYTES, CYCLES) gg_cpu_op_ ## N: \
+    DEBUG_ONLY(debug_op = N); \
+    GG_CPU_PROFILE_OP(N) \
+    m += (CYCLES); \
+    {
+
+#define GG_END_OPCODE(N) \
+    } \
+    assert(debug_op == N); \
+    GG_CPU_NEXT();
+
+#else
+
 #define GG_OPCODE(N, BYTES, CYCLES) case N: \
     DEBUG_ONLY(debug_op = N); \
+    GG_CPU_PROFILE_OP(N) \
     m += (CYCLES); \
     {
 
@@ -140,91 +168,340 @@ const unsigned gg_cpu_struct_size = sizeof(struct GG_CPU_s);
     assert(debug_op == N); \
     break;
 
+#endif
+
 /* Macros for the instructions. */
 
+/* Immediate operands. The block runner replaces these with the operands it
+ * already decoded.
+ */
+#define GG_CPU_IMM8() GG_READ8MMU(mmu, ip)
+#define GG_CPU_IMM16() GG_READ16MMU(mmu, ip)
+
+/* Any write the CPU makes might be to code that is in the block cache. Writes
+ * to the ROM go to the mapper, which might swap out cartridge RAM with code in
+ * it.
+ */
+#ifdef GG_NO_BLOCK_CACHE
+#define GG_CPU_CHECK_CODE(ADDR)
+#else
+#define GG_CPU_CHECK_CODE(ADDR) do{ \
+        if(blocks != NULL){ \
+            if(GG_CPU_BLOCK_IS_CODE(blocks, (ADDR))) { \
+                GG_CPU_CODE_WRITTEN((ADDR)); \
+            } \
+            else if((ADDR) < 0x8000){ \
+                GG_CPU_CART_REMAPPED(); \
+            } \
+        } \
+    }while(0)
+#endif
+
+#define GG_CPU_CODE_WRITTEN(ADDR) \
+    gg_cpu_block_invalidate(blocks, (ADDR));
+
+#define GG_CPU_CART_REMAPPED() \
+    gg_cpu_block_invalidate_cart_ram(blocks);
+
+/* Writing IF (FF0F) or IE (FFFF) can make an interrupt pending, so the CPU
+ * stops after the current op to check. This also catches FF1F, FF2F and so on,
+ * which only costs a quick trip through the event loop.
+ */
+#define GG_CPU_CHECK_INTERRUPT_WRITE(ADDR) do{ \
+        if(((ADDR) & 0xFF0F) == 0xFF0F) \
+            limit = m; \
+    }while(0)
+
+/* The time the current op finishes. The block runner replaces this, since it
+ * counts the cycles for the whole block first.
+ */
+#define GG_CPU_NOW() (start + m)
+
+/* MMIO registers with handlers can catch up to the current time, so the time
+ * is stored for them first. The CPU also stops after the current op, since a
+ * handler can request an interrupt or move an event, and an idle loop that
+ * watches such a register can't be skipped. Plain registers like LY are left
+ * alone so that polling them can still be skipped.
+ */
+#define GG_CPU_IS_HANDLED_IO(ADDR) \
+    (((ADDR) & 0xFF80) == 0xFF00 && GG_HasMMUIOHandler(mmu, (ADDR)))
+
+#define GG_CPU_IO_ACCESS(ADDR) do{ \
+        if(GG_CPU_IS_HANDLED_IO(ADDR)){ \
+            cpu->io_time = GG_CPU_NOW(); \
+            limit = m; \
+        } \
+    }while(0)
+
+#define GG_CPU_READ8(ADDR) \
+    (GG_CPU_IS_HANDLED_IO(ADDR) ? \
+        (cpu->io_time = GG_CPU_NOW(), limit = m, GG_Read8MMU(mmu, (ADDR))) : \
+        GG_READ8MMU(mmu, (ADDR)))
+
+#define GG_CPU_WRITE8(ADDR, VAL) do{ \
+        const unsigned GG_addr = (ADDR); \
+        GG_CPU_IO_ACCESS(GG_addr); \
+        GG_WRITE8MMU(mmu, GG_addr, (VAL)); \
+        GG_CPU_CHECK_CODE(GG_addr); \
+        GG_CPU_CHECK_INTERRUPT_WRITE(GG_addr); \
+    }while(0)
+
+#define GG_CPU_WRITE16(ADDR, VAL) do{ \
+        const unsigned GG_addr = (ADDR); \
+        GG_CPU_IO_ACCESS(GG_addr); \
+        GG_CPU_IO_ACCESS(GG_addr + 1); \
+        GG_WRITE16MMU(mmu, GG_addr, (VAL)); \
+        GG_CPU_CHECK_CODE(GG_addr); \
+        GG_CPU_CHECK_CODE(GG_addr + 1); \
+        GG_CPU_CHECK_INTERRUPT_WRITE(GG_addr); \
+        GG_CPU_CHECK_INTERRUPT_WRITE(GG_addr + 1); \
+    }while(0)
+
 #define GG_NOP()
 
-/* TODO! */
-#define GG_STOP()
-#define GG_HALT()
-#define GG_PREFIX_CB() \
-    m += 8; \
-    gg_prefix_cb(cpu, mmu, GG_Read8MMU(mmu, ip++));
+/* Halting stops at the end of the opcode to run events, and then the CPU
+ * skips ahead from one event to the next until an interrupt is pending. STOP
+ * waits for the joypad, which there is no way to press, so it is the same as
+ * HALT.
+ */
+#define GG_HALT() \
+    cpu->halted = GG_TRUE; \
+    limit = m;
+
+#define GG_STOP() GG_HALT()
 
 /* TODO: Some of these are actually BCD opcodes */
 #define GG_ILLEGAL( N ) assert(debug_op == N); assert( 0 && "Illegal instruction!" );
 
-/* TODO! */
+/* Interrupts are only checked between ops when the CPU stops for events, so
+ * anything that could let one through sets the limit to stop after this op.
+ * RETI enables them right away, EI only after the op that follows it.
+ */
 #define GG_ENABLE_INTERRUPTS( ) \
-    cpu->interrupts_enabled = GG_TRUE;
+    cpu->interrupts_enabled = GG_TRUE; \
+    limit = m;
+
+#define GG_ENABLE_INTERRUPTS_DELAYED( ) \
+    if(!cpu->interrupts_enabled){ \
+        cpu->ei_delay = GG_TRUE; \
+        limit = m; \
+    }
 
 #define GG_DISABLE_INTERRUPTS( ) \
-    cpu->interrupts_enabled = GG_FALSE;
+    cpu->interrupts_enabled = GG_FALSE; \
+    cpu->ei_delay = GG_FALSE;
+
+/* Lazy flags.
+ * Most flags are overwritten before anything reads them, so F isn't kept
+ * while running. Instead Z is kept as the last result (Z is set if it is 0),
+ * N as its own byte, and H and C as the carries into bits 4 and 8 of the last
+ * result. For an 8-bit add or subtract the carries are just the XOR of the
+ * operands and the result, so the flags cost a few stores instead of a few
+ * compares and branches. F is only put together when something reads it.
+ *
+ * This state only lives in the run loops. Storing the registers back to the
+ * GG_CPU always writes the real F, so the debugger and the JIT never see it.
+ *
+ * Define GG_NO_LAZY_FLAGS to keep F up to date instead.
+ */
+#ifndef GG_NO_LAZY_FLAGS
+
+#define GG_LAZY_FLAGS_STATE() \
+    unsigned short flag_carries = 0; \
+    unsigned char flag_result = 1, flag_operation = 0
+
+/* Z from the low byte of RESULT, H and C from CARRIES */
+#define GG_ARITH_FLAGS( RESULT, CARRIES, N ) \
+    flag_result = (unsigned char)(RESULT); \
+    flag_carries = (CARRIES); \
+    flag_operation = (N);
+
+/* Same as GG_ARITH_FLAGS, but C is kept */
+#define GG_STEP_FLAGS( RESULT, CARRIES, N ) \
+    flag_result = (unsigned char)(RESULT); \
+    flag_carries = ((CARRIES) & 0x10) | (flag_carries & 0x100); \
+    flag_operation = (N);
+
+/* H and C from CARRIES, Z is kept */
+#define GG_CARRY_FLAGS( CARRIES, N ) \
+    flag_carries = (CARRIES); \
+    flag_operation = (N);
+
+/* Overwrites every flag */
+#define GG_SET_F( VALUE ) \
+    { \
+        const unsigned char GG_f = (VALUE); \
+        GG_LOAD_FLAGS_FROM( GG_f ); \
+    }
+
+#define GG_LOAD_FLAGS_FROM( F ) \
+    flag_result = ((F) & GG_ZERO_FLAG) ? 0 : 1; \
+    flag_operation = (F) & GG_OPERATION_FLAG; \
+    flag_carries = (((F) & GG_HALF_CARRY_FLAG) >> 1) | \
+        (((F) & GG_CARRY_FLAG) << 4)
+
+#define GG_FLAGS() \
+    ((flag_result == 0 ? GG_ZERO_FLAG : 0) | \
+    flag_operation | \
+    ((flag_carries & 0x10) << 1) | \
+    ((flag_carries >> 4) & GG_CARRY_FLAG))
+
+/* Writes the flags to F */
+#define GG_SYNC_FLAGS() \
+    GG_F( cpu ) = GG_FLAGS()
+
+/* Reads the flags from F */
+#define GG_LOAD_FLAGS() \
+    GG_LOAD_FLAGS_FROM( GG_F( cpu ) )
+
+#define GG_FLAG_ZERO() (flag_result == 0)
+#define GG_FLAG_OPERATION() (flag_operation)
+#define GG_FLAG_HALF_CARRY() (flag_carries & 0x10)
+#define GG_FLAG_CARRY() (flag_carries & 0x100)
+
+#define GG_SET_FLAG_ZERO() flag_result = 0;
+#define GG_SET_FLAG_OPERATION() flag_operation = GG_OPERATION_FLAG;
+#define GG_SET_FLAG_HALF_CARRY() flag_carries |= 0x10;
+#define GG_SET_FLAG_CARRY() flag_carries |= 0x100;
+
+#define GG_CLEAR_FLAG_ZERO() flag_result = 1;
+#define GG_CLEAR_FLAG_OPERATION() flag_operation = 0;
+#define GG_CLEAR_FLAG_HALF_CARRY() flag_carries &= ~0x10;
+#define GG_CLEAR_FLAG_CARRY() flag_carries &= ~0x100;
+
+#else
+
+#define GG_LAZY_FLAGS_STATE() \
+    const char flag_unused = 0
+
+/* Makes H and C from the carries into bits 4 and 8 */
+#define GG_CARRIES_TO_FLAGS( CARRIES ) \
+    ((((CARRIES) & 0x10) << 1) | (((CARRIES) >> 4) & GG_CARRY_FLAG))
+
+#define GG_ARITH_FLAGS( RESULT, CARRIES, N ) \
+    GG_F( cpu ) = ((((RESULT) & 0xFF) == 0) ? GG_ZERO_FLAG : 0) | \
+        (N) | \
+        GG_CARRIES_TO_FLAGS( CARRIES );
+
+#define GG_STEP_FLAGS( RESULT, CARRIES, N ) \
+    GG_F( cpu ) = ((((RESULT) & 0xFF) == 0) ? GG_ZERO_FLAG : 0) | \
+        (N) | \
+        (((CARRIES) & 0x10) << 1) | \
+        (GG_F( cpu ) & GG_CARRY_FLAG);
+
+#define GG_CARRY_FLAGS( CARRIES, N ) \
+    GG_F( cpu ) = (GG_F( cpu ) & GG_ZERO_FLAG) | \
+        (N) | \
+        GG_CARRIES_TO_FLAGS( CARRIES );
+
+#define GG_SET_F( VALUE ) \
+    GG_F( cpu ) = (VALUE);
+
+#define GG_SYNC_FLAGS() (void)flag_unused
+
+/* The low bits of F don't exist, the lazy flags drop them too */
+#define GG_LOAD_FLAGS() GG_F( cpu ) &= 0xF0
+
+#define GG_FLAG_ZERO() (GG_F( cpu ) & GG_ZERO_FLAG)
+#define GG_FLAG_OPERATION() (GG_F( cpu ) & GG_OPERATION_FLAG)
+#define GG_FLAG_HALF_CARRY() (GG_F( cpu ) & GG_HALF_CARRY_FLAG)
+#define GG_FLAG_CARRY() (GG_F( cpu ) & GG_CARRY_FLAG)
+
+#define GG_SET_FLAG_ZERO() GG_F( cpu ) |= GG_ZERO_FLAG;
+#define GG_SET_FLAG_OPERATION() GG_F( cpu ) |= GG_OPERATION_FLAG;
+#define GG_SET_FLAG_HALF_CARRY() GG_F( cpu ) |= GG_HALF_CARRY_FLAG;
+#define GG_SET_FLAG_CARRY() GG_F( cpu ) |= GG_CARRY_FLAG;
+
+#define GG_CLEAR_FLAG_ZERO() GG_F( cpu ) &= ~GG_ZERO_FLAG;
+#define GG_CLEAR_FLAG_OPERATION() GG_F( cpu ) &= ~GG_OPERATION_FLAG;
+#define GG_CLEAR_FLAG_HALF_CARRY() GG_F( cpu ) &= ~GG_HALF_CARRY_FLAG;
+#define GG_CLEAR_FLAG_CARRY() GG_F( cpu ) &= ~GG_CARRY_FLAG;
+
+#endif
+
+/* Non-zero if a flag is set */
+#define GG_GET_FLAG( FLAG_NAME ) \
+    GG_FLAG_ ## FLAG_NAME ()
+
+/* PUSH AF and POP AF are the only 16-bit ops which see F */
+#define GG_FLAGS_READ_AF() GG_SYNC_FLAGS();
+#define GG_FLAGS_READ_BC()
+#define GG_FLAGS_READ_DE()
+#define GG_FLAGS_READ_HL()
+#define GG_FLAGS_READ_IP()
+#define GG_FLAGS_WRITTEN_AF() GG_LOAD_FLAGS();
+#define GG_FLAGS_WRITTEN_BC()
+#define GG_FLAGS_WRITTEN_DE()
+#define GG_FLAGS_WRITTEN_HL()
+#define GG_FLAGS_WRITTEN_IP()
+#define GG_FLAGS_WRITTEN_TMP0()
 
 /* Set a flag */
 #define GG_SET_FLAG( FLAG_NAME ) \
-    GG_F( cpu ) |= GG_ ## FLAG_NAME ## _FLAG;
+    GG_SET_FLAG_ ## FLAG_NAME ()
 
 /* Set two flags */
 #define GG_SET_FLAG2( FLAG_NAME1, FLAG_NAME2 ) \
-    GG_F( cpu ) |= (GG_ ## FLAG_NAME1 ## _FLAG | GG_ ## FLAG_NAME2 ## _FLAG);
+    GG_SET_FLAG_ ## FLAG_NAME1 () \
+    GG_SET_FLAG_ ## FLAG_NAME2 ()
 
 /* Set three flags */
 #define GG_SET_FLAG3( FLAG_NAME1, FLAG_NAME2, FLAG_NAME3 ) \
-    GG_F( cpu ) |= (GG_ ## FLAG_NAME1 ## _FLAG | \
-        GG_ ## FLAG_NAME2 ## _FLAG | \
-        GG_ ## FLAG_NAME3 ## _FLAG);
+    GG_SET_FLAG_ ## FLAG_NAME1 () \
+    GG_SET_FLAG_ ## FLAG_NAME2 () \
+    GG_SET_FLAG_ ## FLAG_NAME3 ()
 
 /* Clear a flag */
 #define GG_CLEAR_FLAG( FLAG_NAME ) \
-    GG_F( cpu ) &= ~(GG_ ## FLAG_NAME ## _FLAG);
+    GG_CLEAR_FLAG_ ## FLAG_NAME ()
 
 /* Clear two flags */
 #define GG_CLEAR_FLAG2( FLAG_NAME1, FLAG_NAME2 ) \
-    GG_F( cpu ) &= ~(GG_ ## FLAG_NAME1 ## _FLAG | GG_ ## FLAG_NAME2 ## _FLAG);
+    GG_CLEAR_FLAG_ ## FLAG_NAME1 () \
+    GG_CLEAR_FLAG_ ## FLAG_NAME2 ()
 
 /* Clear three flags */
 #define GG_CLEAR_FLAG3( FLAG_NAME1, FLAG_NAME2, FLAG_NAME3 ) \
-    GG_F( cpu ) &= ~(GG_ ## FLAG_NAME1 ## _FLAG | \
-        GG_ ## FLAG_NAME2 ## _FLAG | \
-        GG_ ## FLAG_NAME3 ## _FLAG);
+    GG_CLEAR_FLAG_ ## FLAG_NAME1 () \
+    GG_CLEAR_FLAG_ ## FLAG_NAME2 () \
+    GG_CLEAR_FLAG_ ## FLAG_NAME3 ()
 
 /* Load 16-bit immediate into register */
 #define GG_LD_IMM16( REG16 ) \
-        GG_ ## REG16(cpu) = GG_Read16MMU(mmu, ip); \
+        GG_ ## REG16(cpu) = GG_CPU_IMM16(); \
         ip += 2;
 
 /* Load 8-bit immediate into register */
 #define GG_LD_IMM8( REG8 ) \
-        GG_ ## REG8(cpu) = GG_Read8MMU(mmu, ip); \
+        GG_ ## REG8(cpu) = GG_CPU_IMM8(); \
         ++ip;
 
 /* Load from register into pointer register */
 #define GG_LD_REGPTR_REG8( REGPTR, REG8 ) \
-    GG_Write8MMU( mmu, GG_ ## REGPTR( cpu ), GG_ ## REG8( cpu ) );
+    GG_CPU_WRITE8( GG_ ## REGPTR( cpu ), GG_ ## REG8( cpu ) );
 
 /* Load from pointer register into register */
 #define GG_LD_REG8_REGPTR( REG8, REGPTR ) \
-    GG_ ## REG8( cpu ) = GG_Read8MMU( mmu, GG_ ## REGPTR( cpu ) );
+    GG_ ## REG8( cpu ) = GG_CPU_READ8( GG_ ## REGPTR( cpu ) );
 
 /* Load from register into pointer register */
 #define GG_LD_REGPTR_REG16( REGPTR, REG16 ) \
-    GG_Write16MMU( mmu, GG_ ## REGPTR( cpu ), GG_ ## REG16( cpu ) );
+    GG_CPU_WRITE16( GG_ ## REGPTR( cpu ), GG_ ## REG16( cpu ) );
 
 /* Load from pointer register into register */
 #define GG_LD_REG16_REGPTR( REG16, REGPTR ) \
-    GG_ ## REG16( cpu ) = GG_Read16MMU( mmu, GG_ ## REGPTR( cpu ) );
+    GG_ ## REG16( cpu ) = GG_READ16MMU( mmu, GG_ ## REGPTR( cpu ) );
 
 #define GG_LDH_REG8PTR_REG8( REG8PTR, REG8 ) \
     { \
         unsigned short addr = GG_ ## REG8PTR( cpu ); \
-        GG_Write8MMU( mmu, addr | 0xFF00, GG_ ## REG8( cpu ) ); \
+        GG_CPU_WRITE8( addr | 0xFF00, GG_ ## REG8( cpu ) ); \
     }
 
 #define GG_LDH_REG8_REG8PTR( REG8, REG8PTR ) \
     { \
         unsigned short addr = GG_ ## REG8PTR( cpu ); \
-        GG_ ## REG8( cpu ) = GG_Read8MMU( mmu, addr | 0xFF00 ); \
+        GG_ ## REG8( cpu ) = GG_CPU_READ8( addr | 0xFF00 ); \
     }
 
 /* Load from pointer register into register */
@@ -242,36 +519,24 @@ const unsigned gg_cpu_struct_size = sizeof(struct GG_CPU_s);
 /* Complement 8-bit register */
 #define GG_CPL_REG8( REG8 ) \
     GG_ ## REG8( cpu ) ^= 0xFF; \
-    GG_F( cpu ) |= GG_OPERATION_FLAG|GG_HALF_CARRY_FLAG;
+    GG_SET_FLAG2( OPERATION, HALF_CARRY )
 
-/* Increment 8-bit register */
+/* Increment 8-bit register. C is kept. */
 #define GG_INC_REG8( REG8 ) \
     { \
         const unsigned char r8 = GG_ ## REG8( cpu ); \
-        unsigned char flags = GG_F( cpu ); \
-        flags &= ~(GG_ZERO_FLAG|GG_HALF_CARRY_FLAG|GG_OPERATION_FLAG); \
-        if((r8 & 0x0F) == 0x0F){ \
-            flags |= GG_HALF_CARRY_FLAG; \
-            if(r8 == 0xFF) \
-                flags |= GG_ZERO_FLAG; \
-        } \
-        GG_F( cpu ) = flags; \
-        GG_ ## REG8( cpu ) = r8 + 1; \
+        const unsigned char result = r8 + 1; \
+        GG_STEP_FLAGS( result, r8 ^ 1 ^ result, 0 ) \
+        GG_ ## REG8( cpu ) = result; \
     }
     
-/* Decrement 8-bit register */
+/* Decrement 8-bit register. C is kept. */
 #define GG_DEC_REG8( REG8 ) \
     { \
         const unsigned char r8 = GG_ ## REG8( cpu ); \
-        unsigned char flags = GG_F( cpu ); \
-        flags &= ~(GG_ZERO_FLAG|GG_HALF_CARRY_FLAG); \
-        if((r8 & 0x0F) == 0){ \
-            flags |= GG_HALF_CARRY_FLAG; \
-        } \
-        else if(r8 == 1) \
-            flags |= GG_ZERO_FLAG; \
-        GG_F( cpu ) = flags | GG_OPERATION_FLAG; \
-        GG_ ## REG8( cpu ) = r8 - 1; \
+        const unsigned char result = r8 - 1; \
+        GG_STEP_FLAGS( result, r8 ^ 1 ^ result, GG_OPERATION_FLAG ) \
+        GG_ ## REG8( cpu ) = result; \
     }
 
 /* Rotate left "with carry". This looks wrong, but it matches some docs... */
@@ -279,11 +544,11 @@ const unsigned gg_cpu_struct_size = sizeof(struct GG_CPU_s);
     { \
         const unsigned char c = GG_ ## REG8( cpu ); \
         if(c & 0x80){ \
-            GG_F( cpu ) = GG_CARRY_FLAG; \
+            GG_SET_F( GG_CARRY_FLAG ) \
             GG_ ## REG8( cpu ) = 1 | (c << 7); \
         } \
         else{ \
-            GG_F( cpu ) = 0; \
+            GG_SET_F( 0 ) \
             GG_ ## REG8( cpu ) = (c << 7); \
         } \
     }
@@ -293,11 +558,11 @@ const unsigned gg_cpu_struct_size = sizeof(struct GG_CPU_s);
     { \
         const unsigned char c = GG_ ## REG8( cpu ); \
         if(c & 1){ \
-            GG_F( cpu ) = GG_CARRY_FLAG; \
+            GG_SET_F( GG_CARRY_FLAG ) \
             GG_ ## REG8( cpu ) = 0x80 | (c >> 1); \
         } \
         else{ \
-            GG_F( cpu ) = 0; \
+            GG_SET_F( 0 ) \
             GG_ ## REG8( cpu ) = (c >> 1); \
         } \
     }
@@ -306,9 +571,9 @@ const unsigned gg_cpu_struct_size = sizeof(struct GG_CPU_s);
 #define GG_RL_REG8( REG8 ) \
     { \
         const unsigned char c = GG_ ## REG8( cpu ); \
-        const unsigned char f = GG_F( cpu ); \
-        GG_F( cpu ) = (c & 0x80) ? GG_CARRY_FLAG : 0;\
-        if(f & GG_CARRY_FLAG){ \
+        const gg_bool_t carry = GG_GET_FLAG( CARRY ) != 0; \
+        GG_SET_F( (c & 0x80) ? GG_CARRY_FLAG : 0 ) \
+        if(carry){ \
             GG_ ## REG8( cpu ) = 1 | (c << 7); \
         } \
         else{ \
@@ -320,9 +585,9 @@ const unsigned gg_cpu_struct_size = sizeof(struct GG_CPU_s);
 #define GG_RR_REG8( REG8 ) \
     { \
         const unsigned char c = GG_ ## REG8( cpu ); \
-        const unsigned char f = GG_F( cpu ); \
-        GG_F( cpu ) = (c & 1) ? GG_CARRY_FLAG : 0;\
-        if(f & GG_CARRY_FLAG){ \
+        const gg_bool_t carry = GG_GET_FLAG( CARRY ) != 0; \
+        GG_SET_F( (c & 1) ? GG_CARRY_FLAG : 0 ) \
+        if(carry){ \
             GG_ ## REG8( cpu ) = 0x80 | (c >> 1); \
         } \
         else{ \
@@ -330,25 +595,16 @@ const unsigned gg_cpu_struct_size = sizeof(struct GG_CPU_s);
         } \
     }
 
+/* Shifts overwrite every flag */
 #define GG_SHIFT_REG8_INNER( REG8, TYPE, CARRYMASK, SHIFTOP ) \
     { \
         TYPE c = GG_ ## REG8( cpu );\
-        register unsigned char f = GG_F( cpu ); \
-        if(c & CARRYMASK) { \
-            f |= GG_CARRY_FLAG; \
-        } \
-        else { \
-            f &= ~GG_CARRY_FLAG; \
-        } \
+        unsigned char f = (c & CARRYMASK) ? GG_CARRY_FLAG : 0; \
         c SHIFTOP 1;\
         if(c == 0) {\
             f |= GG_ZERO_FLAG; \
         } \
-        else { \
-            f &= ~GG_ZERO_FLAG; \
-        } \
-        f &= ~(GG_OPERATION_FLAG|GG_HALF_CARRY_FLAG);\
-        GG_F( cpu ) = f; \
+        GG_SET_F( f ) \
         GG_ ## REG8( cpu ) = c; \
     }
 
@@ -361,66 +617,68 @@ const unsigned gg_cpu_struct_size = sizeof(struct GG_CPU_s);
 #define GG_SRA_REG8( REG8 ) \
     { \
         unsigned char c = GG_ ## REG8( cpu );\
-        register unsigned char f = GG_F( cpu ); \
         c >>= 1;\
-        if(c == 0) {\
-            f |= GG_ZERO_FLAG; \
-        } \
-        else { \
-            f &= ~GG_ZERO_FLAG; \
-        } \
-        f &= ~(GG_OPERATION_FLAG|GG_HALF_CARRY_FLAG|GG_CARRY_FLAG);\
-        GG_F( cpu ) = f; \
+        GG_SET_F( (c == 0) ? GG_ZERO_FLAG : 0 ) \
         GG_ ## REG8( cpu ) = c; \
     }
 
 #define GG_SWAP_REG8( REG8 ) \
     { \
         const unsigned c = GG_ ## REG8( cpu ); \
-        if(c == 0) {\
-            unsigned char f = GG_F( cpu );\
-            f |= GG_ZERO_FLAG; \
-            f &= ~(GG_OPERATION_FLAG|GG_HALF_CARRY_FLAG|GG_CARRY_FLAG); \
-            GG_F( cpu ) = f; \
-        } \
-        else { \
-            GG_F( cpu ) &= ~(GG_OPERATION_FLAG| \
-                GG_HALF_CARRY_FLAG| \
-                GG_CARRY_FLAG| \
-                GG_ZERO_FLAG); \
-        } \
+        GG_SET_F( (c == 0) ? GG_ZERO_FLAG : 0 ) \
         GG_ ## REG8( cpu ) = (c >> 4) | (c << 4); \
     }
 
+/* Tests a bit. C is kept. */
+#define GG_BIT_REG8( BIT, REG8 ) \
+    if(GG_ ## REG8( cpu ) & (1 << (BIT))){ \
+        GG_CLEAR_FLAG( ZERO ) \
+    } \
+    else{ \
+        GG_SET_FLAG( ZERO ) \
+    } \
+    GG_CLEAR_FLAG( OPERATION ) \
+    GG_SET_FLAG( HALF_CARRY )
+
+/* Clears a bit */
+#define GG_RES_REG8( BIT, REG8 ) \
+    GG_ ## REG8( cpu ) &= ~(1 << (BIT));
+
+/* Sets a bit */
+#define GG_SET_REG8( BIT, REG8 ) \
+    GG_ ## REG8( cpu ) |= (1 << (BIT));
+
 /* Save stack pointer to immediate address */
 #define GG_SAVE_SP() \
-    const unsigned short imm = GG_Read16MMU(mmu, ip); \
+    const unsigned short imm = GG_CPU_IMM16(); \
     ip += 2; \
-    GG_Write16MMU(mmu, imm, GG_SP( cpu ));
+    GG_CPU_WRITE16(imm, GG_SP( cpu ));
 
 /* Start of a block which will execute if a flag is set */
 #define GG_BEGIN_IF_FLAG( FLAG_NAME ) \
-    if( (GG_F( cpu ) & (GG_ ## FLAG_NAME ## _FLAG)) ) {
+    if( GG_GET_FLAG( FLAG_NAME ) ) {
 
 /* End of a block which will execute if a flag is set */
 #define GG_END_IF_FLAG( FLAG_NAME ) }
 
 /* Start of a block which will execute if a flag is not set */
 #define GG_BEGIN_IF_NOT_FLAG( FLAG_NAME ) \
-    if( !(GG_F( cpu ) & (GG_ ## FLAG_NAME ## _FLAG)) ) {
+    if( !GG_GET_FLAG( FLAG_NAME ) ) {
 
 /* End of a block which will execute if a flag is not set */
 #define GG_END_IF_NOT_FLAG( FLAG_NAME ) }
 
 /* Pop 16-bit register from the stack */
 #define GG_POP_REG16( REG16 ) \
-    GG_ ## REG16( cpu ) = GG_Read16MMU(mmu, GG_SP( cpu )); \
+    GG_ ## REG16( cpu ) = GG_READ16MMU(mmu, GG_SP( cpu )); \
+    GG_FLAGS_WRITTEN_ ## REG16 () \
     GG_SP( cpu ) += 2;
 
 /* Push 16-bit register from the stack */
 #define GG_PUSH_REG16( REG16 ) \
+    GG_FLAGS_READ_ ## REG16 () \
     GG_SP( cpu ) -= 2; \
-    GG_Write16MMU(mmu, GG_SP( cpu ), GG_ ## REG16( cpu ));
+    GG_CPU_WRITE16(GG_SP( cpu ), GG_ ## REG16( cpu ));
 
 /* Jump to 16-bit register */
 #define GG_JMP_REG16( REG16 ) \
@@ -438,7 +696,7 @@ const unsigned gg_cpu_struct_size = sizeof(struct GG_CPU_s);
 /* Add a 8-bit register and the carry flag to another 8-bit register */
 #define GG_ADC_REG8_REG8( REG8_A, REG8_B) \
     { \
-        const unsigned char carry = (GG_F( cpu ) & GG_CARRY_FLAG) ? 1 : 0; \
+        const unsigned char carry = GG_GET_FLAG( CARRY ) ? 1 : 0; \
         GG_ADD_REG8_REG8_INNER( REG8_A, REG8_B, carry) \
     }
 
@@ -447,37 +705,20 @@ const unsigned gg_cpu_struct_size = sizeof(struct GG_CPU_s);
     { \
         const unsigned char a = GG_ ## REG8_A( cpu ); \
         const unsigned char b = GG_ ## REG8_B( cpu ); \
-        const unsigned short half_carry = (a & 0x0F) + (b & 0x0F) + (X); \
         const unsigned short result = a + b + (X); \
-        unsigned char flags = GG_F( cpu ) & ~(GG_OPERATION_FLAG); \
-        if( half_carry > 0x0F){ \
-            flags |= GG_HALF_CARRY_FLAG; \
-        } \
-        if( result > 0x00FF){ \
-            flags |= GG_CARRY_FLAG; \
-        } \
-        if(result == 0){ \
-            flags |= GG_ZERO_FLAG; \
-        } \
-        GG_F( cpu ) = flags; \
+        GG_ARITH_FLAGS( result, a ^ b ^ result, 0 ) \
         GG_ ## REG8_A( cpu ) = (unsigned char)result; \
     }
 
-/* Add a 16-bit register to another 16-bit register */
+/* Add a 16-bit register to another 16-bit register. Z is kept. */
 #define GG_ADD_REG16_REG16( REG16_A, REG16_B ) \
     { \
         const unsigned a = GG_ ## REG16_A( cpu ); \
         const unsigned b = GG_ ## REG16_B( cpu ); \
-        const unsigned short half_carry = (a & 0x0FFF) + (b & 0x0FFF); \
         const unsigned result = a + b; \
-        unsigned char flags = GG_F( cpu ) & ~(GG_OPERATION_FLAG); \
-        if( half_carry > 0x0FFF){ \
-            flags |= GG_HALF_CARRY_FLAG; \
-        } \
-        if( result > 0xFFFF){ \
-            flags |= GG_CARRY_FLAG; \
-        } \
-        GG_F( cpu ) = flags; \
+        /* Moves the carries into bits 12 and 16 down to 4 and 8 */ \
+        const unsigned carries = (a ^ b ^ result) >> 8; \
+        GG_CARRY_FLAGS( carries, 0 ) \
         GG_ ## REG16_A( cpu ) = (unsigned short)result; \
     }
 
@@ -488,7 +729,7 @@ const unsigned gg_cpu_struct_size = sizeof(struct GG_CPU_s);
 /* Subtract a 8-bit register and the carry flag to another 8-bit register */
 #define GG_SBC_REG8_REG8( REG8_A, REG8_B) \
     { \
-        const unsigned char carry = (GG_F( cpu ) & GG_CARRY_FLAG) ? 1 : 0; \
+        const unsigned char carry = GG_GET_FLAG( CARRY ) ? 1 : 0; \
         GG_SUB_REG8_REG8_INNER( REG8_A, REG8_B, carry) \
     }
 
@@ -497,37 +738,19 @@ const unsigned gg_cpu_struct_size = sizeof(struct GG_CPU_s);
     { \
         const unsigned char a = GG_ ## REG8_A( cpu ); \
         const unsigned char b = GG_ ## REG8_B( cpu ); \
-        const unsigned short half_carry = (a & 0x0F) - (b & 0x0F) - (X); \
         const unsigned short result = a - b - (X); \
-        unsigned char flags = GG_F( cpu ) & ~(GG_OPERATION_FLAG); \
-        if( half_carry > 0x0F){ \
-            flags |= GG_HALF_CARRY_FLAG; \
-        } \
-        if( result > 0x00FF){ \
-            flags |= GG_CARRY_FLAG; \
-        } \
-        if(result == 0){ \
-            flags |= GG_ZERO_FLAG; \
-        } \
-        GG_F( cpu ) = flags | GG_OPERATION_FLAG; \
+        GG_ARITH_FLAGS( result, a ^ b ^ result, GG_OPERATION_FLAG ) \
         GG_ ## REG8_A( cpu ) = (unsigned char)result; \
     }
 
-/* Subtract a 16-bit register to another 16-bit register */
+/* Subtract a 16-bit register to another 16-bit register. Z is kept. */
 #define GG_SUB_REG16_REG16( REG16_A, REG16_B ) \
     { \
         const unsigned a = GG_ ## REG16_A( cpu ); \
         const unsigned b = GG_ ## REG16_B( cpu ); \
-        const unsigned short half_carry = (a & 0x0FFF) - (b & 0x0FFF); \
         const unsigned result = a - b; \
-        unsigned char flags = GG_F( cpu ); \
-        if( half_carry > 0x0FFF){ \
-            flags |= GG_HALF_CARRY_FLAG; \
-        } \
-        if( result > 0xFFFF){ \
-            flags |= GG_CARRY_FLAG; \
-        } \
-        GG_F( cpu ) = flags | GG_OPERATION_FLAG; \
+        const unsigned carries = (a ^ b ^ result) >> 8; \
+        GG_CARRY_FLAGS( carries, GG_OPERATION_FLAG ) \
         GG_ ## REG16_A( cpu ) = (unsigned short)result; \
     }
 
@@ -537,49 +760,111 @@ const unsigned gg_cpu_struct_size = sizeof(struct GG_CPU_s);
 #define GG_BITOP_XOR ^=
 
 #define GG_BITOP( REG, OP ) \
-    if((GG_ ## REG( cpu ) GG_BITOP_ ## OP GG_ ## REG( cpu )) == 0) \
-        GG_F( cpu ) |= GG_ZERO_FLAG; \
-    else \
-        GG_F( cpu ) &= ~GG_ZERO_FLAG;
+    if((GG_ ## REG( cpu ) GG_BITOP_ ## OP GG_ ## REG( cpu )) == 0){ \
+        GG_SET_FLAG( ZERO ) \
+    } \
+    else{ \
+        GG_CLEAR_FLAG( ZERO ) \
+    }
 
 /* Relative jump */
 #define GG_JREL8( REG8 ) \
     ip += (signed char)GG_ ## REG8( cpu );
 
 /* BCD opcodes
- * These have simple implementations (sort of) on x86, since hilariously enough
- * the Intel 8080 heritage of both the z80 and the 8086 gives them equivalent
- * implementations.
+ * DAA is a lookup in a table indexed by A and the N, H, and C flags, which
+ * holds the whole new AF. The table is built by the preprocessor, so it is
+ * constant and there is nothing to fill in at runtime.
  */
-#if (defined __GNUC__ || defined __TINYC__) && (defined __i386 || defined _M_IX86)
+#define GG_CPU_DAA_INDEX(A, F) \
+    ((((F) & (GG_OPERATION_FLAG | GG_HALF_CARRY_FLAG | GG_CARRY_FLAG)) << 4) | (A))
+
+/* The flags in a table index, after GG_CPU_DAA_INDEX has shifted them */
+#define GG_CPU_DAA_N(I) ((I) & (GG_OPERATION_FLAG << 4))
+#define GG_CPU_DAA_H(I) ((I) & (GG_HALF_CARRY_FLAG << 4))
+#define GG_CPU_DAA_C(I) ((I) & (GG_CARRY_FLAG << 4))
+
+/* Subtractions undo the half carry and carry. Additions fix up any digit that
+ * carried or went past 9.
+ */
+#define GG_CPU_DAA_ADJUST(I) \
+    (GG_CPU_DAA_N(I) ? \
+        (0x100 - (GG_CPU_DAA_H(I) ? 0x06 : 0) - (GG_CPU_DAA_C(I) ? 0x60 : 0)) : \
+        (((GG_CPU_DAA_C(I) || ((I) & 0xFF) > 0x99) ? 0x60 : 0) + \
+            ((GG_CPU_DAA_H(I) || ((I) & 0x0F) > 0x09) ? 0x06 : 0)))
+
+#define GG_CPU_DAA_A(I) (((I) + GG_CPU_DAA_ADJUST(I)) & 0xFF)
+
+#define GG_CPU_DAA_FLAGS(I) \
+    ((GG_CPU_DAA_N(I) ? GG_OPERATION_FLAG : 0) | \
+    ((GG_CPU_DAA_C(I) || (!GG_CPU_DAA_N(I) && ((I) & 0xFF) > 0x99)) ? \
+        GG_CARRY_FLAG : 0) | \
+    ((GG_CPU_DAA_A(I) == 0) ? GG_ZERO_FLAG : 0))
+
+#define GG_CPU_DAA_ENTRY(I) ((GG_CPU_DAA_A(I) << 8) | GG_CPU_DAA_FLAGS(I))
+
+#define GG_CPU_DAA_4(I) \
+    GG_CPU_DAA_ENTRY(I), GG_CPU_DAA_ENTRY((I) + 1), \
+    GG_CPU_DAA_ENTRY((I) + 2), GG_CPU_DAA_ENTRY((I) + 3)
+#define GG_CPU_DAA_16(I) \
+    GG_CPU_DAA_4(I), GG_CPU_DAA_4((I) + 0x4), \
+    GG_CPU_DAA_4((I) + 0x8), GG_CPU_DAA_4((I) + 0xC)
+#define GG_CPU_DAA_64(I) \
+    GG_CPU_DAA_16(I), GG_CPU_DAA_16((I) + 0x10), \
+    GG_CPU_DAA_16((I) + 0x20), GG_CPU_DAA_16((I) + 0x30)
+#define GG_CPU_DAA_256(I) \
+    GG_CPU_DAA_64(I), GG_CPU_DAA_64((I) + 0x40), \
+    GG_CPU_DAA_64((I) + 0x80), GG_CPU_DAA_64((I) + 0xC0)
+
+const unsigned short gg_cpu_daa_table[0x800] = {
+    GG_CPU_DAA_256(0x000), GG_CPU_DAA_256(0x100),
+    GG_CPU_DAA_256(0x200), GG_CPU_DAA_256(0x300),
+    GG_CPU_DAA_256(0x400), GG_CPU_DAA_256(0x500),
+    GG_CPU_DAA_256(0x600), GG_CPU_DAA_256(0x700)
+};
 
 #define GG_DAA() \
-    { \
-        unsigned char flags = GG_F( cpu ); \
-        unsigned char in_flags = flags & GG_OPERATION_FLAG; \
-        __asm__ ( \
-            "movb %1, %%al \n" \
-            "btrw $0x05, %%ax \n" \
-            "rcr $0x04, %%al \n" \
-            "and $0xEE, %%al \n" \
-            "shl $0x08, %%ax \n" \
-            "sahf \n" \
-            "movb %0, %%al \n" \
-            "daa \n" \
-            "movb %%al, %0 \n" \
-            "setz %%ah \n" \
-            "setc %%al \n" \
-            "shl $0x04, %%al \n" \
-            "shr $0x04, %%ax \n" \
-            "movb %%al, %1 \n" \
-        : "+m"(GG_A( cpu )), "+r"(flags) \
-        : \
-        : "eax","cc" ); \
-        GG_F( cpu ) = flags | in_flags; \
-    }
-    
+    GG_SYNC_FLAGS(); \
+    GG_AF( cpu ) = gg_cpu_daa_table[GG_CPU_DAA_INDEX(GG_A( cpu ), GG_F( cpu ))]; \
+    GG_LOAD_FLAGS();
+
+/* The x86 DAA is equivalent for additions, since the Intel 8080 heritage of
+ * both the z80 and the 8086 gives them the same implementation. This is only
+ * used to check the table in debug builds.
+ */
+#ifndef NDEBUG
+#if (defined __GNUC__ || defined __TINYC__) && (defined __i386 || defined _M_IX86)
+
+#define GG_CPU_DAA_ASM
+
+static unsigned short gg_cpu_daa_asm(unsigned short af){
+    unsigned char a = (unsigned char)(af >> 8), flags = (unsigned char)af;
+    const unsigned char in_flags = flags & GG_OPERATION_FLAG;
+    __asm__ (
+        "movb %1, %%al \n"
+        "btrw $0x05, %%ax \n"
+        "rcr $0x04, %%al \n"
+        "and $0xEE, %%al \n"
+        "shl $0x08, %%ax \n"
+        "sahf \n"
+        "movb %0, %%al \n"
+        "daa \n"
+        "movb %%al, %0 \n"
+        "setz %%ah \n"
+        "setc %%al \n"
+        "shl $0x04, %%al \n"
+        "shr $0x04, %%ax \n"
+        "movb %%al, %1 \n"
+    : "+m"(a), "+r"(flags)
+    :
+    : "eax","cc" );
+    return (unsigned short)((a << 8) | flags | in_flags);
+}
+
 #elif (defined __WATCOMC__) && (defined _M_IX86)
 
+#define GG_CPU_DAA_ASM
+
 void gg_daa_wat(unsigned short *af);
 #pragma aux gg_daa_wat = \
 "mov al, [edx]" \
@@ -600,104 +885,64 @@ void gg_daa_wat(unsigned short *af);
 modify [eax] \
 parm [edx];
 
-#define GG_DAA()\
-    gg_daa_wat( &GG_AF( cpu ) );
-
-#else
-
-/* TODO! */
-#define GG_DAA()
-/* #error Implement the BCD opcodes! */
+static unsigned short gg_cpu_daa_asm(unsigned short af){
+    gg_daa_wat(&af);
+    return af;
+}
 
 #endif
+#endif /* NDEBUG */
 
-/* TODO: Should this also be pseudo ops? */
-void gg_prefix_cb(GG_CPU *const cpu, GG_MMU *const mmu, const unsigned char bz){
-    volatile unsigned char b = bz;
-    const unsigned char src_type = b & 0x07;
-    const unsigned char op_category = b >> 6;
-    
-    GG_TMP8( 1 )
-    
-    /* Get the value */
-    switch(src_type){
-        case 0x0: GG_TMP0( cpu ) = GG_B( cpu ); break;
-        case 0x1: GG_TMP0( cpu ) = GG_C( cpu ); break;
-        case 0x2: GG_TMP0( cpu ) = GG_D( cpu ); break;
-        case 0x3: GG_TMP0( cpu ) = GG_E( cpu ); break;
-        case 0x4: GG_TMP0( cpu ) = GG_H( cpu ); break;
-        case 0x5: GG_TMP0( cpu ) = GG_L( cpu ); break;
-        case 0x6:
-            GG_TMP0( cpu ) = GG_Read8MMU(mmu, GG_HL( cpu ));
-            break;
-        case 0x7: GG_TMP0( cpu ) = GG_A( cpu ); break;
-    }
-    
-    switch(op_category){
-        case 0:
-            /* A large variety of things... */
-            {
-                const unsigned char op_val = (b >> 3) & 0x07;
-                switch(op_val){
-                    case 0: GG_RLC_REG8( TMP0 ) break;
-                    case 1: GG_RRC_REG8( TMP0 ) break;
-                    case 2: GG_RL_REG8( TMP0 ) break;
-                    case 3: GG_RR_REG8( TMP0 ) break;
-                    case 4: GG_SLA_REG8( TMP0 ) break;
-                    case 5: GG_SRA_REG8( TMP0 ) break;
-                    case 6: GG_SWAP_REG8( TMP0 ) break;
-                    case 7: GG_SRL_REG8( TMP0 ) break;
-                }
-            }
-            break;
-        case 1:
-            /* Bit test */
-            {
-                const unsigned bit = (b >> 3) - 8;
-                if( (GG_TMP0( cpu ) & (1<<bit)) != 0 ) {
-                    GG_CLEAR_FLAG2( ZERO, OPERATION )
-                    GG_SET_FLAG( HALF_CARRY )
-                }
-                else {
-                    GG_CLEAR_FLAG( OPERATION )
-                    GG_SET_FLAG2( ZERO, HALF_CARRY )
-                }
-            }
-            break;
-        case 2:
-            /* Reset bit */
-            {
-                const unsigned bit = (b >> 3) - 16;
-                GG_TMP0( cpu ) &= ~(1<<bit);
-            }
-            break;
-        case 3:
-            /* Set bit */
-            {
-                const unsigned bit = (b >> 3) - 24;
-                GG_TMP0( cpu ) |= (1<<bit);
-            }
-    }
+#ifdef GG_CPU_DAA_ASM
+static void gg_cpu_check_daa(void){
+    unsigned i;
     
-    /* Set the value */
-    switch(src_type){
-        case 0x0: GG_B( cpu ) = GG_TMP0( cpu ); break;
-        case 0x1: GG_C( cpu ) = GG_TMP0( cpu ); break;
-        case 0x2: GG_D( cpu ) = GG_TMP0( cpu ); break;
-        case 0x3: GG_E( cpu ) = GG_TMP0( cpu ); break;
-        case 0x4: GG_H( cpu ) = GG_TMP0( cpu ); break;
-        case 0x5: GG_L( cpu ) = GG_TMP0( cpu ); break;
-        case 0x6:
-            GG_Write8MMU(mmu, GG_HL( cpu ), GG_TMP0( cpu ));
-            break;
-        case 0x7: GG_A( cpu ) = GG_TMP0( cpu ); break;
+    /* x86 DAA ignores N, so only the additions can be checked */
+    for(i = 0; i < 0x800; i++){
+        const unsigned short af =
+            (unsigned short)(((i & 0xFF) << 8) | ((i >> 4) & 0x70));
+        if(af & GG_OPERATION_FLAG)
+            continue;
+        assert(gg_cpu_daa_asm(af) == gg_cpu_daa_table[i]);
     }
+}
+#endif
+
+/* MMIO handlers for the timer, FF04 to FF07. Anything outside of the CPU
+ * sees the registers as of the last access or event.
+ */
+static gg_timestamp_t gg_cpu_timer_now(const GG_CPU *cpu){
+    return (cpu->io_time > cpu->timer.time) ? cpu->io_time : cpu->timer.time;
+}
+
+static GG_MMU_FUNC(unsigned) gg_cpu_timer_io_read(void *arg,
+    GG_MMU *mmu,
+    unsigned address){
     
-    GG_END_TMP8( 1 )
+    GG_CPU *const cpu = arg;
+    gg_cpu_timer_sync(&cpu->timer, mmu, gg_cpu_timer_now(cpu));
+    return GG_GetMMUIO(mmu, address);
+}
+
+static GG_MMU_FUNC(void) gg_cpu_timer_io_write(void *arg,
+    GG_MMU *mmu,
+    unsigned address,
+    unsigned value){
+    
+    GG_CPU *const cpu = arg;
+    gg_cpu_timer_write(&cpu->timer, mmu, gg_cpu_timer_now(cpu),
+        address, value);
+    gg_cpu_sched_set(&cpu->sched, GG_CPU_EVENT_TIMER,
+        gg_cpu_timer_overflow(&cpu->timer, mmu));
 }
 
 GG_CPU_FUNC(void) GG_CPU_Init(GG_CPU *cpu, void *mmu_v){
     register GG_MMU *const mmu = mmu_v;
+    unsigned i;
+    
+#ifdef GG_CPU_DAA_ASM
+    gg_cpu_check_daa();
+#endif
     
     GG_AF( cpu ) = 0;
     GG_BC( cpu ) = 0;
@@ -706,6 +951,34 @@ GG_CPU_FUNC(void) GG_CPU_Init(GG_CPU *cpu, void *mmu_v){
     GG_SP( cpu ) = 0;
     
     cpu->interrupts_enabled = GG_FALSE;
+    cpu->halted = GG_FALSE;
+    cpu->ei_delay = GG_FALSE;
+    cpu->blocks = NULL;
+    cpu->jit_mode = GG_CPU_JIT_OFF;
+    cpu->jit_stop = GG_FALSE;
+    cpu->jit_checking = GG_FALSE;
+    cpu->jit_mmu = NULL;
+    cpu->jit_time = 0;
+    cpu->jit_check = NULL;
+    cpu->instructions = 0;
+    cpu->idle_skips = 0;
+    cpu->jit_mismatches = 0;
+#ifdef GG_PROFILE
+    cpu->profile = NULL;
+#endif
+    
+    gg_cpu_sched_init(&cpu->sched);
+    cpu->gpu_time = 0;
+    cpu->io_time = 0;
+    gg_cpu_timer_init(&cpu->timer);
+    
+    /* Only DIV and TIMA change on their own */
+    for(i = 0xFF04; i < 0xFF08; i++){
+        GG_SetMMUIOHandler(mmu, i,
+            (i < 0xFF06) ? gg_cpu_timer_io_read : NULL,
+            gg_cpu_timer_io_write,
+            cpu);
+    }
     
     /* Get the entry address */
     if(GG_Read16MMU(mmu, 0x100) == 0xC300){
@@ -716,11 +989,71 @@ GG_CPU_FUNC(void) GG_CPU_Init(GG_CPU *cpu, void *mmu_v){
     }
 }
 
+GG_CPU_FUNC(void) GG_CPU_Fini(GG_CPU *cpu){
+    gg_cpu_block_destroy(cpu->blocks);
+    cpu->blocks = NULL;
+    free(cpu->jit_check);
+    cpu->jit_check = NULL;
+#ifdef GG_PROFILE
+    gg_cpu_profile_destroy(cpu->profile);
+    cpu->profile = NULL;
+#endif
+}
+
+GG_CPU_FUNC(int) GG_CPU_WriteProfile(const GG_CPU *cpu,
+    void *mmu,
+    const char *path,
+    unsigned format){
+    
+#ifdef GG_PROFILE
+    return gg_cpu_profile_write(cpu->profile, mmu, path, format);
+#else
+    (void)cpu;
+    (void)mmu;
+    (void)path;
+    (void)format;
+    return -1;
+#endif
+}
+
+GG_CPU_FUNC(void) GG_CPU_SetJIT(GG_CPU *cpu, unsigned mode){
+    assert(mode == GG_CPU_JIT_OFF ||
+        mode == GG_CPU_JIT_ON ||
+        mode == GG_CPU_JIT_CHECK);
+    cpu->jit_mode = (unsigned char)mode;
+}
+
+/* Copies the register file between the GG_CPU and the locals in gg_cpu_run.
+ * This must be done any time something outside of the loop can see the CPU.
+ * F is written from the lazy flags first.
+ */
+#define GG_CPU_STORE_REGS(CPU) do{ \
+        GG_SYNC_FLAGS(); \
+        (CPU)->AF.reg = AF.reg; \
+        (CPU)->BC.reg = BC.reg; \
+        (CPU)->DE.reg = DE.reg; \
+        (CPU)->HL.reg = HL.reg; \
+        (CPU)->SP = sp; \
+        (CPU)->IP = ip; \
+    }while(0)
+
+#define GG_CPU_LOAD_REGS(CPU) do{ \
+        AF.reg = (CPU)->AF.reg; \
+        GG_LOAD_FLAGS(); \
+        BC.reg = (CPU)->BC.reg; \
+        DE.reg = (CPU)->DE.reg; \
+        HL.reg = (CPU)->HL.reg; \
+        sp = (CPU)->SP; \
+        ip = (CPU)->IP; \
+    }while(0)
+
 #define GG_CPU_DBG_CHECK_WAIT(DBG, RENDER_CB, RENDER_ARG) do{ \
     if((DBG) && GG_DBG_GET_STATE((DBG)) == GG_DBG_PAUSE){ \
+            GG_CPU_STORE_REGS(cpu); \
             do{ \
                 (RENDER_CB)((RENDER_ARG)); \
             }while(GG_DBG_GET_STATE((DBG)) == GG_DBG_PAUSE); \
+            GG_CPU_LOAD_REGS(cpu); \
         } \
     } while(0)
 
@@ -732,48 +1065,966 @@ GG_CPU_FUNC(void) GG_CPU_Init(GG_CPU *cpu, void *mmu_v){
         }while(GG_DBG_GET_STATE((DBG)) == GG_DBG_PAUSE); \
     }while(0)
 
-void GG_CPU_Execute(GG_CPU *cpu,
-    void *mmu_v,
+/* Run after every instruction when there is a debugger. The debugger core
+ * is only called when the breakpoint bitmap has the bit set, and then it
+ * checks the condition and hit count.
+ */
+#define GG_CPU_DBG_STEP(DBG, RENDER_CB, RENDER_ARG) do{ \
+        if(GG_DBG_IS_BREAKPOINT((DBG), GG_CPU_BLOCK_BANK(mmu, ip), ip)){ \
+            GG_CPU_STORE_REGS(cpu); \
+            if(GG_DBG_CheckBreakpoint((DBG), ip)) \
+                GG_DBG_SET_STATE((DBG), GG_DBG_PAUSE); \
+        } \
+        GG_CPU_DBG_CHECK_WAIT((DBG), (RENDER_CB), (RENDER_ARG)); \
+    }while(0)
+
+/* The CB opcodes are in cpu_cb.inc. Their cycles are for the whole
+ * instruction, but the 0xCB opcode has already counted its own.
+ */
+#define GG_CPU_CB_CYCLES(CYCLES) ((CYCLES) - 4)
+
+#ifdef GG_CPU_THREADED_DISPATCH
+
+#define GG_PREFIX_CB() \
+    { \
+        const unsigned char cb = GG_CPU_IMM8(); \
+        ++ip; \
+        goto *gg_cpu_cb_labels[cb]; \
+    }
+
+#define GG_CB_OPCODE(N, CYCLES) gg_cpu_cb_op_ ## N: \
+    GG_CPU_PROFILE_CB_OP(N) \
+    m += GG_CPU_CB_CYCLES(CYCLES); \
+    {
+
+#define GG_END_CB_OPCODE(N) \
+    } \
+    assert(debug_op == 0xCB); \
+    GG_CPU_NEXT();
+
+#else
+
+/* The CB opcodes have their own switch after the main one */
+#define GG_PREFIX_CB()
+
+#define GG_CB_OPCODE(N, CYCLES) case N: \
+    GG_CPU_PROFILE_CB_OP(N) \
+    m += GG_CPU_CB_CYCLES(CYCLES); \
+    {
+
+#define GG_END_CB_OPCODE(N) \
+    } \
+    assert(debug_op == 0xCB); \
+    break;
+
+#endif
+
+/* Registers are on the C stack in gg_cpu_run */
+#undef GG_AF
+#undef GG_A
+#undef GG_F
+#undef GG_BC
+#undef GG_B
+#undef GG_C
+#undef GG_DE
+#undef GG_D
+#undef GG_E
+#undef GG_HL
+#undef GG_H
+#undef GG_L
+#undef GG_SP
+#undef GG_IP
+#define GG_AF(CPU) (AF.reg)
+#define GG_A(CPU)  (AF.reg8.A)
+#define GG_F(CPU)  (AF.reg8.F)
+#define GG_BC(CPU) (BC.reg)
+#define GG_B(CPU)  (BC.reg8.B)
+#define GG_C(CPU)  (BC.reg8.C)
+#define GG_DE(CPU) (DE.reg)
+#define GG_D(CPU)  (DE.reg8.D)
+#define GG_E(CPU)  (DE.reg8.E)
+#define GG_HL(CPU) (HL.reg)
+#define GG_H(CPU)  (HL.reg8.H)
+#define GG_L(CPU)  (HL.reg8.L)
+#define GG_SP(CPU) (sp)
+#define GG_IP(CPU) (ip)
+
+#ifdef GG_CPU_THREADED_DISPATCH
+
+/* Builds the jump table for the labels starting with P, one row of 16 at a
+ * time.
+ */
+#define GG_CPU_LABEL_ROW(P, H) \
+    &&P ## 0x ## H ## 0, &&P ## 0x ## H ## 1, \
+    &&P ## 0x ## H ## 2, &&P ## 0x ## H ## 3, \
+    &&P ## 0x ## H ## 4, &&P ## 0x ## H ## 5, \
+    &&P ## 0x ## H ## 6, &&P ## 0x ## H ## 7, \
+    &&P ## 0x ## H ## 8, &&P ## 0x ## H ## 9, \
+    &&P ## 0x ## H ## A, &&P ## 0x ## H ## B, \
+    &&P ## 0x ## H ## C, &&P ## 0x ## H ## D, \
+    &&P ## 0x ## H ## E, &&P ## 0x ## H ## F
+
+#define GG_CPU_LABEL_TABLE(P) \
+    GG_CPU_LABEL_ROW(P, 0), GG_CPU_LABEL_ROW(P, 1), \
+    GG_CPU_LABEL_ROW(P, 2), GG_CPU_LABEL_ROW(P, 3), \
+    GG_CPU_LABEL_ROW(P, 4), GG_CPU_LABEL_ROW(P, 5), \
+    GG_CPU_LABEL_ROW(P, 6), GG_CPU_LABEL_ROW(P, 7), \
+    GG_CPU_LABEL_ROW(P, 8), GG_CPU_LABEL_ROW(P, 9), \
+    GG_CPU_LABEL_ROW(P, A), GG_CPU_LABEL_ROW(P, B), \
+    GG_CPU_LABEL_ROW(P, C), GG_CPU_LABEL_ROW(P, D), \
+    GG_CPU_LABEL_ROW(P, E), GG_CPU_LABEL_ROW(P, F)
+
+/* Fetches the next opcode and jumps to it, or stops for events */
+#define GG_CPU_DISPATCH() \
+    do{ \
+        if(m >= limit) \
+            goto gg_cpu_event; \
+        { \
+            const unsigned GG_opcode = GG_READ8MMU(mmu, ip); \
+            ip++; \
+            goto *gg_cpu_labels[GG_opcode]; \
+        } \
+    }while(0)
+
+/* The end of every opcode. GG_CPU_RUN_NEXT is set by cpu_run.inc. */
+#define GG_CPU_NEXT() \
+    do{ \
+        GG_CPU_PROFILE_END() \
+        instructions++; \
+        GG_CPU_RUN_NEXT(); \
+    }while(0)
+
+/* Labels as values and computed goto are extensions */
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+
+#endif
+
+
+/* Advances the GPU up to the current time, and schedules its next update */
+static void gg_cpu_sync_gpu(GG_CPU *cpu,
+    GG_MMU *mmu,
     void *gpu_v,
     void *win_v,
-    void *dbg_v,
-    void *render_cb_v,
+    const on_gpu_advance_callback render_cb,
     void *render_arg){
     
-    register unsigned m = cpu->M;
-    register unsigned short ip = cpu->IP;
-    register GG_MMU *const mmu = mmu_v;
-    GG_DBG *const dbg = dbg_v;
-    on_gpu_advance_callback render_cb = (on_gpu_advance_callback)render_cb_v;
-    DEBUG_ONLY(int debug_op);
+    const gg_timestamp_t now = cpu->sched.now;
+    const unsigned old_mode = GG_GPU_GetMode(gpu_v);
+    const unsigned old_line = GG_GPU_GetLine(gpu_v);
+    unsigned mode, line;
+    GG_GPU_Advance(gpu_v, win_v, mmu, (unsigned)(now - cpu->gpu_time),
+        render_cb, render_arg);
+    cpu->gpu_time = now;
+    gg_cpu_sched_set(&cpu->sched, GG_CPU_EVENT_GPU,
+        now + GG_GPU_GetClocksToUpdate(gpu_v));
     
-    assert((render_cb == NULL) == (dbg == NULL));
+    mode = GG_GPU_GetMode(gpu_v);
+    line = GG_GPU_GetLine(gpu_v);
+    if(mode != old_mode || line != old_line){
+        const unsigned stat = GG_Read8MMU(mmu, 0xFF41);
+        const unsigned coincidence =
+            (GG_Read8MMU(mmu, 0xFF44) == GG_Read8MMU(mmu, 0xFF45)) ? 4 : 0;
+        unsigned request = 0;
+        
+        if(mode != old_mode){
+            if(mode == GG_GPU_VBLANK_MODE)
+                request |= GG_CPU_INTERRUPT_VBLANK;
+            /* Bits 3, 4, and 5 enable the interrupt for modes 0, 1, and 2 */
+            if(mode != GG_GPU_VRAM_MODE && (stat & (8 << mode)))
+                request |= GG_CPU_INTERRUPT_STAT;
+        }
+        if(line != old_line && coincidence && (stat & 0x40))
+            request |= GG_CPU_INTERRUPT_STAT;
+        
+        GG_Write8MMU(mmu, 0xFF41, (stat & 0xF8) | coincidence | mode);
+        if(request != 0)
+            GG_Write8MMU(mmu, 0xFF0F, GG_Read8MMU(mmu, 0xFF0F) | request);
+    }
+}
+
+/* Pushes IP for an interrupt. This is between ops, so the block runner's
+ * version of GG_CPU_WRITE16 can't be used. The high byte goes first, the same
+ * as the hardware.
+ */
+static void gg_cpu_push_interrupt(GG_MMU *mmu,
+    struct GG_CPU_BlockCache *blocks,
+    unsigned sp,
+    unsigned ip){
     
-    /* Pause at the beginning of we have a debugger. */
-    GG_CPU_DBG_ENTER_WAIT(dbg, render_cb, render_arg);
+    GG_Write8MMU(mmu, (sp + 1) & 0xFFFF, ip >> 8);
+    GG_Write8MMU(mmu, sp, ip & 0xFF);
+#ifndef GG_NO_BLOCK_CACHE
+    if(blocks != NULL){
+        if(GG_CPU_BLOCK_IS_CODE(blocks, sp))
+            gg_cpu_block_invalidate(blocks, sp);
+        if(GG_CPU_BLOCK_IS_CODE(blocks, sp + 1))
+            gg_cpu_block_invalidate(blocks, (sp + 1) & 0xFFFF);
+    }
+#else
+    (void)blocks;
+#endif
+}
+
+/* Checks IE and IF, and wakes the CPU if anything is pending. If interrupts
+ * are enabled, this pushes IP to sp - 2 and returns the vector to jump to.
+ * Otherwise this returns zero.
+ */
+static unsigned gg_cpu_interrupt(GG_CPU *cpu,
+    GG_MMU *mmu,
+    struct GG_CPU_BlockCache *blocks,
+    unsigned ip,
+    unsigned sp){
     
-    /* ip is now on the C stack */
-#undef GG_IP
-#define GG_IP(CPU) (ip)
+    const unsigned flags = GG_Read8MMU(mmu, 0xFF0F);
+    const unsigned pending = GG_Read8MMU(mmu, 0xFFFF) & flags & 0x1F;
+    unsigned n;
     
-    do{
-        const unsigned char opcode = GG_Read8MMU(mmu, ip++);
-        const unsigned old_m = m;
-        switch(opcode){
+    if(pending == 0)
+        return 0;
+    
+    cpu->halted = GG_FALSE;
+    if(!cpu->interrupts_enabled)
+        return 0;
+    
+    /* The lowest bit has priority */
+    for(n = 0; !(pending & (1 << n)); n++){}
+    
+    cpu->interrupts_enabled = GG_FALSE;
+    GG_Write8MMU(mmu, 0xFF0F, flags & ~(1 << n));
+    gg_cpu_push_interrupt(mmu, blocks, (sp - 2) & 0xFFFF, ip);
+    return 0x40 + (n << 3);
+}
+
+/* Dispatches every event that is due */
+static void gg_cpu_run_events(GG_CPU *cpu,
+    GG_MMU *mmu,
+    void *gpu_v,
+    void *win_v,
+    const on_gpu_advance_callback render_cb,
+    void *render_arg){
+    
+    int event;
+    while((event = gg_cpu_sched_pop(&cpu->sched)) >= 0){
+        switch(event){
+            case GG_CPU_EVENT_GPU:
+                gg_cpu_sync_gpu(cpu, mmu, gpu_v, win_v, render_cb, render_arg);
+                break;
+            case GG_CPU_EVENT_TIMER:
+                gg_cpu_timer_sync(&cpu->timer, mmu, cpu->sched.now);
+                gg_cpu_sched_set(&cpu->sched, GG_CPU_EVENT_TIMER,
+                    gg_cpu_timer_overflow(&cpu->timer, mmu));
+                break;
+        }
+    }
+}
+
+/* The run loops only compare m to limit, which is the cycle in this run when
+ * the next event is due, or the budget if that comes first. Events may only
+ * be run at the end of an instruction or a block.
+ * Interrupts are checked after the events, since those can raise them. Taking
+ * an interrupt uses up cycles, so that can make another event due.
+ * While the CPU is halted, the cycles up to each event are skipped over
+ * without running anything, and the GPU catches up in one step.
+ * EI only enables interrupts after this, and then sets the limit so they are
+ * checked again after one more op. If the budget has run out, that waits for
+ * the next run.
+ */
+#define GG_CPU_EVENT_LIMIT() \
+    ((cpu->sched.next - start < budget) ? \
+        (unsigned)(cpu->sched.next - start) : budget)
+
+#define GG_CPU_INTERRUPT_CYCLES 20
+
+#ifdef GG_NO_BLOCK_CACHE
+#define GG_CPU_BLOCKS NULL
+#else
+#define GG_CPU_BLOCKS blocks
+#endif
+
+#define GG_CPU_RUN_EVENTS() \
+    for(;;){ \
+        unsigned GG_vector; \
+        cpu->sched.now = start + m; \
+        gg_cpu_run_events(cpu, mmu, gpu_v, win_v, render_cb, render_arg); \
+        GG_vector = gg_cpu_interrupt(cpu, mmu, GG_CPU_BLOCKS, ip, sp); \
+        if(GG_vector != 0){ \
+            sp -= 2; \
+            ip = GG_vector; \
+            m += GG_CPU_INTERRUPT_CYCLES; \
+        } \
+        limit = GG_CPU_EVENT_LIMIT(); \
+        if(m >= limit){ \
+            if(limit == budget) \
+                break; \
+        } \
+        else if(cpu->halted) \
+            m = limit; \
+        else \
+            break; \
+    } \
+    if(cpu->ei_delay && m < budget){ \
+        cpu->ei_delay = GG_FALSE; \
+        cpu->interrupts_enabled = GG_TRUE; \
+        if(limit > m + 1) \
+            limit = m + 1; \
+    }
+
+/* The GPU might have been changed since the last run, so it is always
+ * rescheduled at the start. At the end, it and the timer are brought up to
+ * date so that they can be inspected between runs.
+ */
+#define GG_CPU_START_EVENTS() \
+    gg_cpu_sched_set(&cpu->sched, GG_CPU_EVENT_GPU, \
+        start + GG_GPU_GetClocksToUpdate(gpu_v)); \
+    GG_CPU_RUN_EVENTS();
+
+#define GG_CPU_FINISH_EVENTS() \
+    cpu->sched.now = start + m; \
+    gg_cpu_sync_gpu(cpu, mmu, gpu_v, win_v, render_cb, render_arg); \
+    gg_cpu_timer_sync(&cpu->timer, mmu, cpu->sched.now);
+
+#define GG_CPU_RUN_NAME gg_cpu_run
+#include "cpu_run.inc"
+
+#define GG_CPU_RUN_NAME gg_cpu_run_debug
+#define GG_CPU_RUN_DEBUG
+#include "cpu_run.inc"
+
+#ifndef GG_NO_BLOCK_CACHE
+
+/* The block runner. Each opcode runs out of the decoded block instead of
+ * fetching from the MMU, and the base cycles for the whole block are added
+ * before running it. Events only run between blocks.
+ */
+#undef GG_CPU_IMM8
+#undef GG_CPU_IMM16
+#define GG_CPU_IMM8() ((unsigned char)op->imm)
+#define GG_CPU_IMM16() (op->imm)
+
+/* Writing over the running block, or swapping out the cartridge RAM, stops it
+ * after the current op. The cycles for the ops that will not run are given
+ * back.
+ */
+#undef GG_CPU_CODE_WRITTEN
+#define GG_CPU_CODE_WRITTEN(ADDR) \
+    gg_cpu_block_invalidate(blocks, (ADDR)); \
+    m -= gg_cpu_block_cycles(op + 1, end); \
+    end = op + 1;
+
+#undef GG_CPU_CART_REMAPPED
+#define GG_CPU_CART_REMAPPED() \
+    if(gg_cpu_block_invalidate_cart_ram(blocks)){ \
+        m -= gg_cpu_block_cycles(op + 1, end); \
+        end = op + 1; \
+    }
+
+#undef GG_CPU_NOW
+#define GG_CPU_NOW() (start + m - gg_cpu_block_cycles(op + 1, end))
+
+#undef GG_OPCODE
+#undef GG_END_OPCODE
+
+#ifdef GG_CPU_THREADED_DISPATCH
+
+#define GG_OPCODE(N, BYTES, CYCLES) gg_cpu_op_ ## N: \
+    DEBUG_ONLY(debug_op = N); \
+    ++ip; \
+    {
+
+#define GG_END_OPCODE(N) \
+    } \
+    assert(debug_op == N); \
+    if(++op == end) \
+        goto gg_cpu_block_end; \
+    goto *gg_cpu_labels[op->opcode];
+
+/* The block already counted the cycles */
+#undef GG_CB_OPCODE
+#undef GG_END_CB_OPCODE
+
+#define GG_CB_OPCODE(N, CYCLES) gg_cpu_cb_op_ ## N: \
+    {
+
+#define GG_END_CB_OPCODE(N) \
+    } \
+    assert(debug_op == 0xCB); \
+    if(++op == end) \
+        goto gg_cpu_block_end; \
+    goto *gg_cpu_labels[op->opcode];
+
+#else
+
+#define GG_OPCODE(N, BYTES, CYCLES) case N: \
+    DEBUG_ONLY(debug_op = N); \
+    ++ip; \
+    {
+
+#define GG_END_OPCODE(N) \
+    } \
+    assert(debug_op == N); \
+    break;
+
+#undef GG_CB_OPCODE
+
+#define GG_CB_OPCODE(N, CYCLES) case N: \
+    {
+
+#endif
+
+#ifdef GG_CPU_USE_JIT
+
+/* Callouts from compiled code, see cpu_jit.h. These do what GG_CPU_READ8 and
+ * GG_CPU_WRITE8 do, but report back with flags instead of setting the limit.
+ */
+
+/* For GG_CPU_JIT_CHECK, which runs compiled code on a copy of the CPU and
+ * then the same ops in the interpreter. Plain RAM is put back from before
+ * after the compiled code runs, and anything the compiled code would write
+ * through the MMU is kept here instead. Each op writes two bytes at most.
+ * Mapper writes and MMIO with a handler depend on more than memory, so a
+ * block that uses them is not checked.
+ */
+#define GG_CPU_JIT_CHECK_WRITES (GG_CPU_BLOCK_MAX_OPS * 2)
+
+struct GG_CPU_JIT_Check{
+    /* The MMU's pages, without reads from pages that aren't written
+     * directly. Writes there go to the journal, so reads have to call out to
+     * see them.
+     */
+    const unsigned char *pages[32];
+    unsigned char before[16][0x1000];
+    unsigned char after[16][0x1000];
+    unsigned num_writes;
+    int unchecked;
+    unsigned short addresses[GG_CPU_JIT_CHECK_WRITES];
+    unsigned char values[GG_CPU_JIT_CHECK_WRITES];
+};
+
+/* The memory for a page that can be written directly, or NULL */
+static unsigned char *gg_cpu_jit_write_page(const GG_MMU *mmu, unsigned page){
+    const unsigned char *const *const pages = GG_GetMMUPages(mmu);
+    if(pages[16 + page] == NULL)
+        return NULL;
+    return (unsigned char*)pages[16 + page] + (page << 12);
+}
+
+static unsigned char *gg_cpu_jit_journal(const GG_CPU *cpu,
+    unsigned address){
+    struct GG_CPU_JIT_Check *const check = cpu->jit_check;
+    unsigned i;
+    for(i = 0; i < check->num_writes; i++){
+        if(check->addresses[i] == address)
+            return check->values + i;
+    }
+    return NULL;
+}
+
+static unsigned gg_cpu_jit_peek8(const GG_CPU *cpu, unsigned address){
+    address &= 0xFFFF;
+    if(cpu->jit_checking){
+        const unsigned char *const value = gg_cpu_jit_journal(cpu, address);
+        if(value != NULL)
+            return *value;
+    }
+    return GG_READ8MMU(cpu->jit_mmu, address);
+}
+
+static void gg_cpu_jit_poke8(GG_CPU *cpu, unsigned address, unsigned value){
+    struct GG_CPU_JIT_Check *const check = cpu->jit_check;
+    address &= 0xFFFF;
+    /* Echo RAM is written where it can be read back */
+    if(cpu->jit_checking && address >= 0xE000 && address < 0xFE00)
+        address -= 0x2000;
+    if(cpu->jit_checking && address < 0x8000){
+        check->unchecked = 1;
+    }
+    else if(cpu->jit_checking &&
+        gg_cpu_jit_write_page(cpu->jit_mmu, address >> 12) == NULL){
+        unsigned char *entry = gg_cpu_jit_journal(cpu, address);
+        if(entry == NULL){
+            assert(check->num_writes < GG_CPU_JIT_CHECK_WRITES);
+            check->addresses[check->num_writes] = (unsigned short)address;
+            entry = check->values + check->num_writes++;
+        }
+        *entry = (unsigned char)value;
+    }
+    else{
+        GG_WRITE8MMU(cpu->jit_mmu, address, value);
+    }
+}
+
+/* GG_CPU_IO_ACCESS */
+static unsigned gg_cpu_jit_io(GG_CPU *cpu, unsigned address, unsigned cycles){
+    GG_MMU *const mmu = cpu->jit_mmu;
+    if(!GG_CPU_IS_HANDLED_IO(address))
+        return 0;
+    if(cpu->jit_checking)
+        cpu->jit_check->unchecked = 1;
+    cpu->io_time = cpu->jit_time + cycles;
+    cpu->jit_stop = GG_TRUE;
+    return GG_CPU_JIT_ACCESS_STOP;
+}
+
+/* GG_CPU_CHECK_CODE and GG_CPU_CHECK_INTERRUPT_WRITE. GG_CPU_JIT_CHECK leaves
+ * the blocks for the interpreter to throw out.
+ */
+static unsigned gg_cpu_jit_written(GG_CPU *cpu, unsigned address){
+    struct GG_CPU_BlockCache *const blocks = cpu->blocks;
+    unsigned result = 0;
+    if(GG_CPU_BLOCK_IS_CODE(blocks, address)){
+        if(!cpu->jit_checking)
+            gg_cpu_block_invalidate(blocks, address);
+        result = GG_CPU_JIT_ACCESS_END;
+    }
+    else if(address < 0x8000){
+        /* The mapper might have switched banks under the chained blocks */
+        result = GG_CPU_JIT_ACCESS_STOP;
+        if(cpu->jit_checking ?
+            gg_cpu_block_has_cart_ram(blocks) :
+            gg_cpu_block_invalidate_cart_ram(blocks)){
+            result |= GG_CPU_JIT_ACCESS_END;
+        }
+    }
+    if((address & 0xFF0F) == 0xFF0F){
+        cpu->jit_stop = GG_TRUE;
+        result |= GG_CPU_JIT_ACCESS_STOP;
+    }
+    return result;
+}
+
+unsigned gg_cpu_jit_read8(GG_CPU *cpu,
+    unsigned address,
+    unsigned value,
+    unsigned cycles){
+    const unsigned result = gg_cpu_jit_io(cpu, address, cycles);
+    (void)value;
+    if(result != 0)
+        return result | GG_Read8MMU(cpu->jit_mmu, address);
+    return gg_cpu_jit_peek8(cpu, address);
+}
+
+unsigned gg_cpu_jit_read16(GG_CPU *cpu,
+    unsigned address,
+    unsigned value,
+    unsigned cycles){
+    (void)value;
+    (void)cycles;
+    if(!cpu->jit_checking)
+        return GG_READ16MMU(cpu->jit_mmu, address);
+    return gg_cpu_jit_peek8(cpu, address) |
+        (gg_cpu_jit_peek8(cpu, address + 1) << 8);
+}
+
+unsigned gg_cpu_jit_write8(GG_CPU *cpu,
+    unsigned address,
+    unsigned value,
+    unsigned cycles){
+    const unsigned result = gg_cpu_jit_io(cpu, address, cycles);
+    gg_cpu_jit_poke8(cpu, address, value);
+    return result | gg_cpu_jit_written(cpu, address);
+}
+
+unsigned gg_cpu_jit_write16(GG_CPU *cpu,
+    unsigned address,
+    unsigned value,
+    unsigned cycles){
+    unsigned result = gg_cpu_jit_io(cpu, address, cycles) |
+        gg_cpu_jit_io(cpu, address + 1, cycles);
+    if(!cpu->jit_checking){
+        GG_WRITE16MMU(cpu->jit_mmu, address, value);
+    }
+    else{
+        gg_cpu_jit_poke8(cpu, address, value);
+        gg_cpu_jit_poke8(cpu, address + 1, value >> 8);
+    }
+    result |= gg_cpu_jit_written(cpu, address);
+    return result | gg_cpu_jit_written(cpu, address + 1);
+}
+
+/* Runs compiled code for GG_CPU_JIT_CHECK on a copy of the CPU, and leaves
+ * memory the way it was. The registers must be stored first.
+ */
+static unsigned gg_cpu_jit_check_run(GG_CPU *cpu,
+    GG_CPU *jit_cpu,
+    GG_MMU *mmu,
+    gg_cpu_jit_func func,
+    gg_timestamp_t time){
+    
+    struct GG_CPU_JIT_Check *const check = cpu->jit_check;
+    const unsigned char *const *const pages = GG_GetMMUPages(mmu);
+    unsigned page, result;
+    
+    for(page = 0; page < 16; page++){
+        const unsigned char *const memory = gg_cpu_jit_write_page(mmu, page);
+        check->pages[page] = (memory != NULL) ? pages[page] : NULL;
+        check->pages[16 + page] = pages[16 + page];
+        if(memory != NULL)
+            memcpy(check->before[page], memory, 0x1000);
+    }
+    check->num_writes = 0;
+    check->unchecked = 0;
+    
+    *jit_cpu = *cpu;
+    jit_cpu->jit_checking = GG_TRUE;
+    jit_cpu->jit_mmu = mmu;
+    jit_cpu->jit_time = time;
+    jit_cpu->jit_stop = GG_FALSE;
+    result = func(jit_cpu, check->pages, 0);
+    
+    /* Echo RAM is the same memory as work RAM, so every page is saved before
+     * any of them are put back.
+     */
+    for(page = 0; page < 16; page++){
+        const unsigned char *const memory = gg_cpu_jit_write_page(mmu, page);
+        if(memory != NULL)
+            memcpy(check->after[page], memory, 0x1000);
+    }
+    for(page = 0; page < 16; page++){
+        unsigned char *const memory = gg_cpu_jit_write_page(mmu, page);
+        if(memory != NULL)
+            memcpy(memory, check->before[page], 0x1000);
+    }
+    return result;
+}
+
+/* The first address where memory differs from what the compiled code left,
+ * or 0x10000 if it is the same. Of the writes that went to the journal, only
+ * VRAM and HRAM can be read back to check.
+ */
+static unsigned gg_cpu_jit_check_memory(const GG_CPU *cpu, GG_MMU *mmu){
+    const struct GG_CPU_JIT_Check *const check = cpu->jit_check;
+    unsigned page, i;
+    
+    for(page = 0; page < 16; page++){
+        const unsigned char *const memory = gg_cpu_jit_write_page(mmu, page);
+        if(memory != NULL){
+            for(i = 0; i < 0x1000; i++){
+                if(memory[i] != check->after[page][i])
+                    return (page << 12) | i;
+            }
+        }
+    }
+    
+    for(i = 0; i < check->num_writes; i++){
+        const unsigned address = check->addresses[i];
+        if((address >= 0x8000 && address < 0xA000) ||
+            (address >= 0xFF80 && address < 0xFFFF)){
+            if(GG_Read8MMU(mmu, address) != check->values[i])
+                return address;
+        }
+    }
+    return 0x10000;
+}
+
+/* Used by GG_CPU_JIT_CHECK to compare a compiled block against the
+ * interpreter. Returns zero and reports the block if they differ.
+ */
+static int gg_cpu_check_jit(const GG_CPU *cpu,
+    const GG_CPU *jit_cpu,
+    GG_MMU *mmu,
+    unsigned ops,
+    unsigned cycles,
+    unsigned jit_result,
+    unsigned address){
+    
+    const unsigned jit_ops = GG_CPU_JIT_OPS(jit_result);
+    const unsigned jit_cycles = GG_CPU_JIT_CYCLES(jit_result);
+    unsigned memory;
+    
+    if(cpu->jit_check->unchecked)
+        return 1;
+    memory = gg_cpu_jit_check_memory(cpu, mmu);
+    
+    if(cpu->AF.reg == jit_cpu->AF.reg &&
+        cpu->BC.reg == jit_cpu->BC.reg &&
+        cpu->DE.reg == jit_cpu->DE.reg &&
+        cpu->HL.reg == jit_cpu->HL.reg &&
+        cpu->SP == jit_cpu->SP &&
+        cpu->IP == jit_cpu->IP &&
+        cpu->interrupts_enabled == jit_cpu->interrupts_enabled &&
+        cpu->ei_delay == jit_cpu->ei_delay &&
+        cpu->halted == jit_cpu->halted &&
+        cpu->io_time == jit_cpu->io_time &&
+        ops == jit_ops &&
+        cycles == jit_cycles &&
+        memory == 0x10000){
+        return 1;
+    }
+    
+    fprintf(stderr, "JIT mismatch in block at %04X\n", address);
+    fprintf(stderr,
+        "    interpreter: AF=%04X BC=%04X DE=%04X HL=%04X SP=%04X IP=%04X +%u"
+        " ops=%u IE=%u EI=%u HALT=%u\n",
+        cpu->AF.reg, cpu->BC.reg, cpu->DE.reg, cpu->HL.reg,
+        cpu->SP, cpu->IP, cycles, ops, (unsigned)cpu->interrupts_enabled,
+        (unsigned)cpu->ei_delay, (unsigned)cpu->halted);
+    fprintf(stderr,
+        "    jit:         AF=%04X BC=%04X DE=%04X HL=%04X SP=%04X IP=%04X +%u"
+        " ops=%u IE=%u EI=%u HALT=%u\n",
+        jit_cpu->AF.reg, jit_cpu->BC.reg, jit_cpu->DE.reg, jit_cpu->HL.reg,
+        jit_cpu->SP, jit_cpu->IP, jit_cycles, jit_ops,
+        (unsigned)jit_cpu->interrupts_enabled, (unsigned)jit_cpu->ei_delay,
+        (unsigned)jit_cpu->halted);
+    if(cpu->io_time != jit_cpu->io_time)
+        fputs("    the MMIO time differs\n", stderr);
+    if(memory != 0x10000)
+        fprintf(stderr, "    memory differs at %04X\n", memory);
+    return 0;
+}
+
+#endif
+
+/* Same as gg_cpu_run, but for running without a debugger */
+static unsigned gg_cpu_run_blocks(GG_CPU *cpu,
+    GG_MMU *const mmu,
+    void *gpu_v,
+    void *win_v,
+    const on_gpu_advance_callback render_cb,
+    void *render_arg,
+    const unsigned budget){
+    
+    register unsigned m = 0;
+    const gg_timestamp_t start = cpu->sched.now;
+    unsigned limit;
+    unsigned long instructions = 0;
+    unsigned short ip, sp;
+    GG_REGISTER(A, F);
+    GG_REGISTER(B, C);
+    GG_REGISTER(D, E);
+    GG_REGISTER(H, L);
+    GG_LAZY_FLAGS_STATE();
+    struct GG_CPU_BlockCache *const blocks = cpu->blocks;
+#ifdef GG_CPU_USE_JIT
+    const unsigned jit_mode =
+        (blocks->jit != NULL) ? cpu->jit_mode : GG_CPU_JIT_OFF;
+    const unsigned char *const *const pages = GG_GetMMUPages(mmu);
+    /* State for GG_CPU_JIT_CHECK, only valid while jit_check is set */
+    GG_CPU jit_cpu;
+    unsigned jit_result = 0;
+    int jit_check = 0;
+#endif
+    DEBUG_ONLY(int debug_op;)
+    
+#ifdef GG_CPU_THREADED_DISPATCH
+    static void *const gg_cpu_labels[0x100] = {
+        GG_CPU_LABEL_TABLE(gg_cpu_op_)
+    };
+    static void *const gg_cpu_cb_labels[0x100] = {
+        GG_CPU_LABEL_TABLE(gg_cpu_cb_op_)
+    };
+#endif
+    
+    assert(blocks != NULL);
+    
+    GG_CPU_LOAD_REGS(cpu);
+    GG_CPU_START_EVENTS();
+#ifdef GG_CPU_USE_JIT
+    cpu->jit_mmu = mmu;
+#endif
+    
+    while(m < budget){
+        struct GG_CPU_Block *const block = GG_CPU_BLOCK_SLOT(blocks, ip);
+        const struct GG_CPU_MicroOp *op, *end;
+        const unsigned block_m = m;
+        
+        if(block->length == 0 ||
+            block->address != ip ||
+            block->bank != GG_CPU_BLOCK_BANK(mmu, ip)){
+            gg_cpu_block_build(blocks, block, mmu, ip);
+        }
+        
+        op = block->ops;
+        end = op + block->length;
+        
+#ifdef GG_CPU_USE_JIT
+        if(jit_mode != GG_CPU_JIT_OFF && block->jit == NULL && !block->idle &&
+            block->hits < GG_CPU_BLOCK_JIT_THRESHOLD &&
+            ++block->hits == GG_CPU_BLOCK_JIT_THRESHOLD){
+            gg_cpu_block_compile(blocks, block, mmu);
+        }
+        
+        /* Compiled code counts its own cycles, and might run through several
+         * blocks. If it stops early the next block starts where it left off.
+         */
+        if(jit_mode == GG_CPU_JIT_ON && block->jit != NULL){
+            const unsigned chain = (limit - m < GG_CPU_JIT_CHAIN_CYCLES) ?
+                (limit - m) : GG_CPU_JIT_CHAIN_CYCLES;
+            GG_CPU_STORE_REGS(cpu);
+            cpu->jit_time = start + m;
+            cpu->jit_stop = GG_FALSE;
+            jit_result = block->jit(cpu, pages, chain);
+            GG_CPU_LOAD_REGS(cpu);
+            m += GG_CPU_JIT_CYCLES(jit_result);
+            instructions += GG_CPU_JIT_OPS(jit_result);
+            /* Anything the interpreter would have set the limit for */
+            if(cpu->jit_stop)
+                limit = m;
+            goto gg_cpu_block_advance;
+        }
+        else if(jit_mode == GG_CPU_JIT_CHECK && block->jit != NULL){
+            if(cpu->jit_check == NULL)
+                cpu->jit_check = calloc(1, sizeof(struct GG_CPU_JIT_Check));
+            if(cpu->jit_check != NULL){
+                GG_CPU_STORE_REGS(cpu);
+                jit_result = gg_cpu_jit_check_run(cpu,
+                    &jit_cpu,
+                    mmu,
+                    block->jit,
+                    start + m);
+                jit_check = 1;
+            }
+        }
+#endif
+        
+        m += block->cycles;
+        
+#ifdef GG_CPU_THREADED_DISPATCH
+        
+        goto *gg_cpu_labels[op->opcode];
+        
 #include "cpu.inc"
+#include "cpu_cb.inc"
+        
+gg_cpu_block_end:
+        
+#else
+        
+        do{
+            switch(op->opcode){
+#include "cpu.inc"
+            }
+            
+            if(op->opcode == 0xCB){
+                ++ip;
+                switch(GG_CPU_IMM8()){
+#include "cpu_cb.inc"
+                }
+            }
+        }while(++op != end);
+        
+#endif
+        
+#ifdef GG_CPU_USE_JIT
+        if(jit_check){
+            jit_check = 0;
+            GG_CPU_STORE_REGS(cpu);
+            if(!gg_cpu_check_jit(cpu, &jit_cpu, mmu,
+                (unsigned)(op - block->ops),
+                m - block_m,
+                jit_result,
+                block->address)){
+                block->jit = NULL;
+                cpu->jit_mismatches++;
+            }
+        }
+        
+#endif
+        
+        instructions += op - block->ops;
+        
+        /* An idle block that loops back to itself will do the same thing
+         * until an event changes memory, so skip ahead to the first pass that
+         * would reach the next event. Idle blocks are never compiled.
+         */
+        if(block->idle && ip == block->address && m < limit){
+            const unsigned pass = m - block_m;
+            const unsigned passes = (limit - m + pass - 1) / pass;
+            m += passes * pass;
+            instructions += (unsigned long)passes * block->length;
+            cpu->idle_skips++;
         }
         
-        /* Check for interrupts 
-        assert(m > old_m);
-        */
-        GG_GPU_ADVANCE(gpu_v, win_v, mmu, m - old_m, render_cb, render_arg);
+#ifdef GG_CPU_USE_JIT
+gg_cpu_block_advance:
+#endif
         
-        /* Check for breakpoint */
-        if(dbg && GG_DBG_IsBreakpoint(dbg, ip)){
-            GG_CPU_DBG_ENTER_WAIT(dbg, render_cb, render_arg);
+        if(m >= limit){
+            GG_CPU_RUN_EVENTS();
         }
-        else {
-            GG_CPU_DBG_CHECK_WAIT(dbg, render_cb, render_arg);
+    }
+    
+    GG_CPU_FINISH_EVENTS();
+    GG_CPU_STORE_REGS(cpu);
+    cpu->instructions += instructions;
+    return m;
+}
+
+#endif
+
+#ifdef GG_CPU_THREADED_DISPATCH
+#pragma GCC diagnostic pop
+#endif
+
+GG_CPU_FUNC(unsigned) GG_CPU_RunCycles(GG_CPU *cpu,
+    void *mmu,
+    void *gpu,
+    void *win,
+    GG_DBG *dbg,
+    on_gpu_advance_callback render_cb,
+    void *render_arg,
+    unsigned budget){
+    
+    /* The debugger needs the render callback to keep the UI alive while
+     * paused. A render callback without a debugger is just a vblank hook.
+     */
+    assert(dbg == NULL || render_cb != NULL);
+    
+#ifdef GG_PROFILE
+    if(cpu->profile == NULL)
+        cpu->profile = gg_cpu_profile_create();
+#endif
+    
+#ifndef GG_NO_BLOCK_CACHE
+    /* Breakpoints need to be checked on every instruction, so the debugger
+     * always uses the plain interpreter. If the cache can't be allocated we
+     * can fall back to that as well.
+     */
+    if(dbg == NULL){
+        if(cpu->blocks == NULL)
+            cpu->blocks = gg_cpu_block_create();
+        if(cpu->blocks != NULL){
+            return gg_cpu_run_blocks(cpu, mmu, gpu, win,
+                render_cb, render_arg, budget);
         }
+    }
+#endif
+    
+    if(dbg != NULL){
+        return gg_cpu_run_debug(cpu, mmu, gpu, win, dbg,
+            render_cb, render_arg, budget);
+    }
+    
+    return gg_cpu_run(cpu, mmu, gpu, win, render_cb, render_arg, budget);
+}
+
+GG_CPU_FUNC(unsigned) GG_CPU_RunFrame(GG_CPU *cpu,
+    void *mmu,
+    void *gpu,
+    void *win,
+    GG_DBG *dbg,
+    on_gpu_advance_callback render_cb,
+    void *render_arg){
+    
+    /* The GPU advances with the same clocks as we do, so it will enter vblank
+     * on the same instruction that uses up the budget.
+     */
+    return GG_CPU_RunCycles(cpu, mmu, gpu, win, dbg, render_cb, render_arg,
+        GG_GPU_GetClocksToVBlank(gpu));
+}
+
+void GG_CPU_Execute(GG_CPU *cpu,
+    void *mmu,
+    void *gpu,
+    void *win,
+    GG_DBG *dbg,
+    on_gpu_advance_callback render_cb,
+    void *render_arg){
+    
+    /* Pause at the beginning of we have a debugger. */
+    GG_CPU_DBG_ENTER_WAIT(dbg, render_cb, render_arg);
+    
+    do{
+        GG_CPU_RunFrame(cpu, mmu, gpu, win, dbg, render_cb, render_arg);
     }while(1);
 }
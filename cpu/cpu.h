@@ -10,6 +10,7 @@
 #pragma once
 
 #include "../gg_call.h"
+#include "../gpu/gpu.h"
 
 #ifdef __cplusplus
 #define GG_CPU_FUNC(T) extern "C" GG_CCALL(T)
@@ -23,6 +24,8 @@ struct GG_CPU_s;
 typedef struct GG_CPU_s GG_CPU;
 typedef GG_CPU* GG_CPU_ptr;
 
+struct GG_DBG_s;
+
 #define GG_REGISTERS_XY( X, R1, R2 ) \
     X( R1 ) \
     X( R2 ) \
@@ -45,13 +48,99 @@ GG_ALL_REGISTERS( GG_DECLARE_REGISTER_ACCESS )
 
 #undef GG_DECLARE_REGISTER_ACCESS
 
+/* Statistics, these count up from GG_CPU_Init and may wrap */
+GG_CPU_FUNC(unsigned long) GG_CPU_GetCycles(const GG_CPU *cpu);
+GG_CPU_FUNC(unsigned long) GG_CPU_GetInstructions(const GG_CPU *cpu);
+
+/* Times an idle loop was skipped over when running without a debugger. The
+ * instructions that would have run are still counted.
+ */
+GG_CPU_FUNC(unsigned long) GG_CPU_GetIdleSkips(const GG_CPU *cpu);
+
+/* Blocks that GG_CPU_JIT_CHECK reported as different from the interpreter */
+GG_CPU_FUNC(unsigned long) GG_CPU_GetJITMismatches(const GG_CPU *cpu);
+
+/* Bits in IE (FFFF) and IF (FF0F). Setting a bit in IF requests the
+ * interrupt, and it is taken if the same bit is set in IE and interrupts are
+ * enabled. The CPU only checks these when it stops for an event, or after it
+ * writes to one of them.
+ */
+#define GG_CPU_INTERRUPT_VBLANK 0x01
+#define GG_CPU_INTERRUPT_STAT 0x02
+#define GG_CPU_INTERRUPT_TIMER 0x04
+#define GG_CPU_INTERRUPT_SERIAL 0x08
+#define GG_CPU_INTERRUPT_JOYPAD 0x10
+
+/* Also puts the timer's MMIO handlers on the MMU, so the MMU should not be
+ * used after the CPU is gone.
+ */
 GG_CPU_FUNC(void) GG_CPU_Init(GG_CPU *cpu, void *mmu);
+
+/* Frees anything the CPU allocated while running */
+GG_CPU_FUNC(void) GG_CPU_Fini(GG_CPU *cpu);
+
+/* JIT modes. The JIT only exists on x86-64, on anything else this does
+ * nothing. It is only used when running without a debugger.
+ * GG_CPU_JIT_CHECK runs every compiled block through the interpreter as well,
+ * and reports to stderr if the registers or memory differ afterwards. Blocks
+ * that write to the mapper or use MMIO with a handler are not checked, and
+ * blocks that write to other MMIO and read it back can be reported even when
+ * they are right, since the compiled code doesn't really write it.
+ */
+#define GG_CPU_JIT_OFF 0
+#define GG_CPU_JIT_ON 1
+#define GG_CPU_JIT_CHECK 2
+
+/* Defaults to GG_CPU_JIT_OFF. GG_CPU_JIT_CHECK has only been run on the roms
+ * gg_jit_test builds, so the JIT stays off until it runs clean on real carts.
+ */
+GG_CPU_FUNC(void) GG_CPU_SetJIT(GG_CPU *cpu, unsigned mode);
+
+/* Profiling. Builds with GG_PROFILE defined count every op and the cycles it
+ * took, and how many times each address ran in each ROM bank. This always
+ * uses the plain interpreter, so it is much slower than a normal build.
+ * GG_CPU_WriteProfile writes the counts so far to a file, with each opcode and
+ * address disassembled. Returns zero on success, and always fails in a normal
+ * build.
+ */
+#define GG_CPU_PROFILE_CSV 0
+#define GG_CPU_PROFILE_JSON 1
+
+GG_CPU_FUNC(int) GG_CPU_WriteProfile(const GG_CPU *cpu,
+    void *mmu,
+    const char *path,
+    unsigned format);
+
+/* Runs for at least budget cycles, and returns how many cycles were run.
+ * This can overshoot the budget by one instruction, or by one basic block
+ * when running without a debugger. All state is stored back
+ * to the GG_CPU, so this can be called again later to resume.
+ */
+GG_CPU_FUNC(unsigned) GG_CPU_RunCycles(GG_CPU *cpu,
+    void *mmu,
+    void *gpu,
+    void *win,
+    struct GG_DBG_s *dbg,
+    on_gpu_advance_callback render_cb,
+    void *render_arg,
+    unsigned budget);
+
+/* Runs until the GPU next enters vblank. Returns how many cycles were run. */
+GG_CPU_FUNC(unsigned) GG_CPU_RunFrame(GG_CPU *cpu,
+    void *mmu,
+    void *gpu,
+    void *win,
+    struct GG_DBG_s *dbg,
+    on_gpu_advance_callback render_cb,
+    void *render_arg);
+
+/* Runs forever. If dbg is not NULL, this starts paused. */
 GG_CPU_FUNC(void) GG_CPU_Execute(GG_CPU *cpu,
     void *mmu,
     void *gpu,
     void *win,
-    void *dbg,
-    void *render_cb,
+    struct GG_DBG_s *dbg,
+    on_gpu_advance_callback render_cb,
     void *render_arg);
 
 #endif /* GG_CPU_CPU_H */
@@ -0,0 +1,165 @@
+/* Copyright (c) 2019 Emily McDonough
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "cpu_access.h"
+
+#include "cpu_dummy_meta.h"
+
+/* Every pseudo-op is defined here, so cpu_dummy.h is not used */
+
+#define GG_OPCODE(_1, _2, _3) 0
+#define GG_END_OPCODE( _ ) ,
+#define GG_PREFIX_CB( _ )
+#define GG_CB_OPCODE(_1, _2) 0
+#define GG_END_CB_OPCODE( _ ) ,
+
+#define GG_ACCESS_A GG_CPU_ACCESS_A
+#define GG_ACCESS_B GG_CPU_ACCESS_B
+#define GG_ACCESS_C GG_CPU_ACCESS_C
+#define GG_ACCESS_D GG_CPU_ACCESS_D
+#define GG_ACCESS_E GG_CPU_ACCESS_E
+#define GG_ACCESS_H GG_CPU_ACCESS_H
+#define GG_ACCESS_L GG_CPU_ACCESS_L
+#define GG_ACCESS_SP GG_CPU_ACCESS_SP
+#define GG_ACCESS_ZERO GG_CPU_ACCESS_ZERO
+#define GG_ACCESS_OPERATION GG_CPU_ACCESS_OPERATION
+#define GG_ACCESS_HALF_CARRY GG_CPU_ACCESS_HALF_CARRY
+#define GG_ACCESS_CARRY GG_CPU_ACCESS_CARRY
+#define GG_ACCESS_FLAGS \
+    (GG_CPU_ACCESS_ZERO | GG_CPU_ACCESS_OPERATION | \
+    GG_CPU_ACCESS_HALF_CARRY | GG_CPU_ACCESS_CARRY)
+#define GG_ACCESS_AF (GG_CPU_ACCESS_A | GG_ACCESS_FLAGS)
+#define GG_ACCESS_BC (GG_CPU_ACCESS_B | GG_CPU_ACCESS_C)
+#define GG_ACCESS_DE (GG_CPU_ACCESS_D | GG_CPU_ACCESS_E)
+#define GG_ACCESS_HL (GG_CPU_ACCESS_H | GG_CPU_ACCESS_L)
+#define GG_ACCESS_IP 0
+#define GG_ACCESS_TMP0 0
+#define GG_ACCESS_TMP1 0
+
+#define GG_READ( R ) | (unsigned long)(GG_ACCESS_ ## R)
+#define GG_WRITE( R ) | ((unsigned long)(GG_ACCESS_ ## R) << 16)
+#define GG_MEMORY | GG_CPU_ACCESS_MEMORY
+#define GG_OTHER | GG_CPU_ACCESS_OTHER
+
+#define GG_TMP8( N )
+#define GG_END_TMP8( N )
+#define GG_TMP16( N )
+#define GG_END_TMP16( N )
+#define GG_TIME( N )
+#define GG_NOP( )
+
+#define GG_BEGIN_IF_FLAG( N ) GG_READ( N )
+#define GG_END_IF_FLAG( N )
+#define GG_BEGIN_IF_NOT_FLAG( N ) GG_READ( N )
+#define GG_END_IF_NOT_FLAG( N )
+
+#define GG_SET_FLAG( A ) GG_WRITE( A )
+#define GG_SET_FLAG2( A, B ) GG_WRITE( A ) GG_WRITE( B )
+#define GG_SET_FLAG3( A, B, C ) GG_WRITE( A ) GG_WRITE( B ) GG_WRITE( C )
+#define GG_CLEAR_FLAG( A ) GG_WRITE( A )
+#define GG_CLEAR_FLAG2( A, B ) GG_WRITE( A ) GG_WRITE( B )
+#define GG_CLEAR_FLAG3( A, B, C ) GG_WRITE( A ) GG_WRITE( B ) GG_WRITE( C )
+
+#define GG_STOP( ) GG_OTHER
+#define GG_HALT( ) GG_OTHER
+#define GG_DISABLE_INTERRUPTS( ) GG_OTHER
+#define GG_ENABLE_INTERRUPTS( ) GG_OTHER
+#define GG_ENABLE_INTERRUPTS_DELAYED( ) GG_OTHER
+#define GG_ILLEGAL( N ) GG_OTHER
+
+#define GG_LD_IMM16( REG16 ) GG_WRITE( REG16 )
+#define GG_LD_IMM8( REG8 ) GG_WRITE( REG8 )
+#define GG_LD_REG_REG( REGA, REGB ) GG_READ( REGB ) GG_WRITE( REGA )
+#define GG_LD_REGPTR_REG8( REGPTR, REG8 ) \
+    GG_READ( REGPTR ) GG_READ( REG8 ) GG_MEMORY
+#define GG_LD_REG8_REGPTR( REG8, REGPTR ) GG_READ( REGPTR ) GG_WRITE( REG8 )
+#define GG_LD_REGPTR_REG16( REGPTR, REG16 ) \
+    GG_READ( REGPTR ) GG_READ( REG16 ) GG_MEMORY
+#define GG_LD_REG16_REGPTR( REG16, REGPTR ) GG_READ( REGPTR ) GG_WRITE( REG16 )
+#define GG_LDH_REG8PTR_REG8( REG8PTR, REG8 ) \
+    GG_READ( REG8PTR ) GG_READ( REG8 ) GG_MEMORY
+#define GG_LDH_REG8_REG8PTR( REG8, REG8PTR ) \
+    GG_READ( REG8PTR ) GG_WRITE( REG8 )
+#define GG_SAVE_SP( ) GG_READ( SP ) GG_MEMORY
+
+#define GG_POP_REG16( REG16 ) GG_READ( SP ) GG_WRITE( SP ) GG_WRITE( REG16 )
+#define GG_PUSH_REG16( REG16 ) \
+    GG_READ( REG16 ) GG_READ( SP ) GG_WRITE( SP ) GG_MEMORY
+
+#define GG_INC_REG16( REG16 ) GG_READ( REG16 ) GG_WRITE( REG16 )
+#define GG_DEC_REG16( REG16 ) GG_READ( REG16 ) GG_WRITE( REG16 )
+
+/* C is kept */
+#define GG_INC_REG8( REG8 ) \
+    GG_READ( REG8 ) GG_WRITE( REG8 ) \
+    GG_WRITE( ZERO ) GG_WRITE( OPERATION ) GG_WRITE( HALF_CARRY )
+#define GG_DEC_REG8( REG8 ) GG_INC_REG8( REG8 )
+
+#define GG_ADD_REG8_REG8( REGA, REGB ) \
+    GG_READ( REGA ) GG_READ( REGB ) GG_WRITE( REGA ) GG_WRITE( FLAGS )
+#define GG_SUB_REG8_REG8( REGA, REGB ) GG_ADD_REG8_REG8( REGA, REGB )
+#define GG_ADC_REG8_REG8( REGA, REGB ) \
+    GG_ADD_REG8_REG8( REGA, REGB ) GG_READ( CARRY )
+#define GG_SBC_REG8_REG8( REGA, REGB ) GG_ADC_REG8_REG8( REGA, REGB )
+
+/* Z is kept */
+#define GG_ADD_REG16_REG16( REGA, REGB ) \
+    GG_READ( REGA ) GG_READ( REGB ) GG_WRITE( REGA ) \
+    GG_WRITE( OPERATION ) GG_WRITE( HALF_CARRY ) GG_WRITE( CARRY )
+#define GG_SUB_REG16_REG16( REGA, REGB ) GG_ADD_REG16_REG16( REGA, REGB )
+#define GG_ADC_REG16_REG16( REGA, REGB ) \
+    GG_ADD_REG16_REG16( REGA, REGB ) GG_READ( CARRY )
+#define GG_SBC_REG16_REG16( REGA, REGB ) GG_ADC_REG16_REG16( REGA, REGB )
+
+/* Rotates and shifts overwrite every flag */
+#define GG_SHIFT_REG8( REG8 ) GG_READ( REG8 ) GG_WRITE( REG8 ) GG_WRITE( FLAGS )
+#define GG_RLC_REG8( REG8 ) GG_SHIFT_REG8( REG8 )
+#define GG_RRC_REG8( REG8 ) GG_SHIFT_REG8( REG8 )
+#define GG_RL_REG8( REG8 ) GG_SHIFT_REG8( REG8 ) GG_READ( CARRY )
+#define GG_RR_REG8( REG8 ) GG_SHIFT_REG8( REG8 ) GG_READ( CARRY )
+#define GG_SLA_REG8( REG8 ) GG_SHIFT_REG8( REG8 )
+#define GG_SRA_REG8( REG8 ) GG_SHIFT_REG8( REG8 )
+#define GG_SRL_REG8( REG8 ) GG_SHIFT_REG8( REG8 )
+#define GG_SWAP_REG8( REG8 ) GG_SHIFT_REG8( REG8 )
+
+/* C is kept */
+#define GG_BIT_REG8( BIT, REG8 ) \
+    GG_READ( REG8 ) \
+    GG_WRITE( ZERO ) GG_WRITE( OPERATION ) GG_WRITE( HALF_CARRY )
+#define GG_RES_REG8( BIT, REG8 ) GG_READ( REG8 ) GG_WRITE( REG8 )
+#define GG_SET_REG8( BIT, REG8 ) GG_READ( REG8 ) GG_WRITE( REG8 )
+
+/* Only Z is changed */
+#define GG_BITOP( REG8, OP ) GG_READ( REG8 ) GG_WRITE( REG8 ) GG_WRITE( ZERO )
+
+#define GG_CPL_REG8( REG8 ) \
+    GG_READ( REG8 ) GG_WRITE( REG8 ) \
+    GG_WRITE( OPERATION ) GG_WRITE( HALF_CARRY )
+
+/* N is kept, and used to pick the adjustment */
+#define GG_DAA( ) \
+    GG_READ( A ) GG_READ( FLAGS ) GG_WRITE( A ) \
+    GG_WRITE( ZERO ) GG_WRITE( HALF_CARRY ) GG_WRITE( CARRY )
+
+#define GG_JREL8( REG8 ) GG_READ( REG8 )
+#define GG_JMP_REG16( REG16 ) GG_READ( REG16 )
+#define GG_JMP_ABS( A )
+
+static const unsigned long cpu_opcode_access[0x101] = {
+#include "cpu.inc"
+    0
+};
+
+static const unsigned long cpu_cb_opcode_access[0x101] = {
+#include "cpu_cb.inc"
+    0
+};
+
+const unsigned long *const gg_cpu_opcode_access = cpu_opcode_access;
+const unsigned long *const _gg_cpu_opcode_access = cpu_opcode_access;
+const unsigned long *const gg_cpu_cb_opcode_access = cpu_cb_opcode_access;
+const unsigned long *const _gg_cpu_cb_opcode_access = cpu_cb_opcode_access;
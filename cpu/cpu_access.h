@@ -0,0 +1,54 @@
+/* Copyright (c) 2019 Emily McDonough
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef GG_CPU_CPU_ACCESS_H
+#define GG_CPU_CPU_ACCESS_H
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* The registers and flags each opcode reads and writes.
+ * The low 16 bits are what is read, and the same bits shifted up by 16 are
+ * what is written. A flag is only counted as written if the opcode always
+ * overwrites it, anything that keeps the old value reads it as well.
+ * The temporary registers and IP are not counted.
+ */
+#define GG_CPU_ACCESS_A 0x0001
+#define GG_CPU_ACCESS_B 0x0002
+#define GG_CPU_ACCESS_C 0x0004
+#define GG_CPU_ACCESS_D 0x0008
+#define GG_CPU_ACCESS_E 0x0010
+#define GG_CPU_ACCESS_H 0x0020
+#define GG_CPU_ACCESS_L 0x0040
+#define GG_CPU_ACCESS_SP 0x0080
+#define GG_CPU_ACCESS_ZERO 0x0100
+#define GG_CPU_ACCESS_OPERATION 0x0200
+#define GG_CPU_ACCESS_HALF_CARRY 0x0400
+#define GG_CPU_ACCESS_CARRY 0x0800
+
+#define GG_CPU_ACCESS_READS(X) ((unsigned)((X) & 0xFFFF))
+#define GG_CPU_ACCESS_WRITES(X) ((unsigned)(((X) >> 16) & 0x0FFF))
+
+/* Writes to memory */
+#define GG_CPU_ACCESS_MEMORY 0x40000000UL
+/* Changes the interrupt or halt state, or is illegal */
+#define GG_CPU_ACCESS_OTHER 0x80000000UL
+
+extern const unsigned long *const gg_cpu_opcode_access;
+extern const unsigned long *const _gg_cpu_opcode_access;
+
+/* For the second byte of CB opcodes */
+extern const unsigned long *const gg_cpu_cb_opcode_access;
+extern const unsigned long *const _gg_cpu_cb_opcode_access;
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif /* GG_CPU_CPU_ACCESS_H */
@@ -0,0 +1,235 @@
+/* Copyright (c) 2019 Emily McDonough
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "cpu_block.h"
+
+#include "cpu_access.h"
+#include "cpu_flow.h"
+#include "cpu_length.h"
+#include "cpu_timings.h"
+
+#include <stdlib.h>
+#include <assert.h>
+
+#define GG_CPU_BLOCK_PAGE(ADDR) (((ADDR) & 0xFFFF) >> GG_CPU_BLOCK_PAGE_SHIFT)
+#define GG_CPU_BLOCK_ECHO_PAGES (0x2000 >> GG_CPU_BLOCK_PAGE_SHIFT)
+
+/* Work RAM is echoed from E000, so code there has two pages */
+static unsigned gg_cpu_block_mirror_page(unsigned page){
+    if(page >= GG_CPU_BLOCK_PAGE(0xC000) &&
+        page < GG_CPU_BLOCK_PAGE(0xDE00))
+        return page + GG_CPU_BLOCK_ECHO_PAGES;
+    else if(page >= GG_CPU_BLOCK_PAGE(0xE000) &&
+        page < GG_CPU_BLOCK_PAGE(0xFE00))
+        return page - GG_CPU_BLOCK_ECHO_PAGES;
+    else
+        return page;
+}
+
+static void gg_cpu_block_mark_page(struct GG_CPU_BlockCache *cache,
+    unsigned page){
+    cache->code_pages[page] = 1;
+    cache->code_pages[gg_cpu_block_mirror_page(page)] = 1;
+}
+
+struct GG_CPU_BlockCache *gg_cpu_block_create(void){
+    /* An empty slot has a length of zero */
+    struct GG_CPU_BlockCache *const cache =
+        calloc(1, sizeof(struct GG_CPU_BlockCache));
+    if(cache != NULL)
+        cache->jit = gg_cpu_jit_create();
+    return cache;
+}
+
+void gg_cpu_block_destroy(struct GG_CPU_BlockCache *cache){
+    if(cache != NULL)
+        gg_cpu_jit_destroy(cache->jit);
+    free(cache);
+}
+
+unsigned gg_cpu_block_cycles(const struct GG_CPU_MicroOp *op,
+    const struct GG_CPU_MicroOp *end){
+    unsigned cycles = 0;
+    while(op != end){
+        if(op->opcode == 0xCB)
+            cycles += gg_cpu_cb_opcode_times[op->imm];
+        else
+            cycles += gg_cpu_opcode_times[op->opcode];
+        op++;
+    }
+    return cycles;
+}
+
+/* A block is idle if running it again with the same memory will do exactly
+ * the same thing. It can't write to memory, and every register it reads has
+ * to either be left alone, or be written by the block before it is read.
+ */
+static unsigned char gg_cpu_block_idle(const struct GG_CPU_Block *block){
+    unsigned long access[GG_CPU_BLOCK_MAX_OPS];
+    unsigned i, writes = 0, written = 0;
+    
+    for(i = 0; i < block->length; i++){
+        const struct GG_CPU_MicroOp *const op = block->ops + i;
+        access[i] = (op->opcode == 0xCB) ?
+            gg_cpu_cb_opcode_access[op->imm & 0xFF] :
+            gg_cpu_opcode_access[op->opcode];
+        if(access[i] & (GG_CPU_ACCESS_MEMORY | GG_CPU_ACCESS_OTHER))
+            return 0;
+        writes |= GG_CPU_ACCESS_WRITES(access[i]);
+    }
+    
+    for(i = 0; i < block->length; i++){
+        if(GG_CPU_ACCESS_READS(access[i]) & writes & ~written)
+            return 0;
+        written |= GG_CPU_ACCESS_WRITES(access[i]);
+    }
+    
+    return 1;
+}
+
+void gg_cpu_block_build(struct GG_CPU_BlockCache *cache,
+    struct GG_CPU_Block *block,
+    const GG_MMU *mmu,
+    unsigned address){
+
+    unsigned at = address, length = 0;
+
+    assert(block == GG_CPU_BLOCK_SLOT(cache, address));
+
+    block->address = address;
+    block->bank = GG_CPU_BLOCK_BANK(mmu, address);
+    block->hits = 0;
+    block->jit = NULL;
+
+    do{
+        const unsigned char opcode = GG_Read8MMU(mmu, at);
+        /* The 0xCB opcode is listed as one byte, the second is read by the
+         * prefix itself.
+         */
+        const unsigned size =
+            (opcode == 0xCB) ? 2 : gg_cpu_opcode_lengths[opcode];
+        struct GG_CPU_MicroOp *op;
+
+        /* The block is only keyed by the bank at its start, so an op that
+         * runs into the next region starts the next block instead. If it is
+         * the first op, it has to be decoded again every time it runs.
+         */
+        if((((at + size - 1) ^ address) & 0xC000) != 0){
+            if(length != 0)
+                break;
+            block->bank = GG_CPU_BLOCK_NO_BANK;
+        }
+
+        op = block->ops + length++;
+        op->opcode = opcode;
+
+        switch(size){
+            case 3:
+                op->imm = GG_Read16MMU(mmu, (at + 1) & 0xFFFF);
+                break;
+            case 2:
+                op->imm = GG_Read8MMU(mmu, (at + 1) & 0xFFFF);
+                break;
+            default:
+                op->imm = 0;
+        }
+        at = (at + size) & 0xFFFF;
+
+        if(gg_cpu_opcode_flow[opcode])
+            break;
+
+        /* Don't run across a bank or between ROM and RAM */
+    }while(length < GG_CPU_BLOCK_MAX_OPS && ((at ^ address) & 0xC000) == 0);
+
+    block->end = at;
+    block->length = length;
+    block->cycles = gg_cpu_block_cycles(block->ops, block->ops + length);
+    block->idle = gg_cpu_block_idle(block);
+
+    if(address >= 0x8000){
+        gg_cpu_block_mark_page(cache, GG_CPU_BLOCK_PAGE(address));
+        gg_cpu_block_mark_page(cache, GG_CPU_BLOCK_PAGE(at - 1));
+    }
+}
+
+void gg_cpu_block_compile(struct GG_CPU_BlockCache *cache,
+    struct GG_CPU_Block *block,
+    const GG_MMU *mmu){
+    
+    assert(block->length != 0);
+    
+    if(cache->jit == NULL || block->address >= 0x8000)
+        return;
+    
+    /* Start over when the code space runs out. Anything still hot will just
+     * be compiled again.
+     */
+    if(gg_cpu_jit_space(cache->jit) < GG_CPU_JIT_MAX_BLOCK_SIZE){
+        unsigned i;
+        for(i = 0; i < GG_CPU_BLOCK_SLOTS; i++){
+            cache->blocks[i].jit = NULL;
+            cache->blocks[i].hits = 0;
+        }
+        gg_cpu_jit_reset(cache->jit);
+    }
+    
+    block->jit = gg_cpu_jit_compile(cache->jit,
+        block,
+        GG_IsMMUBankFixed(mmu, 0));
+}
+
+void gg_cpu_block_invalidate(struct GG_CPU_BlockCache *cache,
+    unsigned address){
+
+    const unsigned page = GG_CPU_BLOCK_PAGE(address);
+    const unsigned mirror = gg_cpu_block_mirror_page(page);
+    unsigned i;
+
+    for(i = 0; i < GG_CPU_BLOCK_SLOTS; i++){
+        struct GG_CPU_Block *const block = cache->blocks + i;
+        const unsigned first = GG_CPU_BLOCK_PAGE(block->address);
+        const unsigned last = GG_CPU_BLOCK_PAGE(block->end - 1);
+
+        if(block->length == 0 || block->address < 0x8000)
+            continue;
+
+        if(first == page || last == page || first == mirror || last == mirror)
+            block->length = 0;
+    }
+
+    cache->code_pages[page] = 0;
+    cache->code_pages[mirror] = 0;
+}
+
+int gg_cpu_block_has_cart_ram(const struct GG_CPU_BlockCache *cache){
+    unsigned page;
+
+    for(page = GG_CPU_BLOCK_PAGE(0xA000);
+        page < GG_CPU_BLOCK_PAGE(0xC000);
+        page++){
+        if(cache->code_pages[page])
+            return 1;
+    }
+
+    return 0;
+}
+
+int gg_cpu_block_invalidate_cart_ram(struct GG_CPU_BlockCache *cache){
+    unsigned page;
+    int found = 0;
+
+    for(page = GG_CPU_BLOCK_PAGE(0xA000);
+        page < GG_CPU_BLOCK_PAGE(0xC000);
+        page++){
+        if(cache->code_pages[page]){
+            gg_cpu_block_invalidate(cache, page << GG_CPU_BLOCK_PAGE_SHIFT);
+            found = 1;
+        }
+    }
+
+    return found;
+}
@@ -0,0 +1,132 @@
+/* Copyright (c) 2019 Emily McDonough
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef GG_CPU_CPU_BLOCK_H
+#define GG_CPU_CPU_BLOCK_H
+#pragma once
+
+#include "mmu.h"
+#include "cpu_jit.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Basic block cache.
+ * A block is a straight run of instructions, ending with the first opcode
+ * that can change the flow (see cpu_flow.h). Blocks are decoded once, with
+ * their immediates already read and their base cycles already summed, so the
+ * CPU does not need to fetch from the MMU while running one.
+ *
+ * Blocks are keyed on the address and the ROM bank. Blocks decoded from RAM
+ * mark the 128-byte pages they came from, and any CPU write to a marked page
+ * throws out every block on that page. Mapper writes can swap out the
+ * cartridge RAM at A000-BFFF, so they throw out every block there.
+ */
+
+/* Must be a power of two */
+#define GG_CPU_BLOCK_SLOTS 2048
+#define GG_CPU_BLOCK_MAX_OPS 16
+
+/* Pages are small enough that HRAM code doesn't share a page with MMIO */
+#define GG_CPU_BLOCK_PAGE_SHIFT 7
+#define GG_CPU_BLOCK_PAGES (0x10000 >> GG_CPU_BLOCK_PAGE_SHIFT)
+
+/* The ROM bank mapped at ADDR. Anything that isn't ROM is bank 0, since RAM
+ * blocks are thrown out when they are written to or when the mapper swaps the
+ * cartridge RAM.
+ */
+#define GG_CPU_BLOCK_BANK(MMU, ADDR) GG_GETMMUBANK((MMU), (ADDR))
+
+/* Never matches GG_CPU_BLOCK_BANK, for a block that has to be built again
+ * every time it runs.
+ */
+#define GG_CPU_BLOCK_NO_BANK 0xFFFF
+
+/* Number of times a ROM block runs before it is compiled */
+#define GG_CPU_BLOCK_JIT_THRESHOLD 32
+
+/* Direct-mapped. Most code is in the low ROM, so fold in the upper bits. */
+#define GG_CPU_BLOCK_SLOT(CACHE, ADDR) \
+    ((CACHE)->blocks + (((ADDR) ^ ((ADDR) >> 11)) & (GG_CPU_BLOCK_SLOTS - 1)))
+
+/* Non-zero if a write to ADDR could change a cached block */
+#define GG_CPU_BLOCK_IS_CODE(CACHE, ADDR) \
+    ((CACHE)->code_pages[((ADDR) & 0xFFFF) >> GG_CPU_BLOCK_PAGE_SHIFT])
+
+struct GG_CPU_MicroOp{
+    unsigned char opcode;
+    /* Immediate operand, or the second byte of a CB opcode */
+    unsigned short imm;
+};
+
+struct GG_CPU_Block{
+    unsigned short address;
+    /* Address just past the last instruction */
+    unsigned short end;
+    /* Sum of the base cycles for every op. Taken branches add their own. */
+    unsigned short cycles;
+    unsigned short bank;
+    /* Number of ops, zero for an empty slot */
+    unsigned char length;
+    /* Times this block has run, until it is compiled */
+    unsigned short hits;
+    /* Non-zero if the block does the same thing every time it runs, as long
+     * as memory doesn't change. If it loops back to itself, it will keep
+     * doing that until an event.
+     */
+    unsigned char idle;
+    /* Compiled code for the start of the block, or NULL */
+    gg_cpu_jit_func jit;
+    struct GG_CPU_MicroOp ops[GG_CPU_BLOCK_MAX_OPS];
+};
+
+struct GG_CPU_BlockCache{
+    struct GG_CPU_Block blocks[GG_CPU_BLOCK_SLOTS];
+    unsigned char code_pages[GG_CPU_BLOCK_PAGES];
+    /* NULL if the JIT is not supported */
+    struct GG_CPU_JIT *jit;
+};
+
+struct GG_CPU_BlockCache *gg_cpu_block_create(void);
+void gg_cpu_block_destroy(struct GG_CPU_BlockCache *cache);
+
+/* Decodes the block at address into the block slot */
+void gg_cpu_block_build(struct GG_CPU_BlockCache *cache,
+    struct GG_CPU_Block *block,
+    const GG_MMU *mmu,
+    unsigned address);
+
+/* Compiles a hot block. Only ROM blocks are compiled, since RAM blocks can be
+ * thrown out by any write. Sets block->jit, which is left NULL if the block
+ * could not be compiled.
+ */
+void gg_cpu_block_compile(struct GG_CPU_BlockCache *cache,
+    struct GG_CPU_Block *block,
+    const GG_MMU *mmu);
+
+/* Throws out every block on the page address is in */
+void gg_cpu_block_invalidate(struct GG_CPU_BlockCache *cache,
+    unsigned address);
+
+/* Throws out every block in the cartridge RAM, for when the mapper changes
+ * what is mapped there. Returns non-zero if there were any.
+ */
+int gg_cpu_block_invalidate_cart_ram(struct GG_CPU_BlockCache *cache);
+
+/* Non-zero if there are any blocks in the cartridge RAM */
+int gg_cpu_block_has_cart_ram(const struct GG_CPU_BlockCache *cache);
+
+/* Base cycles for the ops from op up to end */
+unsigned gg_cpu_block_cycles(const struct GG_CPU_MicroOp *op,
+    const struct GG_CPU_MicroOp *end);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif /* GG_CPU_CPU_BLOCK_H */
@@ -0,0 +1,105 @@
+/* Copyright (c) 2019 Emily McDonough
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef GG_CPU_CPU_DEFS_H
+#define GG_CPU_CPU_DEFS_H
+#pragma once
+
+#include "cpu_sched.h"
+#include "cpu_timer.h"
+#include "cpu_profile.h"
+
+/* Layout of the GG_CPU. This is private to the CPU, but the JIT needs to know
+ * where the registers are.
+ */
+
+#define GG_REGISTER(X, Y) \
+    union { \
+        unsigned short X ## Y ; \
+        unsigned short reg; \
+        unsigned char array[2]; \
+        struct { unsigned short X ## Y ; } reg16; \
+        struct { unsigned char Y; unsigned char X; } reg8; \
+    } X ## Y
+
+#if (__STDC_VERSION__ >= 201112L)
+
+typedef _Bool gg_bool_t;
+#define GG_TRUE true
+#define GG_FALSE false
+
+#elif defined __cplusplus
+
+typedef bool gg_bool_t;
+#define GG_TRUE true
+#define GG_FALSE false
+
+#else
+
+typedef char gg_bool_t;
+#define GG_TRUE 1
+#define GG_FALSE 0
+
+#endif
+
+struct GG_CPU_s{
+    GG_REGISTER(A, F);
+    GG_REGISTER(B, C);
+    GG_REGISTER(D, E);
+    GG_REGISTER(H, L);
+    unsigned short SP;
+    unsigned short IP;
+    gg_bool_t interrupts_enabled;
+    /* Set by EI, interrupts are enabled after the next op */
+    gg_bool_t ei_delay;
+    /* Set by HALT and STOP until an interrupt is pending */
+    gg_bool_t halted;
+    
+    /* The cycle count is the scheduler's time */
+    struct GG_CPU_Scheduler sched;
+    /* When the GPU was last advanced to */
+    gg_timestamp_t gpu_time;
+    /* The time of the current MMIO access, for the handlers to catch up to */
+    gg_timestamp_t io_time;
+    struct GG_CPU_Timer timer;
+    
+    /* Created on the first run without a debugger, NULL until then. */
+    struct GG_CPU_BlockCache *blocks;
+    /* One of the GG_CPU_JIT_* modes */
+    unsigned char jit_mode;
+    /* Set by compiled code for anything the interpreter would stop for events
+     * after, such as EI or an access to a register with a handler.
+     */
+    gg_bool_t jit_stop;
+    /* Set on the copy of the CPU that GG_CPU_JIT_CHECK runs compiled code on */
+    gg_bool_t jit_checking;
+    /* For compiled code calling back into the MMU. jit_time is when the
+     * compiled code started running.
+     */
+    struct GG_MMU_s *jit_mmu;
+    gg_timestamp_t jit_time;
+    /* Created the first time GG_CPU_JIT_CHECK runs, NULL until then. */
+    struct GG_CPU_JIT_Check *jit_check;
+    
+    /* Statistics, used by the benchmark. */
+    unsigned long instructions;
+    /* Times an idle loop was skipped over */
+    unsigned long idle_skips;
+    /* Blocks GG_CPU_JIT_CHECK found to differ from the interpreter */
+    unsigned long jit_mismatches;
+#ifdef GG_PROFILE
+    /* Created on the first run, NULL until then. */
+    struct GG_CPU_Profile *profile;
+#endif
+};
+
+/* The new AF for DAA, indexed by A with the N, H, and C flags shifted up by
+ * four above it. This is in cpu.c.
+ */
+extern const unsigned short gg_cpu_daa_table[0x800];
+
+#endif /* GG_CPU_CPU_DEFS_H */
@@ -37,6 +37,7 @@
 
 #define GG_DISABLE_INTERRUPTS()
 #define GG_ENABLE_INTERRUPTS()
+#define GG_ENABLE_INTERRUPTS_DELAYED()
 #define GG_LD_IMM16( REG16 )
 #define GG_LD_IMM8( REG8 )
 #define GG_LD_REGPTR_REG8( REG16, REG8 )
@@ -59,6 +60,13 @@
 #define GG_RR_REG8( REG8 )
 #define GG_RLC_REG8( REG8 )
 #define GG_RL_REG8( REG8 )
+#define GG_SLA_REG8( REG8 )
+#define GG_SRA_REG8( REG8 )
+#define GG_SWAP_REG8( REG8 )
+#define GG_SRL_REG8( REG8 )
+#define GG_BIT_REG8( BIT, REG8 )
+#define GG_RES_REG8( BIT, REG8 )
+#define GG_SET_REG8( BIT, REG8 )
 #define GG_SAVE_SP( )
 #define GG_JREL8( REG8 )
 #define GG_DAA( )
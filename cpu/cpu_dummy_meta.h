@@ -36,6 +36,8 @@
 #define GG_OPCODE_REGPTR( N1, N2 )
 #define GG_OPCODE_REG16( N1, N2 )
 #define GG_OPCODE_REG8( N1, N2 )
+#define GG_OPCODE_BIT_REG8( N1, N2, N3 )
+#define GG_OPCODE_BIT_REGPTR( N1, N2, N3 )
 #define GG_OPCODE_REGA( N1 ) /* Indicates an opcode which is only used with a */
 #define GG_OPCODE_REGA_REG8( N1, N2 ) /* Indicates an opcode which is only used with a */
 #define GG_OPCODE_REGA_IMM8( N1 ) /* Indicates an opcode which is only used with a */
@@ -0,0 +1,56 @@
+/* Copyright (c) 2019 Emily McDonough
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "cpu_flow.h"
+
+#include "cpu_dummy.h"
+#include "cpu_dummy_meta.h"
+
+#undef GG_JREL8
+#undef GG_JMP_REG16
+#undef GG_JMP_ABS
+#undef GG_LD_IMM16
+#undef GG_POP_REG16
+#undef GG_HALT
+#undef GG_STOP
+#undef GG_ILLEGAL
+#undef GG_ENABLE_INTERRUPTS
+#undef GG_ENABLE_INTERRUPTS_DELAYED
+#undef GG_DISABLE_INTERRUPTS
+
+#define GG_OPCODE(_1, _2, _3) 0
+#define GG_END_OPCODE( _ ) ,
+#define GG_PREFIX_CB( _ )
+
+/* Only writing to IP is a change in flow */
+#define GG_FLOW_IP |1
+#define GG_FLOW_AF
+#define GG_FLOW_BC
+#define GG_FLOW_DE
+#define GG_FLOW_HL
+#define GG_FLOW_SP
+#define GG_FLOW_TMP0
+
+#define GG_JREL8( REG8 ) |1
+#define GG_JMP_REG16( REG16 ) |1
+#define GG_JMP_ABS( A ) |1
+#define GG_LD_IMM16( REG16 ) GG_FLOW_ ## REG16
+#define GG_POP_REG16( REG16 ) GG_FLOW_ ## REG16
+#define GG_HALT( ) |1
+#define GG_STOP( ) |1
+#define GG_ILLEGAL( A ) |1
+#define GG_ENABLE_INTERRUPTS( ) |1
+#define GG_ENABLE_INTERRUPTS_DELAYED( ) |1
+#define GG_DISABLE_INTERRUPTS( ) |1
+
+static unsigned char cpu_opcode_flow[0x101] = {
+#include "cpu.inc"
+    0
+};
+
+const unsigned char *const gg_cpu_opcode_flow = cpu_opcode_flow;
+const unsigned char *const _gg_cpu_opcode_flow = cpu_opcode_flow;
@@ -0,0 +1,27 @@
+/* Copyright (c) 2019 Emily McDonough
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef GG_CPU_CPU_FLOW_H
+#define GG_CPU_CPU_FLOW_H
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Non-zero for any opcode which can do something other than fall through to
+ * the next instruction. This includes jumps, calls, returns, and anything
+ * touching the interrupt or halt state.
+ */
+extern const unsigned char *const gg_cpu_opcode_flow;
+extern const unsigned char *const _gg_cpu_opcode_flow;
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif /* GG_CPU_CPU_FLOW_H */
@@ -0,0 +1,1961 @@
+/* Copyright (c) 2019 Emily McDonough
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "cpu_jit.h"
+
+#include <stddef.h>
+
+#ifdef GG_CPU_USE_JIT
+
+#include "cpu_defs.h"
+#include "cpu_block.h"
+#include "cpu_length.h"
+#include "cpu_timings.h"
+
+#include <stdlib.h>
+#include <assert.h>
+
+/* Dummy out the meta */
+#include "cpu_dummy_meta.h"
+
+/*****************************************************************************/
+/* Executable memory. This is only writable while compiling. */
+
+#define GG_CPU_JIT_CODE_SIZE 0x100000
+
+#ifdef _WIN32
+
+#include <Windows.h>
+
+static unsigned char *gg_cpu_jit_alloc(void){
+    return VirtualAlloc(NULL,
+        GG_CPU_JIT_CODE_SIZE,
+        MEM_COMMIT|MEM_RESERVE,
+        PAGE_READWRITE);
+}
+
+static void gg_cpu_jit_free(unsigned char *code){
+    VirtualFree(code, 0, MEM_RELEASE);
+}
+
+static void gg_cpu_jit_protect(unsigned char *code, int writable){
+    DWORD old;
+    VirtualProtect(code,
+        GG_CPU_JIT_CODE_SIZE,
+        writable ? PAGE_READWRITE : PAGE_EXECUTE_READ,
+        &old);
+}
+
+#else
+
+#include <unistd.h>
+#include <sys/mman.h>
+
+#ifndef MAP_ANONYMOUS
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+
+static unsigned char *gg_cpu_jit_alloc(void){
+    void *const code = mmap(NULL,
+        GG_CPU_JIT_CODE_SIZE,
+        PROT_READ|PROT_WRITE,
+        MAP_PRIVATE|MAP_ANONYMOUS,
+        -1, 0);
+    return (code == MAP_FAILED) ? NULL : code;
+}
+
+static void gg_cpu_jit_free(unsigned char *code){
+    munmap(code, GG_CPU_JIT_CODE_SIZE);
+}
+
+static void gg_cpu_jit_protect(unsigned char *code, int writable){
+    mprotect(code,
+        GG_CPU_JIT_CODE_SIZE,
+        writable ? (PROT_READ|PROT_WRITE) : (PROT_READ|PROT_EXEC));
+}
+
+#endif
+
+/*****************************************************************************/
+/* Flags */
+
+#define GG_JIT_FLAG_ZERO 0x80
+#define GG_JIT_FLAG_OPERATION 0x40
+#define GG_JIT_FLAG_HALF_CARRY 0x20
+#define GG_JIT_FLAG_CARRY 0x10
+
+/* Tables from the lahf flags to our flags. r15 points to these. */
+#define GG_JIT_TABLE_ADD 0
+#define GG_JIT_TABLE_SUB 1
+#define GG_JIT_TABLE_INC 2
+#define GG_JIT_TABLE_DEC 3
+#define GG_JIT_TABLE_BITOP 4
+#define GG_JIT_NUM_TABLES 5
+
+#define GG_JIT_LAHF_CARRY 0x01
+#define GG_JIT_LAHF_ADJUST 0x10
+#define GG_JIT_LAHF_ZERO 0x40
+
+#define GG_JIT_FLAG_Z(I) (((I) & GG_JIT_LAHF_ZERO) ? GG_JIT_FLAG_ZERO : 0)
+#define GG_JIT_FLAG_H(I) \
+    (((I) & GG_JIT_LAHF_ADJUST) ? GG_JIT_FLAG_HALF_CARRY : 0)
+#define GG_JIT_FLAG_C(I) (((I) & GG_JIT_LAHF_CARRY) ? GG_JIT_FLAG_CARRY : 0)
+
+/* Each table is built from its entry macro, in the same way as the DAA table
+ * in cpu.c
+ */
+#define GG_JIT_FLAG_ADD(I) \
+    (GG_JIT_FLAG_Z(I) | GG_JIT_FLAG_H(I) | GG_JIT_FLAG_C(I))
+#define GG_JIT_FLAG_SUB(I) (GG_JIT_FLAG_ADD(I) | GG_JIT_FLAG_OPERATION)
+#define GG_JIT_FLAG_INC(I) (GG_JIT_FLAG_Z(I) | GG_JIT_FLAG_H(I))
+#define GG_JIT_FLAG_DEC(I) (GG_JIT_FLAG_INC(I) | GG_JIT_FLAG_OPERATION)
+#define GG_JIT_FLAG_BITOP(I) GG_JIT_FLAG_Z(I)
+
+#define GG_JIT_FLAG_4(E, I) \
+    E(I), E((I) + 1), E((I) + 2), E((I) + 3)
+#define GG_JIT_FLAG_16(E, I) \
+    GG_JIT_FLAG_4(E, I), GG_JIT_FLAG_4(E, (I) + 0x4), \
+    GG_JIT_FLAG_4(E, (I) + 0x8), GG_JIT_FLAG_4(E, (I) + 0xC)
+#define GG_JIT_FLAG_64(E, I) \
+    GG_JIT_FLAG_16(E, I), GG_JIT_FLAG_16(E, (I) + 0x10), \
+    GG_JIT_FLAG_16(E, (I) + 0x20), GG_JIT_FLAG_16(E, (I) + 0x30)
+#define GG_JIT_FLAG_256(E) \
+    { GG_JIT_FLAG_64(E, 0x00), GG_JIT_FLAG_64(E, 0x40), \
+    GG_JIT_FLAG_64(E, 0x80), GG_JIT_FLAG_64(E, 0xC0) }
+
+static const unsigned char gg_jit_flag_tables[GG_JIT_NUM_TABLES][0x100] = {
+    GG_JIT_FLAG_256(GG_JIT_FLAG_ADD),
+    GG_JIT_FLAG_256(GG_JIT_FLAG_SUB),
+    GG_JIT_FLAG_256(GG_JIT_FLAG_INC),
+    GG_JIT_FLAG_256(GG_JIT_FLAG_DEC),
+    GG_JIT_FLAG_256(GG_JIT_FLAG_BITOP)
+};
+
+/*****************************************************************************/
+
+/* Exits that could jump straight into another block, but that block wasn't
+ * compiled yet. These are patched once it is.
+ */
+#define GG_CPU_JIT_MAX_LINKS 1024
+
+struct GG_CPU_JIT_Link{
+    unsigned at;
+    unsigned short address;
+    unsigned short bank;
+};
+
+struct GG_CPU_JIT{
+    unsigned char *code;
+    unsigned used;
+    /* Offset of the body for the compiled code at each ROM address plus one,
+     * or zero if there isn't any.
+     */
+    unsigned entries[0x8000];
+    unsigned short banks[0x8000];
+    unsigned num_links;
+    struct GG_CPU_JIT_Link links[GG_CPU_JIT_MAX_LINKS];
+};
+
+struct GG_CPU_JIT *gg_cpu_jit_create(void){
+    struct GG_CPU_JIT *const jit = calloc(1, sizeof(struct GG_CPU_JIT));
+    if(jit == NULL)
+        return NULL;
+    if((jit->code = gg_cpu_jit_alloc()) == NULL){
+        free(jit);
+        return NULL;
+    }
+    return jit;
+}
+
+void gg_cpu_jit_destroy(struct GG_CPU_JIT *jit){
+    if(jit != NULL){
+        gg_cpu_jit_free(jit->code);
+        free(jit);
+    }
+}
+
+unsigned gg_cpu_jit_space(const struct GG_CPU_JIT *jit){
+    return GG_CPU_JIT_CODE_SIZE - jit->used;
+}
+
+void gg_cpu_jit_reset(struct GG_CPU_JIT *jit){
+    unsigned i;
+    for(i = 0; i < 0x8000; i++)
+        jit->entries[i] = 0;
+    jit->num_links = 0;
+    jit->used = 0;
+}
+
+/*****************************************************************************/
+/* Register allocation.
+ * The register pairs live in the legacy registers so that the high halves
+ * can be used directly. That means nothing touching them can use a REX
+ * prefix, so F is kept in r9 where only flag code touches it.
+ *
+ * rdi = GG_CPU, rsi = page tables
+ * al = A, ah = scratch for lahf, r9b = F
+ * ecx = BC, edx = DE, ebx = HL, r8d = SP
+ * ebp = scratch, and the value for memory accesses
+ * r10 = scratch, r11d = the address for memory accesses
+ * r12d = cycles, r13d = ops, r14d = cycle limit for chaining blocks
+ * r15 = flag tables
+ */
+
+#define GG_JIT_R8 0x10
+#define GG_JIT_R16 0x20
+#define GG_JIT_TMP 0x40
+#define GG_JIT_IP 0x80
+#define GG_JIT_AF 0x100
+
+#define GG_JIT_CODE(R) ((R) & 0x0F)
+
+#define GG_JIT_REG_A (GG_JIT_R8|0)
+#define GG_JIT_REG_B (GG_JIT_R8|5)
+#define GG_JIT_REG_C (GG_JIT_R8|1)
+#define GG_JIT_REG_D (GG_JIT_R8|6)
+#define GG_JIT_REG_E (GG_JIT_R8|2)
+#define GG_JIT_REG_H (GG_JIT_R8|7)
+#define GG_JIT_REG_L (GG_JIT_R8|3)
+#define GG_JIT_REG_BC (GG_JIT_R16|1)
+#define GG_JIT_REG_DE (GG_JIT_R16|2)
+#define GG_JIT_REG_HL (GG_JIT_R16|3)
+#define GG_JIT_REG_SP (GG_JIT_R16|8)
+#define GG_JIT_REG_IP GG_JIT_IP
+#define GG_JIT_REG_AF GG_JIT_AF
+#define GG_JIT_REG_TMP0 (GG_JIT_TMP|0)
+#define GG_JIT_REG_TMP1 (GG_JIT_TMP|1)
+#define GG_JIT_REG_TMP2 (GG_JIT_TMP|2)
+#define GG_JIT_REG_TMP3 (GG_JIT_TMP|3)
+/* F is only ever touched by the flag emitters */
+#define GG_JIT_REG_F 0
+
+/* The stack frame under the saved registers. TMP registers that aren't
+ * immediates are words at the bottom, followed by a byte that the callouts set
+ * when the block has to end. The size keeps calls aligned.
+ */
+#define GG_JIT_FRAME_SIZE 24
+#define GG_JIT_SLOT_TMP(N) ((N) * 2)
+#define GG_JIT_SLOT_END 8
+
+/* Worst case for a single op, including two exits */
+#define GG_JIT_OP_MAX_SIZE 0x200
+
+/* The IP for an exit when a jump already stored it */
+#define GG_JIT_IP_STORED 0x10000
+
+/*****************************************************************************/
+
+struct gg_cpu_jit_state{
+    struct GG_CPU_JIT *jit;
+    const struct GG_CPU_Block *block;
+    unsigned char *code;
+    unsigned at;
+    /* Start of the code after the prologue, where chained blocks enter */
+    unsigned body;
+    /* The code every exit ends with, and the code the callouts go through */
+    unsigned tail;
+    unsigned thunk;
+    /* Start of the code for the current op, for backing out of it */
+    unsigned op_at;
+    /* Index and address of the current op */
+    unsigned index;
+    unsigned op_ip;
+    /* Where the interpreter's ip would be in the current op */
+    unsigned ip;
+    /* Base cycles for the ops before the current one, and for this one */
+    unsigned cycles;
+    unsigned op_cycles;
+    /* Immediates are known while compiling, anything else is on the stack */
+    unsigned tmp[4];
+    unsigned char tmp_known[4];
+    /* Set by jumps. The exit is written at the end of the if or op. */
+    unsigned char branch;
+    unsigned target;
+    unsigned extra;
+    /* Set if the current op calls out for a write, which can end the block */
+    unsigned char may_end;
+    /* Where to patch the jump over the body of an if, zero if not in one */
+    unsigned skip;
+    /* Non-zero if the ROM bank at 0000 can't be switched */
+    int fixed_home;
+};
+
+static void gg_jit_byte(struct gg_cpu_jit_state *st, unsigned b){
+    st->code[st->at++] = (unsigned char)b;
+}
+
+static void gg_jit_16(struct gg_cpu_jit_state *st, unsigned w){
+    gg_jit_byte(st, w);
+    gg_jit_byte(st, w >> 8);
+}
+
+static void gg_jit_32(struct gg_cpu_jit_state *st, unsigned long d){
+    gg_jit_16(st, (unsigned)(d & 0xFFFF));
+    gg_jit_16(st, (unsigned)(d >> 16));
+}
+
+static void gg_jit_64(struct gg_cpu_jit_state *st, size_t p){
+    unsigned i;
+    for(i = 0; i < 8; i++){
+        gg_jit_byte(st, (unsigned)(p & 0xFF));
+        p >>= 8;
+    }
+}
+
+static void gg_jit_ptr(struct gg_cpu_jit_state *st, const void *ptr){
+    gg_jit_64(st, (size_t)ptr);
+}
+
+/* Writes a rel32 jump target, relative to the end of the instruction */
+static void gg_jit_patch(struct gg_cpu_jit_state *st, unsigned at){
+    const unsigned long rel = st->at - (at + 4);
+    st->code[at + 0] = (unsigned char)(rel);
+    st->code[at + 1] = (unsigned char)(rel >> 8);
+    st->code[at + 2] = (unsigned char)(rel >> 16);
+    st->code[at + 3] = (unsigned char)(rel >> 24);
+}
+
+/* Writes a rel32 to code that is already written */
+static void gg_jit_rel32(struct gg_cpu_jit_state *st, unsigned to){
+    gg_jit_32(st, (unsigned long)to - (unsigned long)(st->at + 4));
+}
+
+/* Writes a jcc or jmp rel32 to be patched later, and returns where to patch */
+static unsigned gg_jit_forward(struct gg_cpu_jit_state *st, unsigned op){
+    unsigned at;
+    if(op != 0xE9)
+        gg_jit_byte(st, 0x0F);
+    gg_jit_byte(st, op);
+    at = st->at;
+    gg_jit_32(st, 0);
+    return at;
+}
+
+#define GG_JIT_JMP 0xE9
+#define GG_JIT_JE 0x84
+#define GG_JIT_JNE 0x85
+
+/* [rdi+disp32] with the given reg field */
+static void gg_jit_cpu_field(struct gg_cpu_jit_state *st,
+    unsigned reg,
+    unsigned long offset){
+    gg_jit_byte(st, 0x87 | ((reg & 7) << 3));
+    gg_jit_32(st, offset);
+}
+
+/* [rsp+disp8] with the given reg field */
+static void gg_jit_slot(struct gg_cpu_jit_state *st,
+    unsigned reg,
+    unsigned offset){
+    gg_jit_byte(st, 0x44 | ((reg & 7) << 3));
+    gg_jit_byte(st, 0x24);
+    gg_jit_byte(st, offset);
+}
+
+#define GG_JIT_OFFSET(FIELD) ((unsigned long)offsetof(struct GG_CPU_s, FIELD))
+
+/* mov byte [FIELD], imm8 */
+static void gg_jit_set_field(struct gg_cpu_jit_state *st,
+    unsigned long offset,
+    unsigned value){
+    gg_jit_byte(st, 0xC6);
+    gg_jit_cpu_field(st, 0, offset);
+    gg_jit_byte(st, value);
+}
+
+/* Stores everything back and returns. Every exit ends by jumping here, after
+ * adding to the totals and storing IP.
+ */
+static void gg_jit_tail(struct gg_cpu_jit_state *st){
+    st->tail = st->at;
+    /* mov [A], al */
+    gg_jit_byte(st, 0x88);
+    gg_jit_cpu_field(st, 0, GG_JIT_OFFSET(AF.reg8.A));
+    /* mov [F], r9b */
+    gg_jit_byte(st, 0x44); gg_jit_byte(st, 0x88);
+    gg_jit_cpu_field(st, 1, GG_JIT_OFFSET(AF.reg8.F));
+    /* mov [...], cx/dx/bx/r8w */
+    gg_jit_byte(st, 0x66); gg_jit_byte(st, 0x89);
+    gg_jit_cpu_field(st, 1, GG_JIT_OFFSET(BC));
+    gg_jit_byte(st, 0x66); gg_jit_byte(st, 0x89);
+    gg_jit_cpu_field(st, 2, GG_JIT_OFFSET(DE));
+    gg_jit_byte(st, 0x66); gg_jit_byte(st, 0x89);
+    gg_jit_cpu_field(st, 3, GG_JIT_OFFSET(HL));
+    gg_jit_byte(st, 0x66); gg_jit_byte(st, 0x44); gg_jit_byte(st, 0x89);
+    gg_jit_cpu_field(st, 0, GG_JIT_OFFSET(SP));
+    /* mov eax, r13d ; shl eax, 16 ; or eax, r12d */
+    gg_jit_byte(st, 0x44); gg_jit_byte(st, 0x89); gg_jit_byte(st, 0xE8);
+    gg_jit_byte(st, 0xC1); gg_jit_byte(st, 0xE0); gg_jit_byte(st, 0x10);
+    gg_jit_byte(st, 0x44); gg_jit_byte(st, 0x09); gg_jit_byte(st, 0xE0);
+    /* add rsp, GG_JIT_FRAME_SIZE */
+    gg_jit_byte(st, 0x48); gg_jit_byte(st, 0x83); gg_jit_byte(st, 0xC4);
+    gg_jit_byte(st, GG_JIT_FRAME_SIZE);
+#ifdef _WIN32
+    gg_jit_byte(st, 0x5F); /* pop rdi */
+    gg_jit_byte(st, 0x5E); /* pop rsi */
+#endif
+    gg_jit_byte(st, 0x41); gg_jit_byte(st, 0x5F); /* pop r15 */
+    gg_jit_byte(st, 0x41); gg_jit_byte(st, 0x5E); /* pop r14 */
+    gg_jit_byte(st, 0x41); gg_jit_byte(st, 0x5D); /* pop r13 */
+    gg_jit_byte(st, 0x41); gg_jit_byte(st, 0x5C); /* pop r12 */
+    gg_jit_byte(st, 0x5D); /* pop rbp */
+    gg_jit_byte(st, 0x5B); /* pop rbx */
+    gg_jit_byte(st, 0xC3); /* ret */
+}
+
+/* Calls the gg_cpu_jit_access in r10 with the address in r11d, and the value
+ * in the low half of ebp and the cycles for this op in the high half. Every
+ * register but ebp is kept, and the result is left in ebp. The flags in the
+ * result are handled here.
+ */
+static void gg_jit_thunk(struct gg_cpu_jit_state *st){
+    st->thunk = st->at;
+    /* push rax, rcx, rdx, rsi, rdi, r8, r9 */
+    gg_jit_byte(st, 0x50); gg_jit_byte(st, 0x51); gg_jit_byte(st, 0x52);
+    gg_jit_byte(st, 0x56); gg_jit_byte(st, 0x57);
+    gg_jit_byte(st, 0x41); gg_jit_byte(st, 0x50);
+    gg_jit_byte(st, 0x41); gg_jit_byte(st, 0x51);
+#ifdef _WIN32
+    /* mov edx, r11d ; movzx r8d, bp ; mov r9d, ebp ; shr r9d, 16 ;
+     * add r9d, r12d ; mov rcx, rdi ; sub rsp, 32 ; call r10 ; add rsp, 32
+     */
+    gg_jit_byte(st, 0x44); gg_jit_byte(st, 0x89); gg_jit_byte(st, 0xDA);
+    gg_jit_byte(st, 0x44); gg_jit_byte(st, 0x0F); gg_jit_byte(st, 0xB7);
+    gg_jit_byte(st, 0xC5);
+    gg_jit_byte(st, 0x41); gg_jit_byte(st, 0x89); gg_jit_byte(st, 0xE9);
+    gg_jit_byte(st, 0x41); gg_jit_byte(st, 0xC1); gg_jit_byte(st, 0xE9);
+    gg_jit_byte(st, 0x10);
+    gg_jit_byte(st, 0x45); gg_jit_byte(st, 0x01); gg_jit_byte(st, 0xE1);
+    gg_jit_byte(st, 0x48); gg_jit_byte(st, 0x89); gg_jit_byte(st, 0xF9);
+    gg_jit_byte(st, 0x48); gg_jit_byte(st, 0x83); gg_jit_byte(st, 0xEC);
+    gg_jit_byte(st, 0x20);
+    gg_jit_byte(st, 0x41); gg_jit_byte(st, 0xFF); gg_jit_byte(st, 0xD2);
+    gg_jit_byte(st, 0x48); gg_jit_byte(st, 0x83); gg_jit_byte(st, 0xC4);
+    gg_jit_byte(st, 0x20);
+#else
+    /* mov esi, r11d ; movzx edx, bp ; mov ecx, ebp ; shr ecx, 16 ;
+     * add ecx, r12d ; call r10
+     */
+    gg_jit_byte(st, 0x44); gg_jit_byte(st, 0x89); gg_jit_byte(st, 0xDE);
+    gg_jit_byte(st, 0x0F); gg_jit_byte(st, 0xB7); gg_jit_byte(st, 0xD5);
+    gg_jit_byte(st, 0x89); gg_jit_byte(st, 0xE9);
+    gg_jit_byte(st, 0xC1); gg_jit_byte(st, 0xE9); gg_jit_byte(st, 0x10);
+    gg_jit_byte(st, 0x44); gg_jit_byte(st, 0x01); gg_jit_byte(st, 0xE1);
+    gg_jit_byte(st, 0x41); gg_jit_byte(st, 0xFF); gg_jit_byte(st, 0xD2);
+#endif
+    /* mov ebp, eax */
+    gg_jit_byte(st, 0x89); gg_jit_byte(st, 0xC5);
+    /* pop r9, r8, rdi, rsi, rdx, rcx, rax */
+    gg_jit_byte(st, 0x41); gg_jit_byte(st, 0x59);
+    gg_jit_byte(st, 0x41); gg_jit_byte(st, 0x58);
+    gg_jit_byte(st, 0x5F); gg_jit_byte(st, 0x5E);
+    gg_jit_byte(st, 0x5A); gg_jit_byte(st, 0x59); gg_jit_byte(st, 0x58);
+    /* test ebp, STOP ; jz over ; xor r14d, r14d */
+    gg_jit_byte(st, 0xF7); gg_jit_byte(st, 0xC5);
+    gg_jit_32(st, GG_CPU_JIT_ACCESS_STOP);
+    gg_jit_byte(st, 0x74); gg_jit_byte(st, 0x03);
+    gg_jit_byte(st, 0x45); gg_jit_byte(st, 0x31); gg_jit_byte(st, 0xF6);
+    /* test ebp, END ; jz over ; mov byte [rsp+8+END], 1
+     * The return address is on the stack on top of the frame.
+     */
+    gg_jit_byte(st, 0xF7); gg_jit_byte(st, 0xC5);
+    gg_jit_32(st, GG_CPU_JIT_ACCESS_END);
+    gg_jit_byte(st, 0x74); gg_jit_byte(st, 0x05);
+    gg_jit_byte(st, 0xC6);
+    gg_jit_slot(st, 0, GG_JIT_SLOT_END + 8);
+    gg_jit_byte(st, 0x01);
+    gg_jit_byte(st, 0xC3); /* ret */
+}
+
+/* Loads everything, and then jumps over the tail and the thunk to the body */
+static void gg_jit_prologue(struct gg_cpu_jit_state *st){
+    unsigned skip;
+    gg_jit_byte(st, 0x53); /* push rbx */
+    gg_jit_byte(st, 0x55); /* push rbp */
+    gg_jit_byte(st, 0x41); gg_jit_byte(st, 0x54); /* push r12 */
+    gg_jit_byte(st, 0x41); gg_jit_byte(st, 0x55); /* push r13 */
+    gg_jit_byte(st, 0x41); gg_jit_byte(st, 0x56); /* push r14 */
+    gg_jit_byte(st, 0x41); gg_jit_byte(st, 0x57); /* push r15 */
+#ifdef _WIN32
+    gg_jit_byte(st, 0x56); /* push rsi */
+    gg_jit_byte(st, 0x57); /* push rdi */
+    /* mov r14d, r8d ; mov rdi, rcx ; mov rsi, rdx */
+    gg_jit_byte(st, 0x45); gg_jit_byte(st, 0x89); gg_jit_byte(st, 0xC6);
+    gg_jit_byte(st, 0x48); gg_jit_byte(st, 0x89); gg_jit_byte(st, 0xCF);
+    gg_jit_byte(st, 0x48); gg_jit_byte(st, 0x89); gg_jit_byte(st, 0xD6);
+#else
+    /* mov r14d, edx */
+    gg_jit_byte(st, 0x41); gg_jit_byte(st, 0x89); gg_jit_byte(st, 0xD6);
+#endif
+    /* sub rsp, GG_JIT_FRAME_SIZE ; mov byte [END], 0 */
+    gg_jit_byte(st, 0x48); gg_jit_byte(st, 0x83); gg_jit_byte(st, 0xEC);
+    gg_jit_byte(st, GG_JIT_FRAME_SIZE);
+    gg_jit_byte(st, 0xC6);
+    gg_jit_slot(st, 0, GG_JIT_SLOT_END);
+    gg_jit_byte(st, 0x00);
+    /* mov r15, imm64 */
+    gg_jit_byte(st, 0x49); gg_jit_byte(st, 0xBF);
+    gg_jit_ptr(st, gg_jit_flag_tables);
+    /* xor r12d, r12d ; xor r13d, r13d */
+    gg_jit_byte(st, 0x45); gg_jit_byte(st, 0x31); gg_jit_byte(st, 0xE4);
+    gg_jit_byte(st, 0x45); gg_jit_byte(st, 0x31); gg_jit_byte(st, 0xED);
+    /* movzx eax, byte [A] */
+    gg_jit_byte(st, 0x0F); gg_jit_byte(st, 0xB6);
+    gg_jit_cpu_field(st, 0, GG_JIT_OFFSET(AF.reg8.A));
+    /* movzx r9d, byte [F] */
+    gg_jit_byte(st, 0x44); gg_jit_byte(st, 0x0F); gg_jit_byte(st, 0xB6);
+    gg_jit_cpu_field(st, 1, GG_JIT_OFFSET(AF.reg8.F));
+    /* movzx ecx/edx/ebx/r8d, word [...] */
+    gg_jit_byte(st, 0x0F); gg_jit_byte(st, 0xB7);
+    gg_jit_cpu_field(st, 1, GG_JIT_OFFSET(BC));
+    gg_jit_byte(st, 0x0F); gg_jit_byte(st, 0xB7);
+    gg_jit_cpu_field(st, 2, GG_JIT_OFFSET(DE));
+    gg_jit_byte(st, 0x0F); gg_jit_byte(st, 0xB7);
+    gg_jit_cpu_field(st, 3, GG_JIT_OFFSET(HL));
+    gg_jit_byte(st, 0x44); gg_jit_byte(st, 0x0F); gg_jit_byte(st, 0xB7);
+    gg_jit_cpu_field(st, 0, GG_JIT_OFFSET(SP));
+    
+    skip = gg_jit_forward(st, GG_JIT_JMP);
+    gg_jit_tail(st);
+    gg_jit_thunk(st);
+    gg_jit_patch(st, skip);
+}
+
+/* Points the rel32 at the given offset in the code to another offset */
+static void gg_jit_link(unsigned char *code, unsigned at, unsigned to){
+    const unsigned long rel = (unsigned long)to - (unsigned long)(at + 4);
+    code[at + 0] = (unsigned char)(rel);
+    code[at + 1] = (unsigned char)(rel >> 8);
+    code[at + 2] = (unsigned char)(rel >> 16);
+    code[at + 3] = (unsigned char)(rel >> 24);
+}
+
+/* Chaining only goes into the fixed ROM bank, or the same bank as the block.
+ * Anything else could be a different bank by the time the exit is taken.
+ */
+static int gg_jit_can_link(const struct gg_cpu_jit_state *st, unsigned ip){
+    const struct GG_CPU_Block *const block = st->block;
+    if(ip < 0x8000 && (ip & 0xC000) == (block->address & 0xC000))
+        return 1;
+    return ip < 0x4000 && st->fixed_home;
+}
+
+static unsigned gg_jit_link_bank(const struct GG_CPU_Block *block,
+    unsigned ip){
+    return ((ip & 0xC000) == (block->address & 0xC000)) ? block->bank : 0;
+}
+
+/* Adds the cycles and ops to the totals. If chain is set and the cycle limit
+ * is not up, this jumps straight into the compiled code for ip. Otherwise,
+ * sets IP and returns through the tail. An ip of GG_JIT_IP_STORED means a
+ * jump already set IP, and never chains.
+ */
+static void gg_jit_exit(struct gg_cpu_jit_state *st,
+    unsigned ip,
+    unsigned ops,
+    unsigned cycles,
+    int chain){
+    
+    /* add r12d, imm32 ; add r13d, imm32 */
+    gg_jit_byte(st, 0x41); gg_jit_byte(st, 0x81); gg_jit_byte(st, 0xC4);
+    gg_jit_32(st, cycles);
+    gg_jit_byte(st, 0x41); gg_jit_byte(st, 0x81); gg_jit_byte(st, 0xC5);
+    gg_jit_32(st, ops);
+    
+    if(ip == GG_JIT_IP_STORED){
+        gg_jit_byte(st, GG_JIT_JMP);
+        gg_jit_rel32(st, st->tail);
+        return;
+    }
+    
+    ip &= 0xFFFF;
+    
+    if(chain && gg_jit_can_link(st, ip)){
+        struct GG_CPU_JIT *const jit = st->jit;
+        const unsigned bank = gg_jit_link_bank(st->block, ip);
+        unsigned at;
+        if(st->may_end){
+            /* cmp byte [END], 0 ; jne over the chain */
+            gg_jit_byte(st, 0x80);
+            gg_jit_slot(st, 7, GG_JIT_SLOT_END);
+            gg_jit_byte(st, 0x00);
+            gg_jit_byte(st, 0x75); gg_jit_byte(st, 0x0A);
+        }
+        /* cmp r12d, r14d ; jae over ; jmp rel32 */
+        gg_jit_byte(st, 0x45); gg_jit_byte(st, 0x39); gg_jit_byte(st, 0xF4);
+        gg_jit_byte(st, 0x73); gg_jit_byte(st, 0x05);
+        gg_jit_byte(st, 0xE9);
+        at = st->at;
+        gg_jit_32(st, 0);
+        
+        if(ip == st->block->address){
+            /* Loops back to this block */
+            gg_jit_link(jit->code, jit->used + at, jit->used + st->body);
+        }
+        else if(jit->entries[ip] != 0 && jit->banks[ip] == bank){
+            gg_jit_link(jit->code, jit->used + at, jit->entries[ip] - 1);
+        }
+        else if(jit->num_links < GG_CPU_JIT_MAX_LINKS){
+            /* Falls through to the return until it is patched */
+            struct GG_CPU_JIT_Link *const link = jit->links + jit->num_links++;
+            link->at = jit->used + at;
+            link->address = (unsigned short)ip;
+            link->bank = (unsigned short)bank;
+        }
+    }
+    
+    /* mov word [IP], imm16 ; jmp tail */
+    gg_jit_byte(st, 0x66); gg_jit_byte(st, 0xC7);
+    gg_jit_cpu_field(st, 0, GG_JIT_OFFSET(IP));
+    gg_jit_16(st, ip);
+    gg_jit_byte(st, GG_JIT_JMP);
+    gg_jit_rel32(st, st->tail);
+}
+
+/* Sets ebp to the lahf flags. This must come right after the operation. */
+static void gg_jit_lahf(struct gg_cpu_jit_state *st){
+    gg_jit_byte(st, 0x9F); /* lahf */
+    gg_jit_byte(st, 0x0F); gg_jit_byte(st, 0xB6); gg_jit_byte(st, 0xEC);
+}
+
+/* mov r9b, [r15+rbp+table] */
+static void gg_jit_mov_f_table(struct gg_cpu_jit_state *st, unsigned table){
+    gg_jit_byte(st, 0x45); gg_jit_byte(st, 0x8A);
+    gg_jit_byte(st, 0x8C); gg_jit_byte(st, 0x2F);
+    gg_jit_32(st, (unsigned long)table << 8);
+}
+
+/* or r9b, [r15+rbp+table] */
+static void gg_jit_or_f_table(struct gg_cpu_jit_state *st, unsigned table){
+    gg_jit_byte(st, 0x45); gg_jit_byte(st, 0x0A);
+    gg_jit_byte(st, 0x8C); gg_jit_byte(st, 0x2F);
+    gg_jit_32(st, (unsigned long)table << 8);
+}
+
+/* and r9b, imm8 */
+static void gg_jit_and_f(struct gg_cpu_jit_state *st, unsigned mask){
+    gg_jit_byte(st, 0x41); gg_jit_byte(st, 0x80); gg_jit_byte(st, 0xE1);
+    gg_jit_byte(st, mask);
+}
+
+/* or r9b, imm8 */
+static void gg_jit_or_f(struct gg_cpu_jit_state *st, unsigned mask){
+    gg_jit_byte(st, 0x41); gg_jit_byte(st, 0x80); gg_jit_byte(st, 0xC9);
+    gg_jit_byte(st, mask);
+}
+
+/* Sets Z in F if ebp is zero */
+static void gg_jit_zero_f(struct gg_cpu_jit_state *st){
+    /* test ebp, ebp ; jnz over ; or r9b, Z */
+    gg_jit_byte(st, 0x85); gg_jit_byte(st, 0xED);
+    gg_jit_byte(st, 0x75); gg_jit_byte(st, 0x04);
+    gg_jit_or_f(st, GG_JIT_FLAG_ZERO);
+}
+
+/*****************************************************************************/
+/* Moving values through ebp, which works with every kind of register and
+ * doesn't get in the way of the high halves.
+ */
+
+static int gg_jit_tmp_known(const struct gg_cpu_jit_state *st, unsigned r){
+    return (r & GG_JIT_TMP) && st->tmp_known[GG_JIT_CODE(r)];
+}
+
+/* ebp = an 8-bit register */
+static int gg_jit_load8(struct gg_cpu_jit_state *st, unsigned r){
+    if(r & GG_JIT_R8){
+        /* movzx ebp, r8 */
+        gg_jit_byte(st, 0x0F); gg_jit_byte(st, 0xB6);
+        gg_jit_byte(st, 0xE8 | GG_JIT_CODE(r));
+    }
+    else if(gg_jit_tmp_known(st, r)){
+        /* mov ebp, imm32 */
+        gg_jit_byte(st, 0xBD);
+        gg_jit_32(st, st->tmp[GG_JIT_CODE(r)] & 0xFF);
+    }
+    else if(r & GG_JIT_TMP){
+        /* movzx ebp, byte [tmp] */
+        gg_jit_byte(st, 0x0F); gg_jit_byte(st, 0xB6);
+        gg_jit_slot(st, 5, GG_JIT_SLOT_TMP(GG_JIT_CODE(r)));
+    }
+    else{
+        return 0;
+    }
+    return 1;
+}
+
+/* An 8-bit register = bpl. This expects nothing above the low byte of ebp.
+ * The high halves can't be used with bpl, so they are merged in as a word.
+ */
+static int gg_jit_store8(struct gg_cpu_jit_state *st, unsigned r){
+    if((r & GG_JIT_R8) && GG_JIT_CODE(r) < 4){
+        /* mov r8, bpl */
+        gg_jit_byte(st, 0x40); gg_jit_byte(st, 0x88);
+        gg_jit_byte(st, 0xE8 | GG_JIT_CODE(r));
+    }
+    else if(r & GG_JIT_R8){
+        const unsigned r32 = GG_JIT_CODE(r) - 4;
+        /* shl ebp, 8 ; and r32, 0xFFFF00FF ; or r32, ebp */
+        gg_jit_byte(st, 0xC1); gg_jit_byte(st, 0xE5); gg_jit_byte(st, 0x08);
+        gg_jit_byte(st, 0x81); gg_jit_byte(st, 0xE0 | r32);
+        gg_jit_32(st, 0xFFFF00FFUL);
+        gg_jit_byte(st, 0x09); gg_jit_byte(st, 0xE8 | r32);
+    }
+    else if(r & GG_JIT_TMP){
+        /* mov byte [tmp], bpl */
+        gg_jit_byte(st, 0x40); gg_jit_byte(st, 0x88);
+        gg_jit_slot(st, 5, GG_JIT_SLOT_TMP(GG_JIT_CODE(r)));
+        st->tmp_known[GG_JIT_CODE(r)] = 0;
+    }
+    else{
+        return 0;
+    }
+    return 1;
+}
+
+/* ebp = a 16-bit register */
+static int gg_jit_load16(struct gg_cpu_jit_state *st, unsigned r){
+    if(r & GG_JIT_R16){
+        /* movzx ebp, r16 */
+        if(GG_JIT_CODE(r) & 8)
+            gg_jit_byte(st, 0x41);
+        gg_jit_byte(st, 0x0F); gg_jit_byte(st, 0xB7);
+        gg_jit_byte(st, 0xE8 | (GG_JIT_CODE(r) & 7));
+    }
+    else if(r & GG_JIT_AF){
+        /* movzx ebp, al ; shl ebp, 8 ; or ebp, r9d */
+        gg_jit_byte(st, 0x0F); gg_jit_byte(st, 0xB6); gg_jit_byte(st, 0xE8);
+        gg_jit_byte(st, 0xC1); gg_jit_byte(st, 0xE5); gg_jit_byte(st, 0x08);
+        gg_jit_byte(st, 0x44); gg_jit_byte(st, 0x09); gg_jit_byte(st, 0xCD);
+    }
+    else if(r & GG_JIT_IP){
+        /* mov ebp, imm32 */
+        gg_jit_byte(st, 0xBD);
+        gg_jit_32(st, st->ip);
+    }
+    else if(gg_jit_tmp_known(st, r)){
+        /* mov ebp, imm32 */
+        gg_jit_byte(st, 0xBD);
+        gg_jit_32(st, st->tmp[GG_JIT_CODE(r)] & 0xFFFF);
+    }
+    else if(r & GG_JIT_TMP){
+        /* movzx ebp, word [tmp] */
+        gg_jit_byte(st, 0x0F); gg_jit_byte(st, 0xB7);
+        gg_jit_slot(st, 5, GG_JIT_SLOT_TMP(GG_JIT_CODE(r)));
+    }
+    else{
+        return 0;
+    }
+    return 1;
+}
+
+/* A 16-bit register = bp. Storing to IP is a jump that is only known when it
+ * runs.
+ */
+static int gg_jit_store16(struct gg_cpu_jit_state *st, unsigned r){
+    if(r & GG_JIT_R16){
+        /* mov r16, bp */
+        gg_jit_byte(st, 0x66);
+        if(GG_JIT_CODE(r) & 8)
+            gg_jit_byte(st, 0x41);
+        gg_jit_byte(st, 0x89);
+        gg_jit_byte(st, 0xE8 | (GG_JIT_CODE(r) & 7));
+    }
+    else if(r & GG_JIT_AF){
+        /* The low bits of F don't exist.
+         * mov r9d, ebp ; and r9d, 0xF0 ; shr ebp, 8 ; mov al, bpl
+         */
+        gg_jit_byte(st, 0x41); gg_jit_byte(st, 0x89); gg_jit_byte(st, 0xE9);
+        gg_jit_byte(st, 0x41); gg_jit_byte(st, 0x81); gg_jit_byte(st, 0xE1);
+        gg_jit_32(st, 0xF0);
+        gg_jit_byte(st, 0xC1); gg_jit_byte(st, 0xED); gg_jit_byte(st, 0x08);
+        gg_jit_byte(st, 0x40); gg_jit_byte(st, 0x88); gg_jit_byte(st, 0xE8);
+    }
+    else if(r & GG_JIT_IP){
+        /* mov [IP], bp */
+        gg_jit_byte(st, 0x66); gg_jit_byte(st, 0x89);
+        gg_jit_cpu_field(st, 5, GG_JIT_OFFSET(IP));
+        st->branch = 1;
+        st->target = GG_JIT_IP_STORED;
+    }
+    else if(r & GG_JIT_TMP){
+        /* mov word [tmp], bp */
+        gg_jit_byte(st, 0x66); gg_jit_byte(st, 0x89);
+        gg_jit_slot(st, 5, GG_JIT_SLOT_TMP(GG_JIT_CODE(r)));
+        st->tmp_known[GG_JIT_CODE(r)] = 0;
+    }
+    else{
+        return 0;
+    }
+    return 1;
+}
+
+/*****************************************************************************/
+/* Memory. Plain RAM and ROM go straight through the page tables, anything
+ * else calls out to gg_cpu_jit_read8 and friends with the address in r11d
+ * and the value in ebp.
+ */
+
+/* r11d = the address in a register */
+static int gg_jit_address(struct gg_cpu_jit_state *st, unsigned ptr){
+    if(ptr & GG_JIT_R16){
+        /* mov r11d, r32 */
+        gg_jit_byte(st, (GG_JIT_CODE(ptr) & 8) ? 0x45 : 0x41);
+        gg_jit_byte(st, 0x89);
+        gg_jit_byte(st, 0xC3 | ((GG_JIT_CODE(ptr) & 7) << 3));
+    }
+    else if(gg_jit_tmp_known(st, ptr)){
+        /* mov r11d, imm32 */
+        gg_jit_byte(st, 0x41); gg_jit_byte(st, 0xBB);
+        gg_jit_32(st, st->tmp[GG_JIT_CODE(ptr)] & 0xFFFF);
+    }
+    else if(ptr & GG_JIT_TMP){
+        /* movzx r11d, word [tmp] */
+        gg_jit_byte(st, 0x44); gg_jit_byte(st, 0x0F); gg_jit_byte(st, 0xB7);
+        gg_jit_slot(st, 3, GG_JIT_SLOT_TMP(GG_JIT_CODE(ptr)));
+    }
+    else{
+        return 0;
+    }
+    return 1;
+}
+
+/* r11d = FF00 plus an 8-bit register, for LDH */
+static int gg_jit_address_high(struct gg_cpu_jit_state *st, unsigned ptr){
+    if(gg_jit_tmp_known(st, ptr)){
+        /* mov r11d, imm32 */
+        gg_jit_byte(st, 0x41); gg_jit_byte(st, 0xBB);
+        gg_jit_32(st, 0xFF00 | (st->tmp[GG_JIT_CODE(ptr)] & 0xFF));
+        return 1;
+    }
+    if(!gg_jit_load8(st, ptr))
+        return 0;
+    /* mov r11d, ebp ; or r11d, 0xFF00 */
+    gg_jit_byte(st, 0x41); gg_jit_byte(st, 0x89); gg_jit_byte(st, 0xEB);
+    gg_jit_byte(st, 0x41); gg_jit_byte(st, 0x81); gg_jit_byte(st, 0xCB);
+    gg_jit_32(st, 0xFF00);
+    return 1;
+}
+
+/* Non-zero if the address is known to never be plain memory */
+static int gg_jit_direct(const struct gg_cpu_jit_state *st,
+    unsigned ptr,
+    int write){
+    unsigned address;
+    if(!gg_jit_tmp_known(st, ptr))
+        return 0;
+    address = st->tmp[GG_JIT_CODE(ptr)] & 0xFFFF;
+    return address >= 0xF000 || (write && address < 0x8000);
+}
+
+/* r10 = the page for r11d, jumping to the returned rel32 if it is NULL */
+static unsigned gg_jit_page(struct gg_cpu_jit_state *st, int write){
+    /* mov r10d, r11d ; shr r10d, 12 */
+    gg_jit_byte(st, 0x45); gg_jit_byte(st, 0x89); gg_jit_byte(st, 0xDA);
+    gg_jit_byte(st, 0x41); gg_jit_byte(st, 0xC1); gg_jit_byte(st, 0xEA);
+    gg_jit_byte(st, 0x0C);
+    /* mov r10, [rsi+r10*8+disp32] */
+    gg_jit_byte(st, 0x4E); gg_jit_byte(st, 0x8B); gg_jit_byte(st, 0x94);
+    gg_jit_byte(st, 0xD6);
+    gg_jit_32(st, write ? 16 * sizeof(void*) : 0);
+    /* test r10, r10 */
+    gg_jit_byte(st, 0x4D); gg_jit_byte(st, 0x85); gg_jit_byte(st, 0xD2);
+    return gg_jit_forward(st, GG_JIT_JE);
+}
+
+/* Jumps to the returned rel32 if the bits of r11d in mask are all set, for
+ * 16-bit accesses that would go over the end of a page.
+ */
+static unsigned gg_jit_page_end(struct gg_cpu_jit_state *st, unsigned mask){
+    /* mov r10d, r11d ; and r10d, mask ; cmp r10d, mask */
+    gg_jit_byte(st, 0x45); gg_jit_byte(st, 0x89); gg_jit_byte(st, 0xDA);
+    gg_jit_byte(st, 0x41); gg_jit_byte(st, 0x81); gg_jit_byte(st, 0xE2);
+    gg_jit_32(st, mask);
+    gg_jit_byte(st, 0x41); gg_jit_byte(st, 0x81); gg_jit_byte(st, 0xFA);
+    gg_jit_32(st, mask);
+    return gg_jit_forward(st, GG_JIT_JE);
+}
+
+/* Jumps to the returned rel32 if r11d is on a page with cached code */
+static unsigned gg_jit_code_page(struct gg_cpu_jit_state *st){
+    /* mov r10d, r11d ; shr r10d, SHIFT ; add r10, [blocks] ;
+     * cmp byte [r10+code_pages], 0
+     */
+    gg_jit_byte(st, 0x45); gg_jit_byte(st, 0x89); gg_jit_byte(st, 0xDA);
+    gg_jit_byte(st, 0x41); gg_jit_byte(st, 0xC1); gg_jit_byte(st, 0xEA);
+    gg_jit_byte(st, GG_CPU_BLOCK_PAGE_SHIFT);
+    gg_jit_byte(st, 0x4C); gg_jit_byte(st, 0x03);
+    gg_jit_cpu_field(st, 2, GG_JIT_OFFSET(blocks));
+    gg_jit_byte(st, 0x41); gg_jit_byte(st, 0x80); gg_jit_byte(st, 0xBA);
+    gg_jit_32(st, offsetof(struct GG_CPU_BlockCache, code_pages));
+    gg_jit_byte(st, 0x00);
+    return gg_jit_forward(st, GG_JIT_JNE);
+}
+
+/* Calls out through the thunk. Writes pass the value in ebp, reads pass
+ * nothing.
+ */
+static void gg_jit_call(struct gg_cpu_jit_state *st,
+    gg_cpu_jit_access func,
+    int write){
+    const unsigned long cycles = st->cycles + st->op_cycles + st->extra;
+    /* mov r10, imm64 */
+    gg_jit_byte(st, 0x49); gg_jit_byte(st, 0xBA);
+    gg_jit_64(st, (size_t)func);
+    /* or ebp, imm32 / mov ebp, imm32 */
+    if(write){
+        gg_jit_byte(st, 0x81); gg_jit_byte(st, 0xCD);
+    }
+    else{
+        gg_jit_byte(st, 0xBD);
+    }
+    gg_jit_32(st, cycles << 16);
+    /* call thunk */
+    gg_jit_byte(st, 0xE8);
+    gg_jit_rel32(st, st->thunk);
+}
+
+/* ebp = the byte or word at r11d. direct skips straight to the callout. */
+static void gg_jit_read(struct gg_cpu_jit_state *st, int word, int direct){
+    unsigned slow[2], num_slow = 0, done = 0;
+    if(!direct){
+        if(word)
+            slow[num_slow++] = gg_jit_page_end(st, 0xFFF);
+        slow[num_slow++] = gg_jit_page(st, 0);
+        /* movzx ebp, byte/word [r10+r11] ; jmp done */
+        gg_jit_byte(st, 0x43); gg_jit_byte(st, 0x0F);
+        gg_jit_byte(st, word ? 0xB7 : 0xB6);
+        gg_jit_byte(st, 0x2C); gg_jit_byte(st, 0x1A);
+        done = gg_jit_forward(st, GG_JIT_JMP);
+        while(num_slow != 0)
+            gg_jit_patch(st, slow[--num_slow]);
+    }
+    gg_jit_call(st, word ? gg_cpu_jit_read16 : gg_cpu_jit_read8, 0);
+    /* movzx ebp, bp/bpl, which drops the flags */
+    if(word){
+        gg_jit_byte(st, 0x0F); gg_jit_byte(st, 0xB7); gg_jit_byte(st, 0xED);
+    }
+    else{
+        gg_jit_byte(st, 0x40); gg_jit_byte(st, 0x0F); gg_jit_byte(st, 0xB6);
+        gg_jit_byte(st, 0xED);
+    }
+    if(!direct)
+        gg_jit_patch(st, done);
+}
+
+/* Writes bpl or bp to r11d. Anything on a page with cached code calls out, so
+ * that the blocks are thrown out and this block can end.
+ */
+static void gg_jit_write(struct gg_cpu_jit_state *st, int word, int direct){
+    unsigned slow[3], num_slow = 0, done = 0;
+    if(!direct){
+        /* Keeps both bytes on the same code page */
+        if(word)
+            slow[num_slow++] =
+                gg_jit_page_end(st, (1 << GG_CPU_BLOCK_PAGE_SHIFT) - 1);
+        slow[num_slow++] = gg_jit_code_page(st);
+        slow[num_slow++] = gg_jit_page(st, 1);
+        /* mov [r10+r11], bp/bpl ; jmp done */
+        if(word){
+            gg_jit_byte(st, 0x66); gg_jit_byte(st, 0x43);
+            gg_jit_byte(st, 0x89);
+        }
+        else{
+            gg_jit_byte(st, 0x43); gg_jit_byte(st, 0x88);
+        }
+        gg_jit_byte(st, 0x2C); gg_jit_byte(st, 0x1A);
+        done = gg_jit_forward(st, GG_JIT_JMP);
+        while(num_slow != 0)
+            gg_jit_patch(st, slow[--num_slow]);
+    }
+    gg_jit_call(st, word ? gg_cpu_jit_write16 : gg_cpu_jit_write8, 1);
+    st->may_end = 1;
+    if(!direct)
+        gg_jit_patch(st, done);
+}
+
+/*****************************************************************************/
+/* Emitters for the pseudo-ops. These return zero if they can't be compiled. */
+
+static int gg_jit_ld_imm8(struct gg_cpu_jit_state *st,
+    unsigned r,
+    unsigned imm){
+    if(r & GG_JIT_R8){
+        /* mov r8, imm8 */
+        gg_jit_byte(st, 0xB0 | GG_JIT_CODE(r));
+        gg_jit_byte(st, imm);
+        return 1;
+    }
+    else if(r & GG_JIT_TMP){
+        st->tmp[GG_JIT_CODE(r)] = imm & 0xFF;
+        st->tmp_known[GG_JIT_CODE(r)] = 1;
+        return 1;
+    }
+    return 0;
+}
+
+static int gg_jit_ld_imm16(struct gg_cpu_jit_state *st,
+    unsigned r,
+    unsigned imm){
+    if(r & GG_JIT_R16){
+        /* mov r16, imm16 */
+        gg_jit_byte(st, 0x66);
+        if(GG_JIT_CODE(r) & 8)
+            gg_jit_byte(st, 0x41);
+        gg_jit_byte(st, 0xB8 | (GG_JIT_CODE(r) & 7));
+        gg_jit_16(st, imm);
+        return 1;
+    }
+    else if(r & GG_JIT_IP){
+        /* The interpreter still steps over the immediate after loading IP */
+        st->branch = 1;
+        st->target = (imm + 2) & 0xFFFF;
+        return 1;
+    }
+    else if(r & GG_JIT_TMP){
+        st->tmp[GG_JIT_CODE(r)] = imm;
+        st->tmp_known[GG_JIT_CODE(r)] = 1;
+        return 1;
+    }
+    return 0;
+}
+
+static int gg_jit_ld_reg_reg(struct gg_cpu_jit_state *st,
+    unsigned a,
+    unsigned b){
+    if((a & GG_JIT_R8) && (b & GG_JIT_R8)){
+        /* mov r8, r8 */
+        gg_jit_byte(st, 0x88);
+        gg_jit_byte(st, 0xC0 | (GG_JIT_CODE(b) << 3) | GG_JIT_CODE(a));
+        return 1;
+    }
+    else if((a & GG_JIT_R8) && gg_jit_tmp_known(st, b)){
+        return gg_jit_ld_imm8(st, a, st->tmp[GG_JIT_CODE(b)]);
+    }
+    else if((a & GG_JIT_R16) && (b & GG_JIT_R16)){
+        /* mov r16, r16 */
+        const unsigned rex = 0x40 |
+            ((GG_JIT_CODE(b) & 8) ? 4 : 0) |
+            ((GG_JIT_CODE(a) & 8) ? 1 : 0);
+        gg_jit_byte(st, 0x66);
+        if(rex != 0x40)
+            gg_jit_byte(st, rex);
+        gg_jit_byte(st, 0x89);
+        gg_jit_byte(st, 0xC0 |
+            ((GG_JIT_CODE(b) & 7) << 3) |
+            (GG_JIT_CODE(a) & 7));
+        return 1;
+    }
+    else if((a & GG_JIT_R8) || (b & GG_JIT_R8)){
+        /* Anything else with a TMP register is 8-bit */
+        return gg_jit_load8(st, b) && gg_jit_store8(st, a);
+    }
+    return 0;
+}
+
+/* INC and DEC for 16-bit registers, which don't touch the flags */
+static int gg_jit_step_reg16(struct gg_cpu_jit_state *st,
+    unsigned r,
+    unsigned dec){
+    if(!(r & GG_JIT_R16))
+        return 0;
+    /* inc/dec r16 */
+    gg_jit_byte(st, 0x66);
+    if(GG_JIT_CODE(r) & 8)
+        gg_jit_byte(st, 0x41);
+    gg_jit_byte(st, 0xFF);
+    gg_jit_byte(st, (dec ? 0xC8 : 0xC0) | (GG_JIT_CODE(r) & 7));
+    return 1;
+}
+
+/* INC and DEC for 8-bit registers. The x86 zero and adjust flags are the same
+ * as the Z and H flags, and both move up by one bit. C is kept.
+ */
+static int gg_jit_step_reg8(struct gg_cpu_jit_state *st,
+    unsigned r,
+    unsigned dec){
+    if(r & GG_JIT_R8){
+        /* inc/dec r8 */
+        gg_jit_byte(st, 0xFE);
+        gg_jit_byte(st, (dec ? 0xC8 : 0xC0) | GG_JIT_CODE(r));
+    }
+    else if((r & GG_JIT_TMP) && !gg_jit_tmp_known(st, r)){
+        /* inc/dec byte [tmp] */
+        gg_jit_byte(st, 0xFE);
+        gg_jit_slot(st, dec ? 1 : 0, GG_JIT_SLOT_TMP(GG_JIT_CODE(r)));
+    }
+    else{
+        return 0;
+    }
+    gg_jit_lahf(st);
+    gg_jit_and_f(st, GG_JIT_FLAG_CARRY);
+    gg_jit_or_f_table(st, dec ? GG_JIT_TABLE_DEC : GG_JIT_TABLE_INC);
+    return 1;
+}
+
+#define GG_JIT_ADD 0
+#define GG_JIT_ADC 1
+#define GG_JIT_SUB 2
+#define GG_JIT_SBC 3
+
+/* ADD, ADC, SUB, and SBC on 8-bit registers. The interpreter's ADD and SUB
+ * include a carry of one, so they are always adc and sbb here.
+ */
+static int gg_jit_arith_reg8(struct gg_cpu_jit_state *st,
+    unsigned a,
+    unsigned b,
+    unsigned kind){
+    const unsigned sub = (kind == GG_JIT_SUB || kind == GG_JIT_SBC);
+    const int a_slot = (a & GG_JIT_TMP) && !gg_jit_tmp_known(st, a);
+    const int b_slot = (b & GG_JIT_TMP) && !gg_jit_tmp_known(st, b);
+    
+    if(!(a & GG_JIT_R8) && !a_slot)
+        return 0;
+    if(!(b & (GG_JIT_R8|GG_JIT_TMP)))
+        return 0;
+    
+    /* Only one operand can be in memory */
+    if(a_slot && b_slot){
+        /* mov bpl, byte [b] */
+        gg_jit_byte(st, 0x40); gg_jit_byte(st, 0x8A);
+        gg_jit_slot(st, 5, GG_JIT_SLOT_TMP(GG_JIT_CODE(b)));
+    }
+    
+    if(kind == GG_JIT_ADD || kind == GG_JIT_SUB){
+        gg_jit_byte(st, 0xF9); /* stc */
+    }
+    else{
+        /* bt r9d, 4 */
+        gg_jit_byte(st, 0x41); gg_jit_byte(st, 0x0F); gg_jit_byte(st, 0xBA);
+        gg_jit_byte(st, 0xE1); gg_jit_byte(st, 0x04);
+    }
+    
+    if((a & GG_JIT_R8) && (b & GG_JIT_R8)){
+        /* adc/sbb r8, r8 */
+        gg_jit_byte(st, sub ? 0x18 : 0x10);
+        gg_jit_byte(st, 0xC0 | (GG_JIT_CODE(b) << 3) | GG_JIT_CODE(a));
+    }
+    else if((a & GG_JIT_R8) && !b_slot){
+        /* adc/sbb r8, imm8 */
+        gg_jit_byte(st, 0x80);
+        gg_jit_byte(st, (sub ? 0xD8 : 0xD0) | GG_JIT_CODE(a));
+        gg_jit_byte(st, st->tmp[GG_JIT_CODE(b)]);
+    }
+    else if(a & GG_JIT_R8){
+        /* adc/sbb r8, byte [b] */
+        gg_jit_byte(st, sub ? 0x1A : 0x12);
+        gg_jit_slot(st, GG_JIT_CODE(a), GG_JIT_SLOT_TMP(GG_JIT_CODE(b)));
+    }
+    else if(b & GG_JIT_R8){
+        /* adc/sbb byte [a], r8 */
+        gg_jit_byte(st, sub ? 0x18 : 0x10);
+        gg_jit_slot(st, GG_JIT_CODE(b), GG_JIT_SLOT_TMP(GG_JIT_CODE(a)));
+    }
+    else if(!b_slot){
+        /* adc/sbb byte [a], imm8 */
+        gg_jit_byte(st, 0x80);
+        gg_jit_slot(st, sub ? 3 : 2, GG_JIT_SLOT_TMP(GG_JIT_CODE(a)));
+        gg_jit_byte(st, st->tmp[GG_JIT_CODE(b)]);
+    }
+    else{
+        /* adc/sbb byte [a], bpl */
+        gg_jit_byte(st, 0x40); gg_jit_byte(st, sub ? 0x18 : 0x10);
+        gg_jit_slot(st, 5, GG_JIT_SLOT_TMP(GG_JIT_CODE(a)));
+    }
+    
+    gg_jit_lahf(st);
+    gg_jit_mov_f_table(st, sub ? GG_JIT_TABLE_SUB : GG_JIT_TABLE_ADD);
+    return 1;
+}
+
+/* ADD for 16-bit registers. Z is kept, H and C are the carries into bits 12
+ * and 16.
+ */
+static int gg_jit_add_reg16(struct gg_cpu_jit_state *st,
+    unsigned a,
+    unsigned b){
+    if(!(a & GG_JIT_R16) || !gg_jit_load16(st, a))
+        return 0;
+    if(b & GG_JIT_R16){
+        /* movzx r10d, r16 */
+        gg_jit_byte(st, (GG_JIT_CODE(b) & 8) ? 0x45 : 0x44);
+        gg_jit_byte(st, 0x0F); gg_jit_byte(st, 0xB7);
+        gg_jit_byte(st, 0xD0 | (GG_JIT_CODE(b) & 7));
+    }
+    else if(gg_jit_tmp_known(st, b)){
+        /* mov r10d, imm32 */
+        gg_jit_byte(st, 0x41); gg_jit_byte(st, 0xBA);
+        gg_jit_32(st, st->tmp[GG_JIT_CODE(b)] & 0xFFFF);
+    }
+    else{
+        return 0;
+    }
+    /* lea r11d, [rbp+r10] ; xor ebp, r10d ; xor ebp, r11d */
+    gg_jit_byte(st, 0x46); gg_jit_byte(st, 0x8D); gg_jit_byte(st, 0x5C);
+    gg_jit_byte(st, 0x15); gg_jit_byte(st, 0x00);
+    gg_jit_byte(st, 0x44); gg_jit_byte(st, 0x31); gg_jit_byte(st, 0xD5);
+    gg_jit_byte(st, 0x44); gg_jit_byte(st, 0x31); gg_jit_byte(st, 0xDD);
+    /* mov r16, r11w */
+    gg_jit_byte(st, 0x66);
+    gg_jit_byte(st, (GG_JIT_CODE(a) & 8) ? 0x45 : 0x44);
+    gg_jit_byte(st, 0x89);
+    gg_jit_byte(st, 0xD8 | (GG_JIT_CODE(a) & 7));
+    gg_jit_and_f(st, GG_JIT_FLAG_ZERO);
+    /* mov r10d, ebp ; shr ebp, 7 ; and ebp, H ; shr r10d, 12 ; and r10d, C ;
+     * or ebp, r10d ; or r9d, ebp
+     */
+    gg_jit_byte(st, 0x41); gg_jit_byte(st, 0x89); gg_jit_byte(st, 0xEA);
+    gg_jit_byte(st, 0xC1); gg_jit_byte(st, 0xED); gg_jit_byte(st, 0x07);
+    gg_jit_byte(st, 0x83); gg_jit_byte(st, 0xE5);
+    gg_jit_byte(st, GG_JIT_FLAG_HALF_CARRY);
+    gg_jit_byte(st, 0x41); gg_jit_byte(st, 0xC1); gg_jit_byte(st, 0xEA);
+    gg_jit_byte(st, 0x0C);
+    gg_jit_byte(st, 0x41); gg_jit_byte(st, 0x83); gg_jit_byte(st, 0xE2);
+    gg_jit_byte(st, GG_JIT_FLAG_CARRY);
+    gg_jit_byte(st, 0x44); gg_jit_byte(st, 0x09); gg_jit_byte(st, 0xD5);
+    gg_jit_byte(st, 0x41); gg_jit_byte(st, 0x09); gg_jit_byte(st, 0xE9);
+    return 1;
+}
+
+#define GG_JIT_BITOP_AND 0x20
+#define GG_JIT_BITOP_OR 0x08
+#define GG_JIT_BITOP_XOR 0x30
+
+/* The interpreter's bitops work on one register, and only touch Z */
+static int gg_jit_bitop(struct gg_cpu_jit_state *st,
+    unsigned r,
+    unsigned op){
+    if(r & GG_JIT_R8){
+        /* and/or/xor r8, r8 */
+        gg_jit_byte(st, op);
+        gg_jit_byte(st, 0xC0 | (GG_JIT_CODE(r) << 3) | GG_JIT_CODE(r));
+        gg_jit_lahf(st);
+        gg_jit_and_f(st, (unsigned)~GG_JIT_FLAG_ZERO & 0xFF);
+        gg_jit_or_f_table(st, GG_JIT_TABLE_BITOP);
+    }
+    else if(gg_jit_tmp_known(st, r)){
+        if(op == GG_JIT_BITOP_XOR)
+            st->tmp[GG_JIT_CODE(r)] = 0;
+        gg_jit_and_f(st, (unsigned)~GG_JIT_FLAG_ZERO & 0xFF);
+        if((st->tmp[GG_JIT_CODE(r)] & 0xFF) == 0)
+            gg_jit_or_f(st, GG_JIT_FLAG_ZERO);
+    }
+    else if(r & GG_JIT_TMP){
+        gg_jit_and_f(st, (unsigned)~GG_JIT_FLAG_ZERO & 0xFF);
+        if(op == GG_JIT_BITOP_XOR){
+            /* mov byte [tmp], 0 */
+            gg_jit_byte(st, 0xC6);
+            gg_jit_slot(st, 0, GG_JIT_SLOT_TMP(GG_JIT_CODE(r)));
+            gg_jit_byte(st, 0x00);
+            gg_jit_or_f(st, GG_JIT_FLAG_ZERO);
+        }
+        else{
+            /* test byte [tmp], 0xFF */
+            gg_jit_byte(st, 0xF6);
+            gg_jit_slot(st, 0, GG_JIT_SLOT_TMP(GG_JIT_CODE(r)));
+            gg_jit_byte(st, 0xFF);
+            gg_jit_lahf(st);
+            gg_jit_or_f_table(st, GG_JIT_TABLE_BITOP);
+        }
+    }
+    else{
+        return 0;
+    }
+    return 1;
+}
+
+static int gg_jit_cpl(struct gg_cpu_jit_state *st, unsigned r){
+    if(!(r & GG_JIT_R8))
+        return 0;
+    /* not r8 */
+    gg_jit_byte(st, 0xF6);
+    gg_jit_byte(st, 0xD0 | GG_JIT_CODE(r));
+    gg_jit_or_f(st, GG_JIT_FLAG_OPERATION|GG_JIT_FLAG_HALF_CARRY);
+    return 1;
+}
+
+#define GG_JIT_RLC 0
+#define GG_JIT_RRC 1
+#define GG_JIT_RL 2
+#define GG_JIT_RR 3
+#define GG_JIT_SLA 4
+#define GG_JIT_SRA 5
+#define GG_JIT_SRL 6
+#define GG_JIT_SWAP 7
+
+/* Rotates and shifts, done in ebp. These match the interpreter's versions,
+ * including the ones that don't match the hardware, and set all of F.
+ */
+static int gg_jit_shift(struct gg_cpu_jit_state *st,
+    unsigned r,
+    unsigned kind){
+    if(!gg_jit_load8(st, r))
+        return 0;
+    
+    /* The carry in for RL and RR. mov r11d, r9d ; shr r11d, 4 ; and r11d, 1 */
+    if(kind == GG_JIT_RL || kind == GG_JIT_RR){
+        gg_jit_byte(st, 0x45); gg_jit_byte(st, 0x89); gg_jit_byte(st, 0xCB);
+        gg_jit_byte(st, 0x41); gg_jit_byte(st, 0xC1); gg_jit_byte(st, 0xEB);
+        gg_jit_byte(st, 0x04);
+        gg_jit_byte(st, 0x41); gg_jit_byte(st, 0x83); gg_jit_byte(st, 0xE3);
+        gg_jit_byte(st, 0x01);
+    }
+    
+    switch(kind){
+        case GG_JIT_RLC:
+        case GG_JIT_RL:
+        case GG_JIT_SLA:
+            /* C is bit 7. mov r9d, ebp ; shr r9d, 3 ; and r9d, C */
+            gg_jit_byte(st, 0x41); gg_jit_byte(st, 0x89); gg_jit_byte(st, 0xE9);
+            gg_jit_byte(st, 0x41); gg_jit_byte(st, 0xC1); gg_jit_byte(st, 0xE9);
+            gg_jit_byte(st, 0x03);
+            break;
+        case GG_JIT_RRC:
+        case GG_JIT_RR:
+        case GG_JIT_SRL:
+            /* C is bit 0. mov r9d, ebp ; shl r9d, 4 ; and r9d, C */
+            gg_jit_byte(st, 0x41); gg_jit_byte(st, 0x89); gg_jit_byte(st, 0xE9);
+            gg_jit_byte(st, 0x41); gg_jit_byte(st, 0xC1); gg_jit_byte(st, 0xE1);
+            gg_jit_byte(st, 0x04);
+            break;
+        default:
+            /* xor r9d, r9d */
+            gg_jit_byte(st, 0x45); gg_jit_byte(st, 0x31); gg_jit_byte(st, 0xC9);
+            break;
+    }
+    /* and r9d, C, which also keeps the rest of r9d clear for AF */
+    if(kind != GG_JIT_SRA && kind != GG_JIT_SWAP){
+        gg_jit_byte(st, 0x41); gg_jit_byte(st, 0x83); gg_jit_byte(st, 0xE1);
+        gg_jit_byte(st, GG_JIT_FLAG_CARRY);
+    }
+    
+    switch(kind){
+        case GG_JIT_RLC:
+            /* The interpreter moves bit 0 to bit 7, and bit 7 to bit 0.
+             * mov r10d, ebp ; shr r10d, 7 ; shl ebp, 7 ; or ebp, r10d
+             */
+            gg_jit_byte(st, 0x41); gg_jit_byte(st, 0x89); gg_jit_byte(st, 0xEA);
+            gg_jit_byte(st, 0x41); gg_jit_byte(st, 0xC1); gg_jit_byte(st, 0xEA);
+            gg_jit_byte(st, 0x07);
+            gg_jit_byte(st, 0xC1); gg_jit_byte(st, 0xE5); gg_jit_byte(st, 0x07);
+            gg_jit_byte(st, 0x44); gg_jit_byte(st, 0x09); gg_jit_byte(st, 0xD5);
+            break;
+        case GG_JIT_RRC:
+            /* ror bpl, 1 */
+            gg_jit_byte(st, 0x40); gg_jit_byte(st, 0xD0); gg_jit_byte(st, 0xCD);
+            break;
+        case GG_JIT_RL:
+            /* The interpreter moves bit 0 to bit 7, and C to bit 0.
+             * shl ebp, 7 ; or ebp, r11d
+             */
+            gg_jit_byte(st, 0xC1); gg_jit_byte(st, 0xE5); gg_jit_byte(st, 0x07);
+            gg_jit_byte(st, 0x44); gg_jit_byte(st, 0x09); gg_jit_byte(st, 0xDD);
+            break;
+        case GG_JIT_RR:
+            /* shr ebp, 1 ; shl r11d, 7 ; or ebp, r11d */
+            gg_jit_byte(st, 0xD1); gg_jit_byte(st, 0xED);
+            gg_jit_byte(st, 0x41); gg_jit_byte(st, 0xC1); gg_jit_byte(st, 0xE3);
+            gg_jit_byte(st, 0x07);
+            gg_jit_byte(st, 0x44); gg_jit_byte(st, 0x09); gg_jit_byte(st, 0xDD);
+            break;
+        case GG_JIT_SLA:
+            /* shl ebp, 1 */
+            gg_jit_byte(st, 0xD1); gg_jit_byte(st, 0xE5);
+            break;
+        case GG_JIT_SRA:
+        case GG_JIT_SRL:
+            /* shr ebp, 1 */
+            gg_jit_byte(st, 0xD1); gg_jit_byte(st, 0xED);
+            break;
+        case GG_JIT_SWAP:
+            /* rol bpl, 4 */
+            gg_jit_byte(st, 0x40); gg_jit_byte(st, 0xC0); gg_jit_byte(st, 0xC5);
+            gg_jit_byte(st, 0x04);
+            break;
+    }
+    
+    /* and ebp, 0xFF */
+    gg_jit_byte(st, 0x81); gg_jit_byte(st, 0xE5);
+    gg_jit_32(st, 0xFF);
+    if(kind >= GG_JIT_SLA)
+        gg_jit_zero_f(st);
+    return gg_jit_store8(st, r);
+}
+
+/* BIT. C is kept. */
+static int gg_jit_bit(struct gg_cpu_jit_state *st, unsigned bit, unsigned r){
+    if(!gg_jit_load8(st, r))
+        return 0;
+    gg_jit_and_f(st, GG_JIT_FLAG_CARRY);
+    gg_jit_or_f(st, GG_JIT_FLAG_ZERO|GG_JIT_FLAG_HALF_CARRY);
+    /* test ebp, mask ; jz over ; and r9b, ~Z */
+    gg_jit_byte(st, 0xF7); gg_jit_byte(st, 0xC5);
+    gg_jit_32(st, 1ul << bit);
+    gg_jit_byte(st, 0x74); gg_jit_byte(st, 0x04);
+    gg_jit_and_f(st, (unsigned)~GG_JIT_FLAG_ZERO & 0xFF);
+    return 1;
+}
+
+/* RES and SET */
+static int gg_jit_set_bit(struct gg_cpu_jit_state *st,
+    unsigned bit,
+    unsigned r,
+    int set){
+    if(!gg_jit_load8(st, r))
+        return 0;
+    /* and/or ebp, imm32 */
+    gg_jit_byte(st, 0x81);
+    gg_jit_byte(st, set ? 0xCD : 0xE5);
+    gg_jit_32(st, set ? (1ul << bit) : (0xFFul & ~(1ul << bit)));
+    return gg_jit_store8(st, r);
+}
+
+static int gg_jit_daa(struct gg_cpu_jit_state *st){
+    /* mov ebp, r9d ; and ebp, N|H|C ; shl ebp, 4 ; movzx r10d, al ;
+     * or ebp, r10d ; mov r10, table ; movzx ebp, word [r10+rbp*2]
+     */
+    gg_jit_byte(st, 0x44); gg_jit_byte(st, 0x89); gg_jit_byte(st, 0xCD);
+    gg_jit_byte(st, 0x83); gg_jit_byte(st, 0xE5);
+    gg_jit_byte(st,
+        GG_JIT_FLAG_OPERATION|GG_JIT_FLAG_HALF_CARRY|GG_JIT_FLAG_CARRY);
+    gg_jit_byte(st, 0xC1); gg_jit_byte(st, 0xE5); gg_jit_byte(st, 0x04);
+    gg_jit_byte(st, 0x44); gg_jit_byte(st, 0x0F); gg_jit_byte(st, 0xB6);
+    gg_jit_byte(st, 0xD0);
+    gg_jit_byte(st, 0x44); gg_jit_byte(st, 0x09); gg_jit_byte(st, 0xD5);
+    gg_jit_byte(st, 0x49); gg_jit_byte(st, 0xBA);
+    gg_jit_ptr(st, gg_cpu_daa_table);
+    gg_jit_byte(st, 0x41); gg_jit_byte(st, 0x0F); gg_jit_byte(st, 0xB7);
+    gg_jit_byte(st, 0x2C); gg_jit_byte(st, 0x6A);
+    return gg_jit_store16(st, GG_JIT_REG_AF);
+}
+
+/*****************************************************************************/
+/* Loads, stores, and the stack */
+
+static int gg_jit_ld_reg8_regptr(struct gg_cpu_jit_state *st,
+    unsigned r,
+    unsigned ptr){
+    const int direct = gg_jit_direct(st, ptr, 0);
+    if(!gg_jit_address(st, ptr))
+        return 0;
+    gg_jit_read(st, 0, direct);
+    return gg_jit_store8(st, r);
+}
+
+static int gg_jit_ld_regptr_reg8(struct gg_cpu_jit_state *st,
+    unsigned ptr,
+    unsigned r){
+    const int direct = gg_jit_direct(st, ptr, 1);
+    if(!gg_jit_address(st, ptr) || !gg_jit_load8(st, r))
+        return 0;
+    gg_jit_write(st, 0, direct);
+    return 1;
+}
+
+static int gg_jit_ld_reg16_regptr(struct gg_cpu_jit_state *st,
+    unsigned r,
+    unsigned ptr){
+    const int direct = gg_jit_direct(st, ptr, 0);
+    if(!gg_jit_address(st, ptr))
+        return 0;
+    gg_jit_read(st, 1, direct);
+    return gg_jit_store16(st, r);
+}
+
+static int gg_jit_ld_regptr_reg16(struct gg_cpu_jit_state *st,
+    unsigned ptr,
+    unsigned r){
+    const int direct = gg_jit_direct(st, ptr, 1);
+    if(!gg_jit_address(st, ptr) || !gg_jit_load16(st, r))
+        return 0;
+    gg_jit_write(st, 1, direct);
+    return 1;
+}
+
+/* LDH is always in page F, so it always calls out */
+static int gg_jit_ldh_read(struct gg_cpu_jit_state *st,
+    unsigned r,
+    unsigned ptr){
+    if(!gg_jit_address_high(st, ptr))
+        return 0;
+    gg_jit_read(st, 0, 1);
+    return gg_jit_store8(st, r);
+}
+
+static int gg_jit_ldh_write(struct gg_cpu_jit_state *st,
+    unsigned ptr,
+    unsigned r){
+    if(!gg_jit_address_high(st, ptr) || !gg_jit_load8(st, r))
+        return 0;
+    gg_jit_write(st, 0, 1);
+    return 1;
+}
+
+static int gg_jit_save_sp(struct gg_cpu_jit_state *st, unsigned imm){
+    st->tmp[0] = imm;
+    st->tmp_known[0] = 1;
+    return gg_jit_ld_regptr_reg16(st, GG_JIT_REG_TMP0, GG_JIT_REG_SP);
+}
+
+static int gg_jit_push(struct gg_cpu_jit_state *st, unsigned r){
+    /* sub r8w, 2 */
+    gg_jit_byte(st, 0x66); gg_jit_byte(st, 0x41); gg_jit_byte(st, 0x83);
+    gg_jit_byte(st, 0xE8); gg_jit_byte(st, 0x02);
+    return gg_jit_ld_regptr_reg16(st, GG_JIT_REG_SP, r);
+}
+
+static int gg_jit_pop(struct gg_cpu_jit_state *st, unsigned r){
+    if(!gg_jit_ld_reg16_regptr(st, r, GG_JIT_REG_SP))
+        return 0;
+    /* add r8w, 2 */
+    gg_jit_byte(st, 0x66); gg_jit_byte(st, 0x41); gg_jit_byte(st, 0x83);
+    gg_jit_byte(st, 0xC0); gg_jit_byte(st, 0x02);
+    return 1;
+}
+
+/*****************************************************************************/
+/* Control flow and interrupts */
+
+/* Anything the interpreter sets the limit for. The block still runs to the
+ * end, but doesn't chain, and the CPU stops for events afterwards.
+ */
+static void gg_jit_stop(struct gg_cpu_jit_state *st){
+    gg_jit_set_field(st, GG_JIT_OFFSET(jit_stop), 1);
+    /* xor r14d, r14d */
+    gg_jit_byte(st, 0x45); gg_jit_byte(st, 0x31); gg_jit_byte(st, 0xF6);
+}
+
+static int gg_jit_halt(struct gg_cpu_jit_state *st){
+    gg_jit_set_field(st, GG_JIT_OFFSET(halted), 1);
+    gg_jit_stop(st);
+    return 1;
+}
+
+static int gg_jit_ei(struct gg_cpu_jit_state *st){
+    gg_jit_set_field(st, GG_JIT_OFFSET(interrupts_enabled), 1);
+    gg_jit_stop(st);
+    return 1;
+}
+
+static int gg_jit_ei_delayed(struct gg_cpu_jit_state *st){
+    unsigned skip;
+    /* cmp byte [interrupts_enabled], 0 ; jne over */
+    gg_jit_byte(st, 0x80);
+    gg_jit_cpu_field(st, 7, GG_JIT_OFFSET(interrupts_enabled));
+    gg_jit_byte(st, 0x00);
+    skip = gg_jit_forward(st, GG_JIT_JNE);
+    gg_jit_set_field(st, GG_JIT_OFFSET(ei_delay), 1);
+    gg_jit_stop(st);
+    gg_jit_patch(st, skip);
+    return 1;
+}
+
+static int gg_jit_di(struct gg_cpu_jit_state *st){
+    gg_jit_set_field(st, GG_JIT_OFFSET(interrupts_enabled), 0);
+    gg_jit_set_field(st, GG_JIT_OFFSET(ei_delay), 0);
+    return 1;
+}
+
+static int gg_jit_begin_if(struct gg_cpu_jit_state *st,
+    unsigned mask,
+    unsigned if_set){
+    if(st->skip != 0)
+        return 0;
+    /* test r9b, mask ; jz/jnz over */
+    gg_jit_byte(st, 0x41); gg_jit_byte(st, 0xF6); gg_jit_byte(st, 0xC1);
+    gg_jit_byte(st, mask);
+    st->skip = gg_jit_forward(st, if_set ? GG_JIT_JE : GG_JIT_JNE);
+    return 1;
+}
+
+static int gg_jit_end_if(struct gg_cpu_jit_state *st){
+    assert(st->skip != 0);
+    if(st->branch){
+        gg_jit_exit(st,
+            st->target,
+            st->index + 1,
+            st->cycles + st->op_cycles + st->extra,
+            1);
+        st->branch = 0;
+    }
+    st->extra = 0;
+    gg_jit_patch(st, st->skip);
+    st->skip = 0;
+    return 1;
+}
+
+/* Extra cycles are only ever for taken branches */
+static int gg_jit_time(struct gg_cpu_jit_state *st, unsigned time){
+    if(st->skip == 0)
+        return 0;
+    st->extra += time;
+    return 1;
+}
+
+static int gg_jit_jrel8(struct gg_cpu_jit_state *st, unsigned r){
+    if(!gg_jit_tmp_known(st, r))
+        return 0;
+    st->branch = 1;
+    st->target = (st->ip + (signed char)st->tmp[GG_JIT_CODE(r)]) & 0xFFFF;
+    return 1;
+}
+
+static int gg_jit_jmp_reg16(struct gg_cpu_jit_state *st, unsigned r){
+    if(gg_jit_tmp_known(st, r)){
+        st->branch = 1;
+        st->target = st->tmp[GG_JIT_CODE(r)];
+        return 1;
+    }
+    return gg_jit_load16(st, r) && gg_jit_store16(st, GG_JIT_REG_IP);
+}
+
+static int gg_jit_jmp_abs(struct gg_cpu_jit_state *st, unsigned address){
+    st->branch = 1;
+    st->target = address;
+    return 1;
+}
+
+/*****************************************************************************/
+/* Macros to turn the cpu.inc into calls to the emitters */
+
+#define GG_JIT( X ) if(!(X)) goto gg_jit_unsupported;
+#define GG_JIT_UNSUPPORTED goto gg_jit_unsupported;
+
+#define GG_OPCODE(N, BYTES, CYCLES) case N: {
+#define GG_END_OPCODE(N) } break;
+
+/* The CB opcodes have their own switch after the main one */
+#define GG_PREFIX_CB()
+#define GG_CB_OPCODE(N, CYCLES) case N: {
+#define GG_END_CB_OPCODE(N) } break;
+
+#define GG_TMP8( N )
+#define GG_END_TMP8( N )
+#define GG_TMP16( N )
+#define GG_END_TMP16( N )
+
+#define GG_NOP()
+#define GG_STOP() GG_JIT(gg_jit_halt(&st))
+#define GG_HALT() GG_JIT(gg_jit_halt(&st))
+#define GG_ILLEGAL( N ) GG_JIT_UNSUPPORTED
+#define GG_ENABLE_INTERRUPTS() GG_JIT(gg_jit_ei(&st))
+#define GG_ENABLE_INTERRUPTS_DELAYED() GG_JIT(gg_jit_ei_delayed(&st))
+#define GG_DISABLE_INTERRUPTS() GG_JIT(gg_jit_di(&st))
+#define GG_DAA() GG_JIT(gg_jit_daa(&st))
+
+#define GG_SET_FLAG( FLAG_NAME ) \
+    gg_jit_or_f(&st, GG_JIT_FLAG_ ## FLAG_NAME);
+#define GG_SET_FLAG2( FLAG_NAME1, FLAG_NAME2 ) \
+    gg_jit_or_f(&st, GG_JIT_FLAG_ ## FLAG_NAME1 | GG_JIT_FLAG_ ## FLAG_NAME2);
+#define GG_SET_FLAG3( FLAG_NAME1, FLAG_NAME2, FLAG_NAME3 ) \
+    gg_jit_or_f(&st, GG_JIT_FLAG_ ## FLAG_NAME1 | \
+        GG_JIT_FLAG_ ## FLAG_NAME2 | \
+        GG_JIT_FLAG_ ## FLAG_NAME3);
+
+#define GG_CLEAR_FLAG( FLAG_NAME ) \
+    gg_jit_and_f(&st, ~(GG_JIT_FLAG_ ## FLAG_NAME) & 0xFF);
+#define GG_CLEAR_FLAG2( FLAG_NAME1, FLAG_NAME2 ) \
+    gg_jit_and_f(&st, \
+        ~(GG_JIT_FLAG_ ## FLAG_NAME1 | GG_JIT_FLAG_ ## FLAG_NAME2) & 0xFF);
+#define GG_CLEAR_FLAG3( FLAG_NAME1, FLAG_NAME2, FLAG_NAME3 ) \
+    gg_jit_and_f(&st, ~(GG_JIT_FLAG_ ## FLAG_NAME1 | \
+        GG_JIT_FLAG_ ## FLAG_NAME2 | \
+        GG_JIT_FLAG_ ## FLAG_NAME3) & 0xFF);
+
+#define GG_LD_IMM16( REG16 ) \
+    GG_JIT(gg_jit_ld_imm16(&st, GG_JIT_REG_ ## REG16, op->imm)) \
+    st.ip += 2;
+#define GG_LD_IMM8( REG8 ) \
+    GG_JIT(gg_jit_ld_imm8(&st, GG_JIT_REG_ ## REG8, op->imm)) \
+    st.ip++;
+
+#define GG_LD_REG_REG( REGA, REGB ) \
+    GG_JIT(gg_jit_ld_reg_reg(&st, GG_JIT_REG_ ## REGA, GG_JIT_REG_ ## REGB))
+#define GG_LD_REG8_REGPTR( REG8, REGPTR ) \
+    GG_JIT(gg_jit_ld_reg8_regptr(&st, \
+        GG_JIT_REG_ ## REG8, \
+        GG_JIT_REG_ ## REGPTR))
+#define GG_LD_REGPTR_REG8( REGPTR, REG8 ) \
+    GG_JIT(gg_jit_ld_regptr_reg8(&st, \
+        GG_JIT_REG_ ## REGPTR, \
+        GG_JIT_REG_ ## REG8))
+#define GG_LD_REG16_REGPTR( REG16, REGPTR ) \
+    GG_JIT(gg_jit_ld_reg16_regptr(&st, \
+        GG_JIT_REG_ ## REG16, \
+        GG_JIT_REG_ ## REGPTR))
+#define GG_LD_REGPTR_REG16( REGPTR, REG16 ) \
+    GG_JIT(gg_jit_ld_regptr_reg16(&st, \
+        GG_JIT_REG_ ## REGPTR, \
+        GG_JIT_REG_ ## REG16))
+#define GG_LDH_REG8PTR_REG8( REG8PTR, REG8 ) \
+    GG_JIT(gg_jit_ldh_write(&st, \
+        GG_JIT_REG_ ## REG8PTR, \
+        GG_JIT_REG_ ## REG8))
+#define GG_LDH_REG8_REG8PTR( REG8, REG8PTR ) \
+    GG_JIT(gg_jit_ldh_read(&st, \
+        GG_JIT_REG_ ## REG8, \
+        GG_JIT_REG_ ## REG8PTR))
+#define GG_SAVE_SP() \
+    GG_JIT(gg_jit_save_sp(&st, op->imm)) \
+    st.ip += 2;
+#define GG_POP_REG16( REG16 ) \
+    GG_JIT(gg_jit_pop(&st, GG_JIT_REG_ ## REG16))
+#define GG_PUSH_REG16( REG16 ) \
+    GG_JIT(gg_jit_push(&st, GG_JIT_REG_ ## REG16))
+
+#define GG_INC_REG16( REG16 ) \
+    GG_JIT(gg_jit_step_reg16(&st, GG_JIT_REG_ ## REG16, 0))
+#define GG_DEC_REG16( REG16 ) \
+    GG_JIT(gg_jit_step_reg16(&st, GG_JIT_REG_ ## REG16, 1))
+#define GG_INC_REG8( REG8 ) \
+    GG_JIT(gg_jit_step_reg8(&st, GG_JIT_REG_ ## REG8, 0))
+#define GG_DEC_REG8( REG8 ) \
+    GG_JIT(gg_jit_step_reg8(&st, GG_JIT_REG_ ## REG8, 1))
+#define GG_CPL_REG8( REG8 ) \
+    GG_JIT(gg_jit_cpl(&st, GG_JIT_REG_ ## REG8))
+
+#define GG_ADD_REG8_REG8( REG8_A, REG8_B ) GG_JIT(gg_jit_arith_reg8(&st, \
+    GG_JIT_REG_ ## REG8_A, GG_JIT_REG_ ## REG8_B, GG_JIT_ADD))
+#define GG_ADC_REG8_REG8( REG8_A, REG8_B ) GG_JIT(gg_jit_arith_reg8(&st, \
+    GG_JIT_REG_ ## REG8_A, GG_JIT_REG_ ## REG8_B, GG_JIT_ADC))
+#define GG_SUB_REG8_REG8( REG8_A, REG8_B ) GG_JIT(gg_jit_arith_reg8(&st, \
+    GG_JIT_REG_ ## REG8_A, GG_JIT_REG_ ## REG8_B, GG_JIT_SUB))
+#define GG_SBC_REG8_REG8( REG8_A, REG8_B ) GG_JIT(gg_jit_arith_reg8(&st, \
+    GG_JIT_REG_ ## REG8_A, GG_JIT_REG_ ## REG8_B, GG_JIT_SBC))
+
+#define GG_ADD_REG16_REG16( REG16_A, REG16_B ) GG_JIT(gg_jit_add_reg16(&st, \
+    GG_JIT_REG_ ## REG16_A, GG_JIT_REG_ ## REG16_B))
+/* Not used by cpu.inc */
+#define GG_SUB_REG16_REG16( REG16_A, REG16_B ) GG_JIT_UNSUPPORTED
+#define GG_ADC_REG16_REG16( REG16_A, REG16_B ) GG_JIT_UNSUPPORTED
+#define GG_SBC_REG16_REG16( REG16_A, REG16_B ) GG_JIT_UNSUPPORTED
+
+#define GG_RLC_REG8( REG8 ) \
+    GG_JIT(gg_jit_shift(&st, GG_JIT_REG_ ## REG8, GG_JIT_RLC))
+#define GG_RRC_REG8( REG8 ) \
+    GG_JIT(gg_jit_shift(&st, GG_JIT_REG_ ## REG8, GG_JIT_RRC))
+#define GG_RL_REG8( REG8 ) \
+    GG_JIT(gg_jit_shift(&st, GG_JIT_REG_ ## REG8, GG_JIT_RL))
+#define GG_RR_REG8( REG8 ) \
+    GG_JIT(gg_jit_shift(&st, GG_JIT_REG_ ## REG8, GG_JIT_RR))
+#define GG_SLA_REG8( REG8 ) \
+    GG_JIT(gg_jit_shift(&st, GG_JIT_REG_ ## REG8, GG_JIT_SLA))
+#define GG_SRA_REG8( REG8 ) \
+    GG_JIT(gg_jit_shift(&st, GG_JIT_REG_ ## REG8, GG_JIT_SRA))
+#define GG_SRL_REG8( REG8 ) \
+    GG_JIT(gg_jit_shift(&st, GG_JIT_REG_ ## REG8, GG_JIT_SRL))
+#define GG_SWAP_REG8( REG8 ) \
+    GG_JIT(gg_jit_shift(&st, GG_JIT_REG_ ## REG8, GG_JIT_SWAP))
+#define GG_BIT_REG8( BIT, REG8 ) \
+    GG_JIT(gg_jit_bit(&st, BIT, GG_JIT_REG_ ## REG8))
+#define GG_RES_REG8( BIT, REG8 ) \
+    GG_JIT(gg_jit_set_bit(&st, BIT, GG_JIT_REG_ ## REG8, 0))
+#define GG_SET_REG8( BIT, REG8 ) \
+    GG_JIT(gg_jit_set_bit(&st, BIT, GG_JIT_REG_ ## REG8, 1))
+
+#define GG_BITOP( REG, OP ) \
+    GG_JIT(gg_jit_bitop(&st, GG_JIT_REG_ ## REG, GG_JIT_BITOP_ ## OP))
+
+#define GG_BEGIN_IF_FLAG( FLAG_NAME ) \
+    GG_JIT(gg_jit_begin_if(&st, GG_JIT_FLAG_ ## FLAG_NAME, 1))
+#define GG_END_IF_FLAG( FLAG_NAME ) \
+    gg_jit_end_if(&st);
+#define GG_BEGIN_IF_NOT_FLAG( FLAG_NAME ) \
+    GG_JIT(gg_jit_begin_if(&st, GG_JIT_FLAG_ ## FLAG_NAME, 0))
+#define GG_END_IF_NOT_FLAG( FLAG_NAME ) \
+    gg_jit_end_if(&st);
+
+#define GG_TIME( TIME ) GG_JIT(gg_jit_time(&st, TIME))
+#define GG_JREL8( REG8 ) GG_JIT(gg_jit_jrel8(&st, GG_JIT_REG_ ## REG8))
+#define GG_JMP_REG16( REG16 ) \
+    GG_JIT(gg_jit_jmp_reg16(&st, GG_JIT_REG_ ## REG16))
+#define GG_JMP_ABS( VAL ) GG_JIT(gg_jit_jmp_abs(&st, VAL))
+
+/* Patches every waiting exit into the code that was just compiled */
+static void gg_jit_link_waiting(struct GG_CPU_JIT *jit,
+    unsigned address,
+    unsigned bank){
+    unsigned i = 0;
+    while(i < jit->num_links){
+        struct GG_CPU_JIT_Link *const link = jit->links + i;
+        if(link->address == address && link->bank == bank){
+            gg_jit_link(jit->code, link->at, jit->entries[address] - 1);
+            *link = jit->links[--jit->num_links];
+        }
+        else{
+            i++;
+        }
+    }
+}
+
+gg_cpu_jit_func gg_cpu_jit_compile(struct GG_CPU_JIT *jit,
+    const struct GG_CPU_Block *block,
+    int fixed_home){
+    
+    struct gg_cpu_jit_state st;
+    unsigned ip = block->address;
+    const unsigned num_links = jit->num_links;
+    unsigned op_links;
+    union {
+        unsigned char *code;
+        gg_cpu_jit_func func;
+    } result;
+    
+    assert(gg_cpu_jit_space(jit) >= GG_CPU_JIT_MAX_BLOCK_SIZE);
+    assert(block->address < 0x8000);
+    /* The emitters store gg_bool_t fields as bytes */
+    assert(sizeof(gg_bool_t) == 1);
+    
+    st.jit = jit;
+    st.block = block;
+    st.fixed_home = fixed_home;
+    st.code = jit->code + jit->used;
+    st.at = 0;
+    st.skip = 0;
+    st.cycles = 0;
+    st.may_end = 0;
+    
+    gg_cpu_jit_protect(jit->code, 1);
+    
+    gg_jit_prologue(&st);
+    st.body = st.at;
+    
+    /* The block may have been thrown out of the cache and rebuilt, but the
+     * code for it is still good.
+     */
+    if(jit->entries[block->address] != 0 &&
+        jit->banks[block->address] == block->bank){
+        result.code = jit->code + (jit->entries[block->address] - 1) - st.body;
+        gg_cpu_jit_protect(jit->code, 0);
+        return result.func;
+    }
+    
+    for(st.index = 0; st.index < block->length; st.index++){
+        const struct GG_CPU_MicroOp *const op = block->ops + st.index;
+        unsigned next_ip;
+        
+        if(st.at + GG_JIT_OP_MAX_SIZE > GG_CPU_JIT_MAX_BLOCK_SIZE)
+            break;
+        
+        st.op_at = st.at;
+        st.op_ip = ip;
+        st.ip = (ip + 1) & 0xFFFF;
+        st.op_cycles = (op->opcode == 0xCB) ?
+            gg_cpu_cb_opcode_times[op->imm & 0xFF] :
+            gg_cpu_opcode_times[op->opcode];
+        st.tmp_known[0] = st.tmp_known[1] = 0;
+        st.tmp_known[2] = st.tmp_known[3] = 0;
+        st.branch = 0;
+        st.extra = 0;
+        st.may_end = 0;
+        op_links = jit->num_links;
+        next_ip = (ip + ((op->opcode == 0xCB) ?
+            2 : gg_cpu_opcode_lengths[op->opcode])) & 0xFFFF;
+        
+        switch(op->opcode){
+#include "cpu.inc"
+        }
+        
+        if(op->opcode == 0xCB){
+            switch(op->imm & 0xFF){
+#include "cpu_cb.inc"
+            }
+        }
+        
+        assert(st.at - st.op_at <= GG_JIT_OP_MAX_SIZE);
+        
+        /* Anything that jumps always ends the block */
+        if(st.branch){
+            gg_jit_exit(&st,
+                st.target,
+                st.index + 1,
+                st.cycles + st.op_cycles,
+                1);
+            st.index = block->length + 1;
+            break;
+        }
+        
+        /* A write over cached code ends the block after the op */
+        if(st.may_end){
+            unsigned skip;
+            /* cmp byte [END], 0 ; je over */
+            gg_jit_byte(&st, 0x80);
+            gg_jit_slot(&st, 7, GG_JIT_SLOT_END);
+            gg_jit_byte(&st, 0x00);
+            skip = gg_jit_forward(&st, GG_JIT_JE);
+            st.may_end = 0;
+            gg_jit_exit(&st,
+                next_ip,
+                st.index + 1,
+                st.cycles + st.op_cycles,
+                0);
+            gg_jit_patch(&st, skip);
+        }
+        
+        st.cycles += st.op_cycles;
+        ip = next_ip;
+        continue;
+        
+gg_jit_unsupported:
+        /* Throw out anything this op started, the interpreter runs it. */
+        st.at = st.op_at;
+        st.skip = 0;
+        jit->num_links = op_links;
+        break;
+    }
+    
+    /* Stopping partway costs more than just interpreting the block */
+    if(st.index < block->length){
+        jit->num_links = num_links;
+        gg_cpu_jit_protect(jit->code, 0);
+        return NULL;
+    }
+    
+    if(st.index == block->length)
+        gg_jit_exit(&st, ip, st.index, st.cycles, 1);
+    
+    assert(st.at <= GG_CPU_JIT_MAX_BLOCK_SIZE);
+    
+    jit->entries[block->address] = jit->used + st.body + 1;
+    jit->banks[block->address] = block->bank;
+    gg_jit_link_waiting(jit, block->address, block->bank);
+    
+    result.code = st.code;
+    jit->used += (st.at + 15) & ~15u;
+    gg_cpu_jit_protect(jit->code, 0);
+    return result.func;
+}
+
+#else
+
+struct GG_CPU_JIT *gg_cpu_jit_create(void){
+    return NULL;
+}
+
+void gg_cpu_jit_destroy(struct GG_CPU_JIT *jit){
+    (void)jit;
+}
+
+unsigned gg_cpu_jit_space(const struct GG_CPU_JIT *jit){
+    (void)jit;
+    return 0;
+}
+
+void gg_cpu_jit_reset(struct GG_CPU_JIT *jit){
+    (void)jit;
+}
+
+gg_cpu_jit_func gg_cpu_jit_compile(struct GG_CPU_JIT *jit,
+    const struct GG_CPU_Block *block,
+    int fixed_home){
+    (void)jit;
+    (void)block;
+    (void)fixed_home;
+    return NULL;
+}
+
+#endif /* GG_CPU_USE_JIT */
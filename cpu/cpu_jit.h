@@ -0,0 +1,117 @@
+/* Copyright (c) 2019 Emily McDonough
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef GG_CPU_CPU_JIT_H
+#define GG_CPU_CPU_JIT_H
+#pragma once
+
+#include "cpu.h"
+/* GG_PROFILE turns off the block cache, and with it the JIT */
+#include "cpu_profile.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* x86-64 JIT for hot ROM blocks.
+ * The opcodes are compiled from cpu.inc and cpu_cb.inc, the same as the
+ * interpreter. Plain memory is read and written through the page tables, and
+ * anything else calls back into the CPU to go through the MMU. Blocks with an
+ * illegal opcode are left to the interpreter.
+ */
+#if (defined __x86_64__ || defined _M_X64) && \
+    (defined __unix || defined _WIN32) && \
+    (!defined GG_NO_JIT) && (!defined GG_NO_BLOCK_CACHE)
+#define GG_CPU_USE_JIT
+#endif
+
+/* Enough for the largest block we can compile */
+#define GG_CPU_JIT_MAX_BLOCK_SIZE 0x2000
+
+struct GG_CPU_Block;
+struct GG_CPU_JIT;
+
+/* Compiled blocks jump straight into each other until at least this many
+ * cycles have run. This keeps the GPU from falling too far behind.
+ */
+#define GG_CPU_JIT_CHAIN_CYCLES 128
+
+/* Compiled blocks take the GG_CPU with the registers stored, the page tables
+ * from GG_GetMMUPages, and the cycle limit for chaining. A limit of zero runs a
+ * single block. The registers and IP are written back to the GG_CPU, and this
+ * returns the number of ops that ran in the high half and the number of
+ * cycles in the low half. jit_mmu and jit_time must be set in the GG_CPU, and
+ * jit_stop is set if the CPU has to stop for events afterwards.
+ */
+typedef unsigned (*gg_cpu_jit_func)(GG_CPU *cpu,
+    const unsigned char *const *pages,
+    unsigned limit);
+
+#define GG_CPU_JIT_OPS(RESULT) ((RESULT) >> 16)
+#define GG_CPU_JIT_CYCLES(RESULT) ((RESULT) & 0xFFFF)
+
+/* Callouts from compiled code for memory that isn't plain RAM or ROM, in
+ * cpu.c. These do the same checks as the interpreter does for an access, with
+ * the time taken from the cycles the compiled code has run so far. Reads
+ * return the value in the low bits, and every callout can add these flags.
+ */
+
+/* Compiled code must not chain into another block, since the CPU has to stop
+ * for events or the mapper might have switched banks.
+ */
+#define GG_CPU_JIT_ACCESS_STOP 0x10000
+/* A cached block was written over, so the current block ends after this op */
+#define GG_CPU_JIT_ACCESS_END 0x20000
+
+typedef unsigned (*gg_cpu_jit_access)(GG_CPU *cpu,
+    unsigned address,
+    unsigned value,
+    unsigned cycles);
+
+unsigned gg_cpu_jit_read8(GG_CPU *cpu,
+    unsigned address,
+    unsigned value,
+    unsigned cycles);
+unsigned gg_cpu_jit_read16(GG_CPU *cpu,
+    unsigned address,
+    unsigned value,
+    unsigned cycles);
+unsigned gg_cpu_jit_write8(GG_CPU *cpu,
+    unsigned address,
+    unsigned value,
+    unsigned cycles);
+unsigned gg_cpu_jit_write16(GG_CPU *cpu,
+    unsigned address,
+    unsigned value,
+    unsigned cycles);
+
+/* Returns NULL if the JIT isn't supported, or executable memory could not be
+ * allocated.
+ */
+struct GG_CPU_JIT *gg_cpu_jit_create(void);
+void gg_cpu_jit_destroy(struct GG_CPU_JIT *jit);
+
+/* Bytes left for compiled code */
+unsigned gg_cpu_jit_space(const struct GG_CPU_JIT *jit);
+
+/* Throws out all compiled code */
+void gg_cpu_jit_reset(struct GG_CPU_JIT *jit);
+
+/* Returns NULL if the block could not be compiled. There must be
+ * GG_CPU_JIT_MAX_BLOCK_SIZE space. Only ROM blocks can be compiled. Blocks
+ * only chain into the ROM at 0000 if fixed_home is set, since large MBC1
+ * carts can switch that bank too.
+ */
+gg_cpu_jit_func gg_cpu_jit_compile(struct GG_CPU_JIT *jit,
+    const struct GG_CPU_Block *block,
+    int fixed_home);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif /* GG_CPU_CPU_JIT_H */
@@ -0,0 +1,184 @@
+/* Copyright (c) 2019 Emily McDonough
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "cpu_profile.h"
+
+#ifdef GG_PROFILE
+
+#include "cpu.h"
+#include "mmu.h"
+#include "dbg_core.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+
+struct GG_CPU_Profile *gg_cpu_profile_create(void){
+    return calloc(1, sizeof(struct GG_CPU_Profile));
+}
+
+void gg_cpu_profile_destroy(struct GG_CPU_Profile *profile){
+    unsigned i;
+    if(profile == NULL)
+        return;
+    for(i = 0; i < GG_CPU_PROFILE_BANKS; i++)
+        free(profile->hits[i]);
+    free(profile);
+}
+
+void gg_cpu_profile_add(struct GG_CPU_Profile *profile,
+    unsigned bank,
+    unsigned address,
+    unsigned op,
+    unsigned cycles){
+    
+    assert(op < 0x200);
+    assert(address < 0x10000);
+    
+    if(profile == NULL)
+        return;
+    
+    profile->counts[op]++;
+    profile->cycles[op] += cycles;
+    
+    if(bank >= GG_CPU_PROFILE_BANKS)
+        return;
+    if(profile->hits[bank] == NULL){
+        profile->hits[bank] = calloc(0x10000, sizeof(unsigned long));
+        if(profile->hits[bank] == NULL)
+            return;
+    }
+    profile->hits[bank][address]++;
+}
+
+/* The opcode rows are disassembled out of a scratch MMU, so any immediates
+ * show up as zero.
+ */
+static const char *gg_cpu_profile_disassemble_op(GG_MMU *scratch,
+    unsigned op,
+    char out[80]){
+    
+    unsigned address = 0xC000;
+    if(op & 0x100){
+        GG_Write8MMU(scratch, 0xC000, 0xCB);
+        GG_Write8MMU(scratch, 0xC001, op & 0xFF);
+    }
+    else{
+        GG_Write8MMU(scratch, 0xC000, op);
+    }
+    return GG_DBG_Disassemble(scratch, &address, out);
+}
+
+/* The address rows are copied into the scratch MMU out of the bank they were
+ * counted in, which might not be the one mapped now.
+ */
+static const char *gg_cpu_profile_disassemble_at(GG_MMU *scratch,
+    const GG_MMU *mmu,
+    unsigned bank,
+    unsigned address,
+    char out[80]){
+    
+    unsigned i, at = 0xC000;
+    for(i = 0; i < 3; i++){
+        const unsigned from = (address + i) & 0xFFFF;
+        /* Past the end of the bank is whatever is mapped after it */
+        GG_Write8MMU(scratch, at + i, ((from ^ address) & 0xC000) ?
+            GG_Read8MMU(mmu, from) : GG_ReadBankMMU(mmu, bank, from));
+    }
+    return GG_DBG_Disassemble(scratch, &at, out);
+}
+
+int gg_cpu_profile_write(const struct GG_CPU_Profile *profile,
+    void *mmu,
+    const char *path,
+    unsigned format){
+    
+    const int json = (format == GG_CPU_PROFILE_JSON);
+    GG_MMU *scratch;
+    FILE *out;
+    char text[80];
+    const char *separator = "";
+    unsigned i, bank, address;
+    
+    assert(format == GG_CPU_PROFILE_CSV || format == GG_CPU_PROFILE_JSON);
+    
+    if(profile == NULL || (scratch = GG_CreateMMU()) == NULL)
+        return -1;
+    if((out = fopen(path, "w")) == NULL){
+        GG_DestroyMMU(scratch);
+        return -1;
+    }
+    
+    if(json)
+        fputs("{\n\"opcodes\": [", out);
+    else
+        fputs("kind,bank,address,opcode,count,cycles,instruction\n", out);
+    
+    for(i = 0; i < 0x200; i++){
+        const char *const kind = (i & 0x100) ? "cb" : "op";
+        if(profile->counts[i] == 0)
+            continue;
+        if(json){
+            fprintf(out,
+                "%s\n{\"kind\": \"%s\", \"opcode\": \"0x%02X\", "
+                "\"count\": %lu, \"cycles\": %lu, \"instruction\": \"%s\"}",
+                separator, kind, i & 0xFF, profile->counts[i],
+                profile->cycles[i],
+                gg_cpu_profile_disassemble_op(scratch, i, text));
+            separator = ",";
+        }
+        else{
+            fprintf(out, "%s,,,0x%02X,%lu,%lu,\"%s\"\n",
+                kind, i & 0xFF, profile->counts[i], profile->cycles[i],
+                gg_cpu_profile_disassemble_op(scratch, i, text));
+        }
+    }
+    
+    if(json){
+        fputs("\n],\n\"addresses\": [", out);
+        separator = "";
+    }
+    
+    for(bank = 0; bank < GG_CPU_PROFILE_BANKS; bank++){
+        const unsigned long *const hits = profile->hits[bank];
+        if(hits == NULL)
+            continue;
+        for(address = 0; address < 0x10000; address++){
+            if(hits[address] == 0)
+                continue;
+            if(json){
+                fprintf(out,
+                    "%s\n{\"bank\": %u, \"address\": \"0x%04X\", "
+                    "\"count\": %lu, \"instruction\": \"%s\"}",
+                    separator, bank, address, hits[address],
+                    gg_cpu_profile_disassemble_at(scratch, mmu, bank, address,
+                        text));
+                separator = ",";
+            }
+            else{
+                fprintf(out, "address,%u,0x%04X,0x%02X,%lu,,\"%s\"\n",
+                    bank, address, GG_ReadBankMMU(mmu, bank, address),
+                    hits[address],
+                    gg_cpu_profile_disassemble_at(scratch, mmu, bank, address,
+                        text));
+            }
+        }
+    }
+    
+    if(json)
+        fputs("\n]\n}\n", out);
+    
+    GG_DestroyMMU(scratch);
+    return (fclose(out) == 0) ? 0 : -1;
+}
+
+#else
+
+/* ISO C doesn't allow an empty translation unit */
+typedef int gg_cpu_profile_unused;
+
+#endif
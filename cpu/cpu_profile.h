@@ -0,0 +1,70 @@
+/* Copyright (c) 2019 Emily McDonough
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef GG_CPU_CPU_PROFILE_H
+#define GG_CPU_CPU_PROFILE_H
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Execution profiler.
+ * Only built when GG_PROFILE is defined. Every op is counted along with the
+ * cycles it took, with the CB opcodes counted separately, and every address
+ * an op starts at is counted for each ROM bank. Nothing here exists in a
+ * normal build.
+ */
+#ifdef GG_PROFILE
+
+/* Counting every op needs the plain interpreter */
+#ifndef GG_NO_BLOCK_CACHE
+#define GG_NO_BLOCK_CACHE
+#endif
+
+/* Enough for any MBC5 cart */
+#define GG_CPU_PROFILE_BANKS 0x200
+
+/* Index for a CB opcode */
+#define GG_CPU_PROFILE_CB(N) (0x100 | (N))
+
+struct GG_CPU_Profile{
+    /* Indexed by opcode, or GG_CPU_PROFILE_CB for the CB opcodes */
+    unsigned long counts[0x200];
+    unsigned long cycles[0x200];
+    /* 64K counters for each bank, allocated the first time the bank runs */
+    unsigned long *hits[GG_CPU_PROFILE_BANKS];
+};
+
+/* Returns NULL if the profile could not be allocated */
+struct GG_CPU_Profile *gg_cpu_profile_create(void);
+void gg_cpu_profile_destroy(struct GG_CPU_Profile *profile);
+
+/* Counts one op. The profile may be NULL. */
+void gg_cpu_profile_add(struct GG_CPU_Profile *profile,
+    unsigned bank,
+    unsigned address,
+    unsigned op,
+    unsigned cycles);
+
+/* Writes the profile as CSV or JSON (GG_CPU_PROFILE_CSV or _JSON in cpu.h).
+ * Addresses in ROM are disassembled from the bank they ran in. Anything else
+ * is disassembled from the memory that is mapped now.
+ * Returns zero on success.
+ */
+int gg_cpu_profile_write(const struct GG_CPU_Profile *profile,
+    void *mmu,
+    const char *path,
+    unsigned format);
+
+#endif
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif /* GG_CPU_CPU_PROFILE_H */
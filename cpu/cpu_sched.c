@@ -0,0 +1,59 @@
+/* Copyright (c) 2019 Emily McDonough
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "cpu_sched.h"
+
+#include <assert.h>
+
+/* There are only a few events, so finding the earliest is a quick scan. This
+ * only happens when an event is scheduled, the CPU just compares to next.
+ */
+static void gg_cpu_sched_update(struct GG_CPU_Scheduler *sched){
+    gg_timestamp_t next = GG_CPU_EVENT_NEVER;
+    unsigned i;
+    for(i = 0; i < GG_CPU_EVENT_COUNT; i++){
+        if(sched->events[i] < next)
+            next = sched->events[i];
+    }
+    sched->next = next;
+}
+
+void gg_cpu_sched_init(struct GG_CPU_Scheduler *sched){
+    unsigned i;
+    sched->now = 0;
+    for(i = 0; i < GG_CPU_EVENT_COUNT; i++)
+        sched->events[i] = GG_CPU_EVENT_NEVER;
+    sched->next = GG_CPU_EVENT_NEVER;
+}
+
+void gg_cpu_sched_set(struct GG_CPU_Scheduler *sched,
+    unsigned event,
+    gg_timestamp_t when){
+    
+    assert(event < GG_CPU_EVENT_COUNT);
+    sched->events[event] = when;
+    if(when < sched->next)
+        sched->next = when;
+    else
+        gg_cpu_sched_update(sched);
+}
+
+int gg_cpu_sched_pop(struct GG_CPU_Scheduler *sched){
+    unsigned i, event = 0;
+    
+    if(sched->next > sched->now)
+        return -1;
+    
+    for(i = 1; i < GG_CPU_EVENT_COUNT; i++){
+        if(sched->events[i] < sched->events[event])
+            event = i;
+    }
+    
+    sched->events[event] = GG_CPU_EVENT_NEVER;
+    gg_cpu_sched_update(sched);
+    return (int)event;
+}
@@ -0,0 +1,74 @@
+/* Copyright (c) 2019 Emily McDonough
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef GG_CPU_CPU_SCHED_H
+#define GG_CPU_CPU_SCHED_H
+#pragma once
+
+#include <limits.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Event scheduler.
+ * Everything outside the CPU that happens at a known time is an event. The
+ * CPU runs without checking on anything else until the earliest event is due,
+ * and then dispatches it. Each event has a single slot, so scheduling an
+ * event again moves it.
+ */
+
+/* Timestamps are in cycles since GG_CPU_Init, and need to be 64 bits so they
+ * do not wrap. C89 has no long long, so use whatever the compiler has.
+ */
+#if ULONG_MAX > 0xFFFFFFFFUL
+typedef unsigned long gg_timestamp_t;
+#elif (defined __GNUC__)
+__extension__ typedef unsigned long long gg_timestamp_t;
+#elif (defined _MSC_VER) || (defined __WATCOMC__)
+typedef unsigned __int64 gg_timestamp_t;
+#else
+#error No 64-bit integer type for gg_timestamp_t
+#endif
+
+#define GG_CPU_EVENT_NEVER ((gg_timestamp_t)~(gg_timestamp_t)0)
+
+/* The GPU changes mode */
+#define GG_CPU_EVENT_GPU 0
+/* TIMA overflows */
+#define GG_CPU_EVENT_TIMER 1
+
+#define GG_CPU_EVENT_COUNT 2
+
+struct GG_CPU_Scheduler{
+    /* Only brought up to date when the CPU stops to dispatch events */
+    gg_timestamp_t now;
+    /* The earliest of the events, or GG_CPU_EVENT_NEVER */
+    gg_timestamp_t next;
+    gg_timestamp_t events[GG_CPU_EVENT_COUNT];
+};
+
+/* Starts at zero with nothing scheduled */
+void gg_cpu_sched_init(struct GG_CPU_Scheduler *sched);
+
+/* Schedules event for the timestamp when, replacing any earlier time. Passing
+ * GG_CPU_EVENT_NEVER unschedules it.
+ */
+void gg_cpu_sched_set(struct GG_CPU_Scheduler *sched,
+    unsigned event,
+    gg_timestamp_t when);
+
+/* Returns the earliest event that is due by now and unschedules it, or -1 if
+ * nothing is due. Call this until it returns -1 to run everything that is due.
+ */
+int gg_cpu_sched_pop(struct GG_CPU_Scheduler *sched);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif /* GG_CPU_CPU_SCHED_H */
@@ -0,0 +1,91 @@
+/* Copyright (c) 2019 Emily McDonough
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "cpu_timer.h"
+#include "cpu.h"
+
+#include <assert.h>
+
+#define GG_CPU_TIMER_ENABLED 0x04
+
+/* TIMA counts once every 1024, 16, 64, or 256 cycles, picked by the low bits
+ * of TAC. These are the bits of the divider counter it follows.
+ */
+static const unsigned char gg_cpu_timer_shifts[4] = { 10, 4, 6, 8 };
+
+void gg_cpu_timer_init(struct GG_CPU_Timer *timer){
+    timer->div_base = 0;
+    timer->time = 0;
+    timer->tima = 0;
+}
+
+void gg_cpu_timer_sync(struct GG_CPU_Timer *timer,
+    GG_MMU *mmu,
+    gg_timestamp_t now){
+    
+    const unsigned tac = GG_GetMMUIO(mmu, 0xFF07);
+    
+    assert(now >= timer->time);
+    
+    if(tac & GG_CPU_TIMER_ENABLED){
+        const unsigned shift = gg_cpu_timer_shifts[tac & 3];
+        gg_timestamp_t ticks = ((now - timer->div_base) >> shift) -
+            ((timer->time - timer->div_base) >> shift);
+        unsigned tima = timer->tima;
+    
+        /* This is normally at most one overflow, since each one is an event */
+        while(ticks >= 0x100 - tima){
+            ticks -= 0x100 - tima;
+            tima = GG_GetMMUIO(mmu, 0xFF06);
+            GG_SetMMUIO(mmu, 0xFF0F,
+                GG_GetMMUIO(mmu, 0xFF0F) | GG_CPU_INTERRUPT_TIMER);
+        }
+        timer->tima = (unsigned char)(tima + ticks);
+    }
+    
+    timer->time = now;
+    GG_SetMMUIO(mmu, 0xFF04, (unsigned)((now - timer->div_base) >> 8) & 0xFF);
+    GG_SetMMUIO(mmu, 0xFF05, timer->tima);
+}
+
+void gg_cpu_timer_write(struct GG_CPU_Timer *timer,
+    GG_MMU *mmu,
+    gg_timestamp_t now,
+    unsigned address,
+    unsigned value){
+    
+    assert(GG_CPU_TIMER_IS_REGISTER(address));
+    
+    gg_cpu_timer_sync(timer, mmu, now);
+    switch(address){
+        case 0xFF04:
+            /* Any write resets the whole divider */
+            timer->div_base = now;
+            GG_SetMMUIO(mmu, 0xFF04, 0);
+            break;
+        case 0xFF05:
+            timer->tima = (unsigned char)value;
+            /* FALLTHROUGH */
+        default:
+            GG_SetMMUIO(mmu, address, value);
+    }
+}
+
+gg_timestamp_t gg_cpu_timer_overflow(const struct GG_CPU_Timer *timer,
+    const GG_MMU *mmu){
+    
+    const unsigned tac = GG_GetMMUIO(mmu, 0xFF07);
+    unsigned shift;
+    
+    if(!(tac & GG_CPU_TIMER_ENABLED))
+        return GG_CPU_EVENT_NEVER;
+    
+    shift = gg_cpu_timer_shifts[tac & 3];
+    return timer->div_base +
+        ((((timer->time - timer->div_base) >> shift) +
+            (0x100 - timer->tima)) << shift);
+}
@@ -0,0 +1,66 @@
+/* Copyright (c) 2019 Emily McDonough
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef GG_CPU_CPU_TIMER_H
+#define GG_CPU_CPU_TIMER_H
+#pragma once
+
+#include "cpu_sched.h"
+#include "mmu.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* DIV, TIMA, TMA, and TAC (FF04 to FF07).
+ * Nothing counts while the CPU runs. DIV and TIMA are worked out from the
+ * timestamp when they are read or written, and the only thing scheduled is
+ * the TIMA overflow. TMA and TAC are kept in memory as they were written.
+ * The CPU puts MMIO handlers on the registers, so these only touch them with
+ * GG_GetMMUIO and GG_SetMMUIO.
+ */
+
+/* Non-zero for the addresses that need to go through the timer */
+#define GG_CPU_TIMER_IS_REGISTER(ADDR) (((ADDR) & 0xFFFC) == 0xFF04)
+
+struct GG_CPU_Timer{
+    /* When DIV was last reset. DIV is the upper byte of the cycles since. */
+    gg_timestamp_t div_base;
+    /* When DIV and TIMA in memory were last brought up to date */
+    gg_timestamp_t time;
+    unsigned char tima;
+};
+
+void gg_cpu_timer_init(struct GG_CPU_Timer *timer);
+
+/* Brings DIV and TIMA in memory up to date. If TIMA overflowed, it is
+ * reloaded from TMA and the timer interrupt is requested.
+ */
+void gg_cpu_timer_sync(struct GG_CPU_Timer *timer,
+    GG_MMU *mmu,
+    gg_timestamp_t now);
+
+/* Writes to one of the timer registers. The overflow needs to be rescheduled
+ * afterwards.
+ */
+void gg_cpu_timer_write(struct GG_CPU_Timer *timer,
+    GG_MMU *mmu,
+    gg_timestamp_t now,
+    unsigned address,
+    unsigned value);
+
+/* Returns when TIMA will next overflow, or GG_CPU_EVENT_NEVER if the timer is
+ * stopped. Only valid right after a sync or write.
+ */
+gg_timestamp_t gg_cpu_timer_overflow(const struct GG_CPU_Timer *timer,
+    const GG_MMU *mmu);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif /* GG_CPU_CPU_TIMER_H */
@@ -21,3 +21,13 @@ static unsigned char cpu_opcode_times[0x101] = {
 
 const unsigned char *const gg_cpu_opcode_times = cpu_opcode_times;
 const unsigned char *const _gg_cpu_opcode_times = cpu_opcode_times;
+
+#define GG_CB_OPCODE(_1, TIME) TIME,
+#define GG_END_CB_OPCODE( _ )
+
+static unsigned char cpu_cb_opcode_times[0x101] = {
+#include "cpu_cb.inc"
+    0
+};
+
+const unsigned char *const gg_cpu_cb_opcode_times = cpu_cb_opcode_times;
@@ -16,6 +16,9 @@ extern "C" {
 extern const unsigned char *const gg_cpu_opcode_times;
 extern const unsigned char *const _gg_cpu_opcode_times;
 
+/* Cycles for the whole CB instruction, including the 0xCB opcode */
+extern const unsigned char *const gg_cpu_cb_opcode_times;
+
 #ifdef __cplusplus
 } // extern "C"
 #endif
@@ -0,0 +1,417 @@
+/* Copyright (c) 2019 Emily McDonough
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "dbg_cond.h"
+#include "dbg_core.h"
+
+#include "cpu_defs.h"
+
+#include <ctype.h>
+#include <string.h>
+#include <assert.h>
+
+/*****************************************************************************/
+
+#define GG_DBG_OP_END 0
+/* Followed by the value */
+#define GG_DBG_OP_CONST 1
+/* Followed by the index in gg_dbg_register_names */
+#define GG_DBG_OP_REGISTER 2
+#define GG_DBG_OP_READ8 3
+#define GG_DBG_OP_NOT 4
+/* Everything from here on pops two values and pushes one */
+#define GG_DBG_OP_OR 5
+#define GG_DBG_OP_AND 6
+#define GG_DBG_OP_EQ 7
+#define GG_DBG_OP_NE 8
+#define GG_DBG_OP_LE 9
+#define GG_DBG_OP_GE 10
+#define GG_DBG_OP_LT 11
+#define GG_DBG_OP_GT 12
+#define GG_DBG_OP_BIT_AND 13
+#define GG_DBG_OP_BIT_OR 14
+#define GG_DBG_OP_BIT_XOR 15
+#define GG_DBG_OP_ADD 16
+#define GG_DBG_OP_SUB 17
+
+/*****************************************************************************/
+
+struct GG_DBG_CondParser {
+    const char *at;
+    struct GG_DBG_Condition *cond;
+    unsigned length, depth;
+    /* How many !, ( and [ the parser is inside. These recurse before they
+     * emit anything, so the code size doesn't limit them.
+     */
+    unsigned nesting;
+    int error;
+};
+
+/*****************************************************************************/
+
+static void gg_dbg_cond_emit(struct GG_DBG_CondParser *p, unsigned op){
+    if(p->error)
+        return;
+    /* Leave room for the terminator */
+    if(p->length + 1 >= GG_DBG_COND_MAX_CODE){
+        p->error = 1;
+        return;
+    }
+    p->cond->code[p->length++] = (unsigned short)op;
+    
+    if(op == GG_DBG_OP_CONST || op == GG_DBG_OP_REGISTER){
+        if(++p->depth > GG_DBG_COND_MAX_STACK)
+            p->error = 1;
+    }
+    else if(op >= GG_DBG_OP_OR){
+        assert(p->depth >= 2);
+        p->depth--;
+    }
+}
+
+/*****************************************************************************/
+
+static void gg_dbg_cond_emit_value(struct GG_DBG_CondParser *p,
+    unsigned op,
+    unsigned value){
+    
+    gg_dbg_cond_emit(p, op);
+    if(p->error)
+        return;
+    if(p->length + 1 >= GG_DBG_COND_MAX_CODE){
+        p->error = 1;
+        return;
+    }
+    p->cond->code[p->length++] = (unsigned short)value;
+}
+
+/*****************************************************************************/
+/* Skips spaces, and then consumes the token if it is next. The token must
+ * not be followed by FOLLOW, so that & doesn't match the start of &&.
+ */
+static int gg_dbg_cond_accept(struct GG_DBG_CondParser *p,
+    const char *token,
+    char follow){
+    
+    const unsigned len = strlen(token);
+    while(isspace((unsigned char)*p->at))
+        p->at++;
+    if(strncmp(p->at, token, len) != 0)
+        return 0;
+    if(follow != '\0' && p->at[len] == follow)
+        return 0;
+    p->at += len;
+    return 1;
+}
+
+/*****************************************************************************/
+
+static void gg_dbg_cond_or(struct GG_DBG_CondParser *p);
+
+/*****************************************************************************/
+
+static void gg_dbg_cond_number(struct GG_DBG_CondParser *p){
+    unsigned long value = 0;
+    unsigned base = 10;
+    const char *start;
+    
+    if(*p->at == '$'){
+        base = 16;
+        p->at++;
+    }
+    else if(p->at[0] == '0' && (p->at[1] == 'x' || p->at[1] == 'X')){
+        base = 16;
+        p->at += 2;
+    }
+    
+    start = p->at;
+    while(isxdigit((unsigned char)*p->at)){
+        const int c = tolower((unsigned char)*p->at);
+        const unsigned digit = isdigit(c) ? (unsigned)(c - '0') :
+            (unsigned)(c - 'a' + 10);
+        if(digit >= base)
+            break;
+        value = (value * base) + digit;
+        if(value > 0xFFFF){
+            p->error = 1;
+            return;
+        }
+        p->at++;
+    }
+    
+    if(p->at == start)
+        p->error = 1;
+    else
+        gg_dbg_cond_emit_value(p, GG_DBG_OP_CONST, value);
+}
+
+/*****************************************************************************/
+
+static void gg_dbg_cond_register(struct GG_DBG_CondParser *p){
+    unsigned i, len = 0;
+    while(isalpha((unsigned char)p->at[len]))
+        len++;
+    
+    for(i = 0; gg_dbg_register_names[i] != NULL; i++){
+        const char *const name = gg_dbg_register_names[i];
+        unsigned n;
+        if(strlen(name) != len)
+            continue;
+        for(n = 0; n < len; n++){
+            if(toupper((unsigned char)p->at[n]) != name[n])
+                break;
+        }
+        if(n == len){
+            p->at += len;
+            gg_dbg_cond_emit_value(p, GG_DBG_OP_REGISTER, i);
+            return;
+        }
+    }
+    p->error = 1;
+}
+
+/*****************************************************************************/
+
+static void gg_dbg_cond_nest(struct GG_DBG_CondParser *p){
+    if(++p->nesting > GG_DBG_COND_MAX_STACK)
+        p->error = 1;
+}
+
+static void gg_dbg_cond_unary(struct GG_DBG_CondParser *p){
+    const unsigned nesting = p->nesting;
+    
+    if(p->error)
+        return;
+    
+    if(gg_dbg_cond_accept(p, "!", '=')){
+        gg_dbg_cond_nest(p);
+        gg_dbg_cond_unary(p);
+        gg_dbg_cond_emit(p, GG_DBG_OP_NOT);
+    }
+    else if(gg_dbg_cond_accept(p, "(", '\0')){
+        gg_dbg_cond_nest(p);
+        gg_dbg_cond_or(p);
+        if(!gg_dbg_cond_accept(p, ")", '\0'))
+            p->error = 1;
+    }
+    else if(gg_dbg_cond_accept(p, "[", '\0')){
+        gg_dbg_cond_nest(p);
+        gg_dbg_cond_or(p);
+        if(!gg_dbg_cond_accept(p, "]", '\0'))
+            p->error = 1;
+        gg_dbg_cond_emit(p, GG_DBG_OP_READ8);
+    }
+    else if(isdigit((unsigned char)*p->at) || *p->at == '$'){
+        gg_dbg_cond_number(p);
+    }
+    else if(isalpha((unsigned char)*p->at)){
+        gg_dbg_cond_register(p);
+    }
+    else{
+        p->error = 1;
+    }
+    
+    p->nesting = nesting;
+}
+
+/*****************************************************************************/
+
+static void gg_dbg_cond_sum(struct GG_DBG_CondParser *p){
+    gg_dbg_cond_unary(p);
+    while(!p->error){
+        if(gg_dbg_cond_accept(p, "+", '\0')){
+            gg_dbg_cond_unary(p);
+            gg_dbg_cond_emit(p, GG_DBG_OP_ADD);
+        }
+        else if(gg_dbg_cond_accept(p, "-", '\0')){
+            gg_dbg_cond_unary(p);
+            gg_dbg_cond_emit(p, GG_DBG_OP_SUB);
+        }
+        else{
+            return;
+        }
+    }
+}
+
+/*****************************************************************************/
+
+static void gg_dbg_cond_bits(struct GG_DBG_CondParser *p){
+    gg_dbg_cond_sum(p);
+    while(!p->error){
+        if(gg_dbg_cond_accept(p, "&", '&')){
+            gg_dbg_cond_sum(p);
+            gg_dbg_cond_emit(p, GG_DBG_OP_BIT_AND);
+        }
+        else if(gg_dbg_cond_accept(p, "|", '|')){
+            gg_dbg_cond_sum(p);
+            gg_dbg_cond_emit(p, GG_DBG_OP_BIT_OR);
+        }
+        else if(gg_dbg_cond_accept(p, "^", '\0')){
+            gg_dbg_cond_sum(p);
+            gg_dbg_cond_emit(p, GG_DBG_OP_BIT_XOR);
+        }
+        else{
+            return;
+        }
+    }
+}
+
+/*****************************************************************************/
+/* Comparisons don't chain */
+static void gg_dbg_cond_compare(struct GG_DBG_CondParser *p){
+    static const char *const tokens[] = { "==", "!=", "<=", ">=", "<", ">" };
+    unsigned i;
+    
+    gg_dbg_cond_bits(p);
+    for(i = 0; i < 6 && !p->error; i++){
+        if(gg_dbg_cond_accept(p, tokens[i], '\0')){
+            gg_dbg_cond_bits(p);
+            gg_dbg_cond_emit(p, GG_DBG_OP_EQ + i);
+            return;
+        }
+    }
+}
+
+/*****************************************************************************/
+
+static void gg_dbg_cond_and(struct GG_DBG_CondParser *p){
+    gg_dbg_cond_compare(p);
+    while(!p->error && gg_dbg_cond_accept(p, "&&", '\0')){
+        gg_dbg_cond_compare(p);
+        gg_dbg_cond_emit(p, GG_DBG_OP_AND);
+    }
+}
+
+/*****************************************************************************/
+
+static void gg_dbg_cond_or(struct GG_DBG_CondParser *p){
+    gg_dbg_cond_and(p);
+    while(!p->error && gg_dbg_cond_accept(p, "||", '\0')){
+        gg_dbg_cond_and(p);
+        gg_dbg_cond_emit(p, GG_DBG_OP_OR);
+    }
+}
+
+/*****************************************************************************/
+
+int gg_dbg_cond_compile(struct GG_DBG_Condition *cond, const char *text){
+    struct GG_DBG_CondParser p;
+    
+    cond->code[0] = GG_DBG_OP_END;
+    if(text == NULL)
+        return 0;
+    
+    p.at = text;
+    p.cond = cond;
+    p.length = 0;
+    p.depth = 0;
+    p.nesting = 0;
+    p.error = 0;
+    
+    /* An empty or all-space condition is always true */
+    gg_dbg_cond_accept(&p, "", '\0');
+    if(*p.at == '\0')
+        return 0;
+    
+    gg_dbg_cond_or(&p);
+    /* Skip any trailing spaces */
+    gg_dbg_cond_accept(&p, "", '\0');
+    if(p.error || *p.at != '\0'){
+        cond->code[0] = GG_DBG_OP_END;
+        return -1;
+    }
+    
+    assert(p.depth == 1);
+    cond->code[p.length] = GG_DBG_OP_END;
+    return 0;
+}
+
+/*****************************************************************************/
+
+/* The registers are read straight out of the GG_CPU, so that the debugger
+ * core doesn't need the CPU to link. The index is in the order of
+ * GG_ALL_REGISTERS, which is the high, low, and whole of each pair, and then
+ * SP and IP.
+ */
+static unsigned gg_dbg_cond_get_register(const GG_CPU *cpu, unsigned i){
+    unsigned pair;
+    
+    assert(i < 14);
+    
+    switch(i / 3){
+        case 0: pair = cpu->AF.reg; break;
+        case 1: pair = cpu->BC.reg; break;
+        case 2: pair = cpu->DE.reg; break;
+        case 3: pair = cpu->HL.reg; break;
+        default:
+            return (i == 12) ? cpu->SP : cpu->IP;
+    }
+    
+    switch(i % 3){
+        case 0: return pair >> 8;
+        case 1: return pair & 0xFF;
+        default: return pair;
+    }
+}
+
+/*****************************************************************************/
+
+unsigned gg_dbg_cond_eval(const struct GG_DBG_Condition *cond,
+    const GG_CPU *cpu,
+    const GG_MMU *mmu){
+    
+    unsigned stack[GG_DBG_COND_MAX_STACK];
+    unsigned n = 0;
+    const unsigned short *code = cond->code;
+    
+    if(*code == GG_DBG_OP_END)
+        return 1;
+    
+    do{
+        const unsigned op = *code++;
+        unsigned a, b;
+        switch(op){
+            case GG_DBG_OP_END:
+                assert(n == 1);
+                return stack[0];
+            case GG_DBG_OP_CONST:
+                stack[n++] = *code++;
+                continue;
+            case GG_DBG_OP_REGISTER:
+                stack[n++] = gg_dbg_cond_get_register(cpu, *code++);
+                continue;
+            case GG_DBG_OP_READ8:
+                stack[n-1] = GG_Read8MMU(mmu, stack[n-1] & 0xFFFF);
+                continue;
+            case GG_DBG_OP_NOT:
+                stack[n-1] = !stack[n-1];
+                continue;
+        }
+    
+        assert(n >= 2);
+        b = stack[--n];
+        a = stack[n-1];
+        switch(op){
+            case GG_DBG_OP_OR:      a = (a || b); break;
+            case GG_DBG_OP_AND:     a = (a && b); break;
+            case GG_DBG_OP_EQ:      a = (a == b); break;
+            case GG_DBG_OP_NE:      a = (a != b); break;
+            case GG_DBG_OP_LE:      a = (a <= b); break;
+            case GG_DBG_OP_GE:      a = (a >= b); break;
+            case GG_DBG_OP_LT:      a = (a < b); break;
+            case GG_DBG_OP_GT:      a = (a > b); break;
+            case GG_DBG_OP_BIT_AND: a &= b; break;
+            case GG_DBG_OP_BIT_OR:  a |= b; break;
+            case GG_DBG_OP_BIT_XOR: a ^= b; break;
+            case GG_DBG_OP_ADD:     a += b; break;
+            case GG_DBG_OP_SUB:     a -= b; break;
+            default:
+                assert(0);
+        }
+        stack[n-1] = a;
+    }while(1);
+}
@@ -0,0 +1,66 @@
+/* Copyright (c) 2019 Emily McDonough
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef GG_DBG_COND_H
+#define GG_DBG_COND_H
+#pragma once
+
+/*****************************************************************************/
+
+#include "cpu.h"
+#include "mmu.h"
+
+/*****************************************************************************/
+/* Breakpoint conditions. These are only used inside the debugger core.
+ *
+ * A condition is an expression over the registers and memory, such as
+ *   A == $10 && [HL] != 0
+ * Registers are named as in gg_dbg_register_names, [X] reads the byte at X,
+ * and numbers are decimal, or hex with a $ or 0x prefix. The operators are
+ * the C ones: || && == != < > <= >= & | ^ + - ! and parentheses.
+ *
+ * Conditions are compiled to a small stack bytecode when the breakpoint is
+ * set, so nothing is parsed while the CPU runs. A condition that needs more
+ * than GG_DBG_COND_MAX_CODE codes, or that nests !, parentheses or [] more
+ * than GG_DBG_COND_MAX_STACK deep, does not compile.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*****************************************************************************/
+
+#define GG_DBG_COND_MAX_CODE 64
+#define GG_DBG_COND_MAX_STACK 16
+
+/*****************************************************************************/
+
+struct GG_DBG_Condition {
+    /* Ends with a zero. Empty means always true. */
+    unsigned short code[GG_DBG_COND_MAX_CODE];
+};
+
+/*****************************************************************************/
+/* Returns zero on success. The text may be NULL for an empty condition. */
+int gg_dbg_cond_compile(struct GG_DBG_Condition *cond, const char *text);
+
+/*****************************************************************************/
+/* The CPU registers need to be stored to the GG_CPU first */
+unsigned gg_dbg_cond_eval(const struct GG_DBG_Condition *cond,
+    const GG_CPU *cpu,
+    const GG_MMU *mmu);
+
+/*****************************************************************************/
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+/*****************************************************************************/
+
+#endif /* GG_DBG_COND_H */
@@ -6,24 +6,39 @@
  */
 
 #include "dbg_core.h"
+#include "dbg_cond.h"
 
 #include "mmu.h"
 #include "cpu.h"
+#include "cpu_block.h"
 
 #include <stdlib.h>
+#include <string.h>
 #include <assert.h>
 
 /*****************************************************************************/
 
+struct GG_DBG_Breakpoint {
+    unsigned bank, address;
+    /* Only counts the times the condition was true */
+    unsigned long hits, hit_count;
+    struct GG_DBG_Condition condition;
+};
+
+/*****************************************************************************/
+
 struct GG_DBG_s {
-    unsigned char state;
+    /* Must be first, see GG_DBG_IS_BREAKPOINT */
+    struct GG_DBG_Head head;
     
     GG_CPU *cpu;
     GG_MMU *mmu;
     
-    /* TODO: This should really be sorted. */
+    /* Sorted by bank and then address. This is only searched when the CPU
+     * hits a bit in the bitmap, or when the breakpoints change.
+     */
     unsigned num_breaks, cap_breaks;
-    unsigned *breaks;
+    struct GG_DBG_Breakpoint *breaks;
 };
 
 const unsigned gg_dbg_core_struct_size = sizeof(GG_DBG);
@@ -31,6 +46,10 @@ const unsigned _gg_dbg_core_struct_size = sizeof(GG_DBG);
 
 /*****************************************************************************/
 
+static const unsigned char gg_dbg_no_breakpoints[GG_DBG_BITMAP_SIZE];
+
+/*****************************************************************************/
+
 #define GG_DBG_REGISTER_NAME(X) "" #X "",
 
 /*****************************************************************************/
@@ -48,10 +67,14 @@ const char *const *const _gg_dbg_register_names = register_names;
 /*****************************************************************************/
 
 void GG_DBG_Init(GG_DBG *dbg, void *cpu, void *mmu){
+    unsigned i;
     assert(dbg);
     assert(mmu);
     assert(cpu);
     
+    for(i = 0; i < GG_DBG_BANKS; i++)
+        dbg->head.bits[i] = gg_dbg_no_breakpoints;
+    
     dbg->cpu = cpu;
     dbg->mmu = mmu;
     dbg->breaks = NULL;
@@ -61,89 +84,242 @@ void GG_DBG_Init(GG_DBG *dbg, void *cpu, void *mmu){
 
 /*****************************************************************************/
 
+static void gg_dbg_free_bitmaps(GG_DBG *dbg){
+    unsigned i;
+    for(i = 0; i < GG_DBG_BANKS; i++){
+        if(dbg->head.bits[i] != gg_dbg_no_breakpoints){
+            free((unsigned char*)dbg->head.bits[i]);
+            dbg->head.bits[i] = gg_dbg_no_breakpoints;
+        }
+    }
+}
+
+/*****************************************************************************/
+
 void GG_DBG_Fini(GG_DBG *dbg){
+    gg_dbg_free_bitmaps(dbg);
     free(dbg->breaks);
 }
 
 /*****************************************************************************/
 
 void GG_DBG_SetState(GG_DBG *dbg, int state) {
-    dbg->state = state;
+    dbg->head.state = state;
 }
 
 /*****************************************************************************/
 
 int GG_DBG_GetState(const GG_DBG *dbg) {
-    return dbg->state;
+    return dbg->head.state;
 }
 
 
+/*****************************************************************************/
+
+/* Finds the breakpoint, or where it would go. Returns non-zero if found. */
+static int gg_dbg_find_breakpoint(const GG_DBG *dbg,
+    unsigned bank,
+    unsigned address,
+    unsigned *out_index){
+    
+    unsigned low = 0, high = dbg->num_breaks;
+    while(low < high){
+        const unsigned i = (low + high) >> 1;
+        const struct GG_DBG_Breakpoint *const br = dbg->breaks + i;
+        if(br->bank < bank || (br->bank == bank && br->address < address))
+            low = i + 1;
+        else
+            high = i;
+    }
+    out_index[0] = low;
+    return low < dbg->num_breaks &&
+        dbg->breaks[low].bank == bank &&
+        dbg->breaks[low].address == address;
+}
+
 /*****************************************************************************/
 
 void GG_DBG_SetBreakpoint(GG_DBG *dbg, unsigned address){
-    const unsigned num_breaks = dbg->num_breaks;
+    GG_DBG_SetConditionalBreakpoint(dbg, address, NULL, 0);
+}
+
+/*****************************************************************************/
 
-    unsigned new_cap = 0;
-    const unsigned old_cap = dbg->cap_breaks;
+int GG_DBG_SetConditionalBreakpoint(GG_DBG *dbg,
+    unsigned address,
+    const char *condition,
+    unsigned hit_count){
     
-    assert(old_cap <= num_breaks);
+    return GG_DBG_SetConditionalBreakpointInBank(dbg,
+        GG_CPU_BLOCK_BANK(dbg->mmu, address),
+        address,
+        condition,
+        hit_count);
+}
+
+/*****************************************************************************/
+
+int GG_DBG_SetConditionalBreakpointInBank(GG_DBG *dbg,
+    unsigned bank,
+    unsigned address,
+    const char *condition,
+    unsigned hit_count){
     
-    if(old_cap == 0){
-        new_cap = 16;
+    struct GG_DBG_Condition compiled;
+    struct GG_DBG_Breakpoint *br;
+    unsigned char *bits;
+    unsigned i;
+    
+    if(bank >= GG_DBG_BANKS)
+        return -1;
+    address &= 0xFFFF;
+    
+    if(gg_dbg_cond_compile(&compiled, condition) != 0)
+        return -1;
+    
+    if(dbg->head.bits[bank] == gg_dbg_no_breakpoints){
+        if((bits = calloc(GG_DBG_BITMAP_SIZE, 1)) == NULL)
+            return -1;
+        dbg->head.bits[bank] = bits;
     }
-    else if(old_cap == num_breaks){
-        new_cap = old_cap << 1;
+    else{
+        bits = (unsigned char*)dbg->head.bits[bank];
     }
-    if(new_cap != 0){
-        unsigned *new_breaks = realloc(dbg->breaks, sizeof(unsigned)*new_cap);
-        if(new_breaks == NULL){
-            /* DANGER WILL ROBINSON */
-            return;
-        }
-        else{
+    
+    if(!gg_dbg_find_breakpoint(dbg, bank, address, &i)){
+        if(dbg->num_breaks == dbg->cap_breaks){
+            const unsigned new_cap =
+                (dbg->cap_breaks == 0) ? 16 : (dbg->cap_breaks << 1);
+            struct GG_DBG_Breakpoint *const new_breaks =
+                realloc(dbg->breaks, sizeof(struct GG_DBG_Breakpoint)*new_cap);
+            if(new_breaks == NULL)
+                return -1;
             dbg->breaks = new_breaks;
+            dbg->cap_breaks = new_cap;
         }
+        memmove(dbg->breaks + i + 1,
+            dbg->breaks + i,
+            sizeof(struct GG_DBG_Breakpoint) * (dbg->num_breaks - i));
+        dbg->num_breaks++;
     }
     
+    br = dbg->breaks + i;
+    br->bank = bank;
+    br->address = address;
+    br->hits = 0;
+    br->hit_count = hit_count;
+    br->condition = compiled;
     
-    dbg->breaks[dbg->num_breaks++] = address;
+    bits[address >> 3] |= 1 << (address & 7);
+    return 0;
 }
 
 /*****************************************************************************/
 
 void GG_DBG_UnsetBreakpoint(GG_DBG *dbg, unsigned address){
-    unsigned i;
-    const unsigned num_breaks = dbg->num_breaks;
+    GG_DBG_UnsetBreakpointInBank(dbg,
+        GG_CPU_BLOCK_BANK(dbg->mmu, address),
+        address);
+}
+
+/*****************************************************************************/
+
+void GG_DBG_UnsetBreakpointInBank(GG_DBG *dbg,
+    unsigned bank,
+    unsigned address){
     
-    assert(GG_DBG_IsBreakpoint(dbg, address));
+    unsigned i;
     
-    for(i = 0; i < num_breaks; i++){
-        if(dbg->breaks[i] == address){
-            /* TODO: This will have to be changed when we start sorting */
-            dbg->breaks[i] = dbg->breaks[num_breaks-1];
-            dbg->num_breaks = num_breaks-1;
-            return;
-        }
+    address &= 0xFFFF;
+    if(gg_dbg_find_breakpoint(dbg, bank, address, &i)){
+        dbg->num_breaks--;
+        memmove(dbg->breaks + i,
+            dbg->breaks + i + 1,
+            sizeof(struct GG_DBG_Breakpoint) * (dbg->num_breaks - i));
+        
+        /* The bitmap is kept until all the breakpoints are unset */
+        ((unsigned char*)dbg->head.bits[bank])[address >> 3] &=
+            ~(1 << (address & 7));
     }
 }
 
 /*****************************************************************************/
 
 void GG_DBG_UnsetAllBreakpoints(GG_DBG *dbg){
+    gg_dbg_free_bitmaps(dbg);
     dbg->num_breaks = 0;
 }
 
 /*****************************************************************************/
 /* Returns zero for no breakpoint, non-zero if there is a breakpoint */
 int GG_DBG_IsBreakpoint(GG_DBG *dbg, unsigned address){
+    return GG_DBG_IsBreakpointInBank(dbg,
+        GG_CPU_BLOCK_BANK(dbg->mmu, address),
+        address);
+}
+
+/*****************************************************************************/
+
+int GG_DBG_IsBreakpointInBank(GG_DBG *dbg, unsigned bank, unsigned address){
+    if(bank >= GG_DBG_BANKS)
+        return 0;
+    return GG_DBG_IS_BREAKPOINT(dbg, bank, address);
+}
+
+/*****************************************************************************/
+
+int GG_DBG_CheckBreakpoint(GG_DBG *dbg, unsigned address){
+    const unsigned bank = GG_CPU_BLOCK_BANK(dbg->mmu, address);
+    struct GG_DBG_Breakpoint *br;
     unsigned i;
-    const unsigned num_breaks = dbg->num_breaks;
-    for(i = 0; i < num_breaks; i++){
-        if(dbg->breaks[i] == address){
-            return 1;
-        }
-    }
-    return 0;
+    
+    if(!gg_dbg_find_breakpoint(dbg, bank, address & 0xFFFF, &i))
+        return 0;
+    
+    br = dbg->breaks + i;
+    if(!gg_dbg_cond_eval(&br->condition, dbg->cpu, dbg->mmu))
+        return 0;
+    
+    return ++br->hits >= br->hit_count;
+}
+
+/*****************************************************************************/
+
+unsigned long GG_DBG_GetBreakpointHits(const GG_DBG *dbg, unsigned address){
+    return GG_DBG_GetBreakpointHitsInBank(dbg,
+        GG_CPU_BLOCK_BANK(dbg->mmu, address),
+        address);
+}
+
+/*****************************************************************************/
+
+unsigned long GG_DBG_GetBreakpointHitsInBank(const GG_DBG *dbg,
+    unsigned bank,
+    unsigned address){
+    
+    unsigned i;
+    
+    if(!gg_dbg_find_breakpoint(dbg, bank, address & 0xFFFF, &i))
+        return 0;
+    return dbg->breaks[i].hits;
+}
+
+/*****************************************************************************/
+
+unsigned GG_DBG_GetNumBreakpoints(const GG_DBG *dbg){
+    return dbg->num_breaks;
+}
+
+/*****************************************************************************/
+
+void GG_DBG_GetBreakpoint(const GG_DBG *dbg,
+    unsigned n,
+    unsigned *out_bank,
+    unsigned *out_address){
+    
+    assert(n < dbg->num_breaks);
+    out_bank[0] = dbg->breaks[n].bank;
+    out_address[0] = dbg->breaks[n].address;
 }
 
 /*****************************************************************************/
@@ -35,6 +35,16 @@ typedef const char *gg_dbg_str_ptr;
 
 /*****************************************************************************/
 
+/* Breakpoints are kept per ROM bank, numbered as in GG_CPU_BLOCK_BANK. This
+ * is enough for any MBC5 cart.
+ */
+#define GG_DBG_BANKS 0x200
+
+/* One bit for each address */
+#define GG_DBG_BITMAP_SIZE (0x10000 >> 3)
+
+/*****************************************************************************/
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -63,6 +73,17 @@ typedef GG_DBG* GG_DBG_ptr;
 
 /*****************************************************************************/
 
+/* The start of the debugger core. The CPU reads this directly, so checking
+ * for a breakpoint is just a load and a test.
+ */
+struct GG_DBG_Head {
+    unsigned char state;
+    /* Banks without any breakpoints all share one bitmap of zeros */
+    const unsigned char *bits[GG_DBG_BANKS];
+};
+
+/*****************************************************************************/
+
 GG_DBG_FUNC(void) GG_DBG_Init(GG_DBG *dbg, void *cpu, void *mmu);
 
 /*****************************************************************************/
@@ -84,16 +105,55 @@ GG_DBG_FUNC(int) GG_DBG_GetState(const GG_DBG *dbg);
 #define GG_DBG_SET_STATE(DBG, STATE) \
     do{ ((unsigned char*)(DBG))[0] = (STATE); } while(0)
 
+/* Non-zero if there is a breakpoint at ADDR in BANK. This doesn't check the
+ * condition, GG_DBG_CheckBreakpoint does that.
+ */
+#define GG_DBG_IS_BREAKPOINT(DBG, BANK, ADDR) \
+    ((((const struct GG_DBG_Head*)(DBG))->bits[(BANK)] \
+        [((ADDR) & 0xFFFF) >> 3] >> ((ADDR) & 7)) & 1)
+
 /*****************************************************************************/
 
+/* Breakpoints are set in the bank that is currently mapped at the address.
+ * The InBank functions below take the bank instead, so a breakpoint can
+ * still be found after its bank has been switched out.
+ */
 GG_DBG_FUNC(void) GG_DBG_SetBreakpoint(GG_DBG *dbg, unsigned address);
 
 /*****************************************************************************/
+/* Sets a breakpoint that only stops when the condition is true, and only
+ * once it has been true hit_count times. The condition is an expression such
+ * as "A == $10 && [HL] != 0" (see dbg_cond.h), and may be NULL. Setting a
+ * breakpoint that already exists replaces its condition and clears its hits.
+ * Returns zero on success, or non-zero if the condition is not valid.
+ */
+GG_DBG_FUNC(int) GG_DBG_SetConditionalBreakpoint(GG_DBG *dbg,
+    unsigned address,
+    const char *condition,
+    unsigned hit_count);
 
+/*****************************************************************************/
+/* As above, but in the given bank. Also fails if the bank is not below
+ * GG_DBG_BANKS.
+ */
+GG_DBG_FUNC(int) GG_DBG_SetConditionalBreakpointInBank(GG_DBG *dbg,
+    unsigned bank,
+    unsigned address,
+    const char *condition,
+    unsigned hit_count);
+
+/*****************************************************************************/
+/* Does nothing if there is no breakpoint at the address */
 GG_DBG_FUNC(void) GG_DBG_UnsetBreakpoint(GG_DBG *dbg, unsigned address);
 
 /*****************************************************************************/
 
+GG_DBG_FUNC(void) GG_DBG_UnsetBreakpointInBank(GG_DBG *dbg,
+    unsigned bank,
+    unsigned address);
+
+/*****************************************************************************/
+
 GG_DBG_FUNC(void) GG_DBG_UnsetAllBreakpoints(GG_DBG *dbg);
 
 /*****************************************************************************/
@@ -102,6 +162,40 @@ GG_DBG_FUNC(int) GG_DBG_IsBreakpoint(GG_DBG *dbg, unsigned address);
 
 /*****************************************************************************/
 
+GG_DBG_FUNC(int) GG_DBG_IsBreakpointInBank(GG_DBG *dbg,
+    unsigned bank,
+    unsigned address);
+
+/*****************************************************************************/
+/* Called by the CPU when it reaches a breakpoint, with the registers stored.
+ * Counts the hit and returns non-zero if the CPU should stop.
+ */
+GG_DBG_FUNC(int) GG_DBG_CheckBreakpoint(GG_DBG *dbg, unsigned address);
+
+/*****************************************************************************/
+/* Number of times the breakpoint was reached with its condition true */
+GG_DBG_FUNC(unsigned long) GG_DBG_GetBreakpointHits(const GG_DBG *dbg,
+    unsigned address);
+
+/*****************************************************************************/
+
+GG_DBG_FUNC(unsigned long) GG_DBG_GetBreakpointHitsInBank(const GG_DBG *dbg,
+    unsigned bank,
+    unsigned address);
+
+/*****************************************************************************/
+
+GG_DBG_FUNC(unsigned) GG_DBG_GetNumBreakpoints(const GG_DBG *dbg);
+
+/*****************************************************************************/
+/* Gets the bank and address of breakpoint n, in order of bank and address */
+GG_DBG_FUNC(void) GG_DBG_GetBreakpoint(const GG_DBG *dbg,
+    unsigned n,
+    unsigned *out_bank,
+    unsigned *out_address);
+
+/*****************************************************************************/
+
 GG_DBG_FUNC(unsigned) GG_DBG_AddressToLine(const GG_DBG *dbg, unsigned);
 
 /*****************************************************************************/
@@ -134,11 +134,28 @@
 #define GG_OPCODE_ABSOLUTE( N1, N2 ) \
     return #N1 " " #N2;
 
+#define GG_OPCODE_BIT_REG8( N1, N2, N3 ) \
+    return #N1 " " #N2 ", " #N3;
+
+#define GG_OPCODE_BIT_REGPTR( N1, N2, N3 ) \
+    return #N1 " " #N2 ", [" #N3 "]";
+
 #define GG_END_OPCODE( N )
 
+#define GG_CB_OPCODE( N, CYCLES ) case N:
+
+#define GG_END_CB_OPCODE( N )
+
+static const char *gg_dbg_disassemble_cb(unsigned char op){
+    switch(op){
+#include "cpu_cb.inc"
+    }
+    return "UNKNOWN";
+}
+
 #define GG_PREFIX_CB() \
     in_out_address[0]++; \
-    return "BITOP (NOT IMPLEMENTED!)";
+    return gg_dbg_disassemble_cb(GG_Read8MMU(mmu, start_address+1));
 
 const char *GG_DBG_Disassemble(void *mmu,
     unsigned *in_out_address,
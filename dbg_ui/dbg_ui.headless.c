@@ -0,0 +1,69 @@
+/* Copyright (c) 2019 Emily McDonough
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "dbg_ui.h"
+#include "dbg_core.h"
+
+#include <assert.h>
+
+/*****************************************************************************/
+/* Headless debugger UI. There is no window to show, and nothing can resume a
+ * paused core. This only exists so that everything links without a window
+ * system.
+ */
+
+struct GG_DBG_UI_s {
+    GG_DBG *dbg;
+};
+
+/*****************************************************************************/
+
+const unsigned gg_dbg_ui_struct_size = sizeof(GG_DBG_UI);
+const unsigned _gg_dbg_ui_struct_size = sizeof(GG_DBG_UI);
+
+/*****************************************************************************/
+
+void GG_InitDebuggerWindowSystem(void){
+
+}
+
+/*****************************************************************************/
+
+void GG_DBG_UI_Init(GG_DBG_UI *ui, GG_DBG *dbg){
+    assert(ui);
+    ui->dbg = dbg;
+}
+
+/*****************************************************************************/
+
+void GG_DBG_UI_Fini(GG_DBG_UI *ui){
+    (void)ui;
+}
+
+/*****************************************************************************/
+
+void GG_DBG_UI_Update(GG_DBG_UI *ui){
+    (void)ui;
+}
+
+/*****************************************************************************/
+
+int GG_DBG_UI_HandleEvents(GG_DBG_UI *ui){
+    (void)ui;
+    return 0;
+}
+
+/*****************************************************************************/
+
+int GG_DBG_UI_NeededLines(const GG_DBG_UI *ui,
+    unsigned *out_start,
+    unsigned *out_end){
+    (void)ui;
+    (void)out_start;
+    (void)out_end;
+    return 0;
+}
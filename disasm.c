@@ -15,8 +15,13 @@
 #if (defined _WIN32) || (defined WIN32) || (defined __CYGWIN__)
 #include "bufferfile_win32.c"
 #else
+/* The MMU maps the ROM straight out of the file where it can */
+#if (defined __unix) && (!defined GG_NO_MMAP)
+#include "bufferfile_mmap.c"
+#else
 #include "bufferfile_unix.c"
 #endif
+#endif
 
 
 int main(int argc, char **argv){
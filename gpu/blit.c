@@ -65,23 +65,179 @@ void GG_DestroyScreen(GG_Screen *scr){
 
 #endif
 
-void GG_BlitLine(GG_Screen *const scr,
-    const unsigned short pattern,
-    const unsigned char x,
-    const unsigned char y){
+/* Decodes one row of a tile. The low byte has the low bits of the colors,
+ * and the highest bit is the leftmost pixel.
+ */
+static void gg_decode_row(unsigned char *out, unsigned low, unsigned high){
+    unsigned x;
+    for(x = 0; x < 8; x++){
+        out[x] = (unsigned char)(((low >> (7 - x)) & 1) |
+            (((high >> (7 - x)) & 1) << 1));
+    }
+}
+
+void GG_DecodeTile(unsigned char *out, const unsigned char *data){
+    unsigned i;
+    for(i = 0; i < 16; i += 2)
+        gg_decode_row(out + (i << 2), data[i], data[i + 1]);
+}
+
+void GG_BlitScanlineScalar(GG_Screen *const scr,
+    const unsigned char *colors,
+    const unsigned short *palette,
+    const unsigned y){
+    
+    unsigned short *const pixels = scr->pixels + (y * 160);
+    unsigned i;
+    for(i = 0; i < 160; i++)
+        pixels[i] = palette[colors[i] & 3];
+}
+
+/* SSE2 is always there on x86-64. SSSE3 has a byte shuffle which does the
+ * palette lookup in one instruction, but it needs to be checked for.
+ */
+#if ((defined __x86_64__) || (defined _M_X64) || (defined __SSE2__)) && \
+    (!defined GG_NO_SIMD)
+
+#define GG_BLIT_SSE2
+#include <emmintrin.h>
+
+#if ((defined __GNUC__) && \
+    ((__GNUC__ > 4) || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))) || \
+    (defined __clang__)
+#define GG_BLIT_SSSE3
+#include <tmmintrin.h>
+#endif
+
+#endif
+
+#ifdef GG_BLIT_SSE2
+
+/* Eight pixels at a time, selecting each palette entry with a compare */
+static void gg_blit_scanline_sse2(GG_Screen *const scr,
+    const unsigned char *colors,
+    const unsigned short *palette,
+    const unsigned y){
+    
+    unsigned short *const pixels = scr->pixels + (y * 160);
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i three = _mm_set1_epi16(3);
+    const __m128i p0 = _mm_set1_epi16((short)palette[0]);
+    const __m128i p1 = _mm_set1_epi16((short)palette[1]);
+    const __m128i p2 = _mm_set1_epi16((short)palette[2]);
+    const __m128i p3 = _mm_set1_epi16((short)palette[3]);
+    unsigned i;
+    
+    for(i = 0; i < 160; i += 8){
+        const __m128i index = _mm_and_si128(three, _mm_unpacklo_epi8(
+            _mm_loadl_epi64((const __m128i*)(colors + i)), zero));
+        __m128i out = _mm_and_si128(p0,
+            _mm_cmpeq_epi16(index, zero));
+        out = _mm_or_si128(out, _mm_and_si128(p1,
+            _mm_cmpeq_epi16(index, _mm_set1_epi16(1))));
+        out = _mm_or_si128(out, _mm_and_si128(p2,
+            _mm_cmpeq_epi16(index, _mm_set1_epi16(2))));
+        out = _mm_or_si128(out, _mm_and_si128(p3,
+            _mm_cmpeq_epi16(index, three)));
+        _mm_storeu_si128((__m128i*)(pixels + i), out);
+    }
+}
+
+#endif
+
+#ifdef GG_BLIT_SSSE3
+
+/* Sixteen pixels at a time. The palette is a table of eight bytes, and each
+ * pixel shuffles in bytes 2*color and 2*color+1.
+ */
+__attribute__((target("ssse3")))
+static void gg_blit_scanline_ssse3(GG_Screen *const scr,
+    const unsigned char *colors,
+    const unsigned short *palette,
+    const unsigned y){
     
+    unsigned short *const pixels = scr->pixels + (y * 160);
+    const __m128i table = _mm_setr_epi16(
+        (short)palette[0], (short)palette[1],
+        (short)palette[2], (short)palette[3],
+        0, 0, 0, 0);
+    const __m128i three = _mm_set1_epi8(3);
+    const __m128i one = _mm_set1_epi8(1);
     unsigned i;
-    unsigned char sprite1 = pattern, sprite2 = (pattern >> 7);
     
-    /* Decode the sprite data into color indices */
-    for(i = 0; i < 8; i++){
-        const unsigned char color = (sprite1 & 1) | (sprite2 & 2);
-        /* TODO: PALETTE NOT SET UP */
-        
-        scr->pixels[x + (y * 160)] = (color << 3) | (color << 8) | (color << 13);
-        
-        sprite1>>=1;
-        sprite2>>=1;
+    for(i = 0; i < 160; i += 16){
+        __m128i index = _mm_and_si128(three,
+            _mm_loadu_si128((const __m128i*)(colors + i)));
+        index = _mm_add_epi8(index, index);
+        _mm_storeu_si128((__m128i*)(pixels + i), _mm_shuffle_epi8(table,
+            _mm_unpacklo_epi8(index, _mm_add_epi8(index, one))));
+        _mm_storeu_si128((__m128i*)(pixels + i + 8), _mm_shuffle_epi8(table,
+            _mm_unpackhi_epi8(index, _mm_add_epi8(index, one))));
     }
+}
+
+#endif
+
+typedef void (*gg_blit_scanline_func)(GG_Screen *scr,
+    const unsigned char *colors,
+    const unsigned short *palette,
+    unsigned y);
+
+static void gg_blit_scanline_detect(GG_Screen *scr,
+    const unsigned char *colors,
+    const unsigned short *palette,
+    unsigned y);
+
+/* Picked the first time a line is drawn */
+static gg_blit_scanline_func gg_blit_scanline = gg_blit_scanline_detect;
+
+static void gg_blit_scanline_detect(GG_Screen *scr,
+    const unsigned char *colors,
+    const unsigned short *palette,
+    unsigned y){
+    
+    gg_blit_scanline_func func = GG_BlitScanlineScalar;
+#ifdef GG_BLIT_SSE2
+    func = gg_blit_scanline_sse2;
+#endif
+#ifdef GG_BLIT_SSSE3
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("ssse3"))
+        func = gg_blit_scanline_ssse3;
+#endif
+    gg_blit_scanline = func;
+    func(scr, colors, palette, y);
+}
+
+void GG_BlitScanline(GG_Screen *const scr,
+    const unsigned char *colors,
+    const unsigned short *palette,
+    const unsigned y){
     
+    gg_blit_scanline(scr, colors, palette, y);
+}
+
+int GG_SetBlitPath(unsigned path){
+    switch(path){
+        case GG_BLIT_PATH_AUTO:
+            gg_blit_scanline = gg_blit_scanline_detect;
+            return 0;
+        case GG_BLIT_PATH_SCALAR:
+            gg_blit_scanline = GG_BlitScanlineScalar;
+            return 0;
+#ifdef GG_BLIT_SSE2
+        case GG_BLIT_PATH_SSE2:
+            gg_blit_scanline = gg_blit_scanline_sse2;
+            return 0;
+#endif
+#ifdef GG_BLIT_SSSE3
+        case GG_BLIT_PATH_SSSE3:
+            __builtin_cpu_init();
+            if(!__builtin_cpu_supports("ssse3"))
+                return 1;
+            gg_blit_scanline = gg_blit_scanline_ssse3;
+            return 0;
+#endif
+    }
+    return 1;
 }
@@ -27,10 +27,48 @@ typedef struct GG_Screen_s GG_Screen;
 GG_Screen *GG_CreateScreen(void);
 void GG_DestroyScreen(GG_Screen *);
 
-void GG_BlitLine(GG_Screen *scr,
-    unsigned short pattern_data,
-    unsigned char x,
-    unsigned char y);
+#define GG_TILE_COUNT 384
+
+/* All the tiles in VRAM, decoded to one color (0 to 3) per byte. Each tile
+ * is 8 rows of 8, starting from the top left.
+ */
+struct GG_TileCache_s {
+    unsigned char tiles[GG_TILE_COUNT][64];
+};
+
+typedef struct GG_TileCache_s GG_TileCache;
+
+/* Decodes a tile from its 16 bytes in VRAM */
+void GG_DecodeTile(unsigned char *out, const unsigned char *data);
+
+/* Draws a whole line of 160 colors. Each color is an index into the four
+ * R5G6B5 entries of the palette, and only its low two bits are used.
+ * This uses SIMD where the CPU has it.
+ */
+void GG_BlitScanline(GG_Screen *scr,
+    const unsigned char *colors,
+    const unsigned short *palette,
+    unsigned y);
+
+/* The same as GG_BlitScanline without SIMD, which the others must match */
+void GG_BlitScanlineScalar(GG_Screen *scr,
+    const unsigned char *colors,
+    const unsigned short *palette,
+    unsigned y);
+
+/* The ways GG_BlitScanline can draw a line. GG_BLIT_PATH_AUTO picks the
+ * fastest one the CPU has, and is the default.
+ */
+#define GG_BLIT_PATH_AUTO 0
+#define GG_BLIT_PATH_SCALAR 1
+#define GG_BLIT_PATH_SSE2 2
+#define GG_BLIT_PATH_SSSE3 3
+
+/* Makes GG_BlitScanline use one path, so each can be checked against
+ * GG_BlitScanlineScalar. Returns non-zero and changes nothing if the path was
+ * not built in or the CPU does not have it.
+ */
+int GG_SetBlitPath(unsigned path);
 
 #ifdef __cplusplus
 } // extern "C"
@@ -0,0 +1,65 @@
+/* Copyright (c) 2019 Emily McDonough
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "gfx.h"
+
+#include "blit.h"
+
+#include <stdlib.h>
+#include <assert.h>
+
+/* Headless graphics backend.
+ * There is no OS window at all, finished frames are just dropped (or counted).
+ * This is used on platforms without a real backend and for benchmarking,
+ * where we want the CPU and GPU to run as fast as they can.
+ */
+
+struct GG_Window_s{
+    /* Number of frames which have been flipped to this window. */
+    unsigned long frames;
+};
+
+void GG_InitGraphics(void){
+
+}
+
+GG_Window *GG_CreateWindow(void){
+    GG_Window *const win = malloc(sizeof(struct GG_Window_s));
+    if(win != NULL)
+        win->frames = 0;
+    return win;
+}
+
+void GG_DestroyWindow(GG_Window *win){
+    free(win);
+}
+
+void GG_Flipscreen(GG_Window *win, void *scr){
+    assert(win != NULL);
+
+    /* A NULL screen is just a request to redraw. */
+    if(scr != NULL)
+        win->frames++;
+}
+
+void GG_HandleEvents(GG_Window *win, void *scr){
+    (void)win;
+    (void)scr;
+}
+
+void GG_BrowseForFile(GG_Window *win,
+    const char *ext,
+    char *out,
+    unsigned out_len){
+
+    (void)win;
+    (void)ext;
+
+    /* No file dialogs without a window system. */
+    if(out_len != 0)
+        out[0] = 0;
+}
@@ -26,6 +26,15 @@ struct GG_GPU_s {
     unsigned modeclock;
     
     GG_Screen *screen;
+    
+    /* The MMU the tiles were decoded from, to decode them all again if it
+     * changes. The MMU's dirty tiles say which ones are out of date.
+     */
+    const void *tiles_mmu;
+    GG_TileCache tiles;
+    
+    /* The line of the window to draw next */
+    unsigned window_line;
 };
 
 const unsigned gg_gpu_struct_size = sizeof(struct GG_GPU_s);
@@ -48,6 +57,14 @@ void GG_GPU_SetMode(GG_GPU *gpu, unsigned char mode){
     gpu->mode = mode;
 }
 
+unsigned char GG_GPU_GetLine(GG_GPU *gpu){
+    return gpu->line;
+}
+
+void GG_GPU_SetLine(GG_GPU *gpu, unsigned char line){
+    gpu->line = line;
+}
+
 unsigned GG_GPU_GetModeClock(GG_GPU *gpu){
     return gpu->modeclock;
 }
@@ -56,92 +73,288 @@ void GG_GPU_SetModeClock(GG_GPU *gpu, unsigned modeclock){
     gpu->modeclock = modeclock;
 }
 
+/* Clocks spent in each mode */
+#define GG_GPU_HBLANK_CLOCKS 816
+#define GG_GPU_VBLANK_CLOCKS 1824
+#define GG_GPU_OAM_CLOCKS 320
+#define GG_GPU_VRAM_CLOCKS 688
+
+#define GG_GPU_LINE_CLOCKS \
+    (GG_GPU_OAM_CLOCKS + GG_GPU_VRAM_CLOCKS + GG_GPU_HBLANK_CLOCKS)
+
+#define GG_GPU_LINES 144
+
+unsigned GG_GPU_GetClocksToVBlank(GG_GPU *gpu){
+    const unsigned modeclock = gpu->modeclock;
+    unsigned clocks, lines;
+    
+    /* Find the clocks to the end of the current line, and how many whole
+     * lines come after that. The line is advanced when it is rendered, at the
+     * end of VRAM mode.
+     */
+    switch(gpu->mode){
+        case GG_GPU_HBLANK_MODE:
+            clocks = GG_GPU_HBLANK_CLOCKS;
+            lines = GG_GPU_LINES - gpu->line;
+            break;
+        case GG_GPU_VBLANK_MODE:
+            /* Finish vblank, then a whole frame. */
+            clocks = (GG_GPU_LINES - gpu->line) * GG_GPU_VBLANK_CLOCKS;
+            lines = GG_GPU_LINES;
+            break;
+        case GG_GPU_OAM_MODE:
+            clocks = GG_GPU_LINE_CLOCKS;
+            lines = GG_GPU_LINES - 1 - gpu->line;
+            break;
+        default: /* GG_GPU_VRAM_MODE */
+            clocks = GG_GPU_VRAM_CLOCKS + GG_GPU_HBLANK_CLOCKS;
+            lines = GG_GPU_LINES - 1 - gpu->line;
+            break;
+    }
+    
+    clocks += lines * GG_GPU_LINE_CLOCKS;
+    
+    /* The modeclock can be past the end of the mode if we were behind. */
+    return (clocks > modeclock) ? (clocks - modeclock) : 1;
+}
+
+unsigned GG_GPU_GetClocksToUpdate(GG_GPU *gpu){
+    static const unsigned mode_clocks[4] = {
+        GG_GPU_HBLANK_CLOCKS,
+        GG_GPU_VBLANK_CLOCKS,
+        GG_GPU_OAM_CLOCKS,
+        GG_GPU_VRAM_CLOCKS
+    };
+    const unsigned clocks = mode_clocks[gpu->mode & 3];
+    
+    /* Same as GG_GPU_GetClocksToVBlank, we may be behind. */
+    return (clocks > gpu->modeclock) ? (clocks - gpu->modeclock) : 1;
+}
+
 static void gg_gpu_flipscreen(GG_GPU *gpu, GG_Window *win){
     GG_Flipscreen(win, gpu->screen);
     GG_HandleEvents(win, gpu->screen);
 }
 
+/* LCDC (FF40) bits */
+#define GG_GPU_LCDC_BG 0x01
+#define GG_GPU_LCDC_SPRITES 0x02
+#define GG_GPU_LCDC_TALL_SPRITES 0x04
+#define GG_GPU_LCDC_BG_MAP 0x08
+#define GG_GPU_LCDC_TILESET 0x10
+#define GG_GPU_LCDC_WINDOW 0x20
+#define GG_GPU_LCDC_WINDOW_MAP 0x40
+#define GG_GPU_LCDC_ENABLE 0x80
+
+/* Sprite attribute bits */
+#define GG_GPU_SPRITE_PALETTE 0x10
+#define GG_GPU_SPRITE_XFLIP 0x20
+#define GG_GPU_SPRITE_YFLIP 0x40
+#define GG_GPU_SPRITE_BEHIND 0x80
+
+#define GG_GPU_SPRITES_PER_LINE 10
+
+/* The four shades, from white to black */
+static const unsigned short gg_gpu_shades[4] = {
+    0xFFFF, 0xAD55, 0x52AA, 0x0000
+};
+
+/* Returns a tile from the cache, decoding it again first if it was written */
+static const unsigned char *gg_gpu_get_tile(GG_GPU *gpu,
+    GG_MMU *mmu,
+    unsigned char *dirty,
+    unsigned tile){
+    
+    if(dirty[tile]){
+        unsigned char data[16];
+        unsigned i;
+        for(i = 0; i < 16; i++)
+            data[i] = (unsigned char)GG_Read8MMU(mmu, 0x8000 + (tile << 4) + i);
+        GG_DecodeTile(gpu->tiles.tiles[tile], data);
+        dirty[tile] = 0;
+    }
+    return gpu->tiles.tiles[tile];
+}
+
+/* Copies one row of a background or window map into colors, starting from
+ * pixel x of the row and going until count pixels are done.
+ */
+static void gg_gpu_render_map(GG_GPU *gpu,
+    GG_MMU *mmu,
+    unsigned char *dirty,
+    unsigned char lcdcontrol,
+    unsigned map_addr,
+    unsigned x,
+    unsigned y,
+    unsigned char *colors,
+    unsigned count){
+    
+    const unsigned row = (y & 7) << 3;
+    
+    map_addr += (y >> 3) << 5;
+    while(count != 0){
+        const unsigned tile_x = x & 7;
+        const unsigned pixels = (8 - tile_x < count) ? (8 - tile_x) : count;
+        unsigned tile = GG_Read8MMU(mmu, map_addr + ((x >> 3) & 31));
+        
+        /* 8800 addressing has signed tile numbers around 9000 */
+        if(!(lcdcontrol & GG_GPU_LCDC_TILESET) && tile < 0x80)
+            tile += 0x100;
+        
+        memcpy(colors, gg_gpu_get_tile(gpu, mmu, dirty, tile) + row + tile_x,
+            pixels);
+        colors += pixels;
+        count -= pixels;
+        x += pixels;
+    }
+}
+
+/* Draws the sprites over a line, with their palettes already applied. The
+ * background colors are needed for sprites that go behind the background.
+ */
+static void gg_gpu_render_sprites(GG_GPU *gpu,
+    GG_MMU *mmu,
+    unsigned char *dirty,
+    unsigned char lcdcontrol,
+    const unsigned char *background,
+    unsigned char *line){
+    
+    const unsigned height =
+        (lcdcontrol & GG_GPU_LCDC_TALL_SPRITES) ? 16 : 8;
+    const unsigned curline = gpu->line;
+    unsigned sprites[GG_GPU_SPRITES_PER_LINE];
+    unsigned char drawn[160];
+    unsigned num_sprites = 0, i, n;
+    
+    /* Only the first ten sprites on the line in OAM are drawn. These are
+     * sorted so that the ones that are drawn on top come first, which is
+     * the lowest X, and then the first in OAM.
+     */
+    for(i = 0; i < 0xA0 && num_sprites < GG_GPU_SPRITES_PER_LINE; i += 4){
+        const unsigned sprite_y = GG_Read8MMU(mmu, 0xFE00 + i);
+        const unsigned sprite_x = GG_Read8MMU(mmu, 0xFE01 + i);
+        if(curline + 16 < sprite_y || curline + 16 >= sprite_y + height)
+            continue;
+        
+        for(n = num_sprites; n != 0; n--){
+            if(GG_Read8MMU(mmu, 0xFE01 + sprites[n - 1]) <= sprite_x)
+                break;
+            sprites[n] = sprites[n - 1];
+        }
+        sprites[n] = i;
+        num_sprites++;
+    }
+    
+    memset(drawn, 0, sizeof(drawn));
+    for(n = 0; n < num_sprites; n++){
+        const unsigned address = 0xFE00 + sprites[n];
+        const unsigned sprite_x = GG_Read8MMU(mmu, address + 1);
+        const unsigned attributes = GG_Read8MMU(mmu, address + 3);
+        const unsigned palette = GG_Read8MMU(mmu,
+            (attributes & GG_GPU_SPRITE_PALETTE) ? 0xFF49 : 0xFF48);
+        unsigned tile = GG_Read8MMU(mmu, address + 2);
+        unsigned row = curline + 16 - GG_Read8MMU(mmu, address);
+        const unsigned char *colors;
+        
+        if(attributes & GG_GPU_SPRITE_YFLIP)
+            row = height - 1 - row;
+        if(height == 16)
+            tile = (tile & 0xFE) | (row >> 3);
+        colors = gg_gpu_get_tile(gpu, mmu, dirty, tile) + ((row & 7) << 3);
+        
+        /* The sprite's X is 8 more than its left edge on the screen */
+        for(i = 0; i < 8; i++){
+            const unsigned x = sprite_x + i - 8;
+            const unsigned color =
+                colors[(attributes & GG_GPU_SPRITE_XFLIP) ? (7 - i) : i];
+            
+            /* Color 0 is clear. Otherwise the first sprite to reach a pixel
+             * keeps it, even if the background is drawn over it.
+             */
+            if(x >= 160 || color == 0 || drawn[x])
+                continue;
+            drawn[x] = 1;
+            if(!(attributes & GG_GPU_SPRITE_BEHIND) || background[x] == 0)
+                line[x] = (unsigned char)((palette >> (color << 1)) & 3);
+        }
+    }
+}
+
 static void gg_gpu_render_line(GG_GPU *gpu, GG_MMU *mmu){
-    /* Get the X/Y values */
     const unsigned char lcdcontrol = GG_Read8MMU(mmu, 0xFF40);
-    /*
-    const unsigned char scrolly = GG_Read8MMU(mmu, 0xFF41);
+    const unsigned char scrolly = GG_Read8MMU(mmu, 0xFF42);
     const unsigned char scrollx = GG_Read8MMU(mmu, 0xFF43);
-    
     const unsigned char backgnd_palette = GG_Read8MMU(mmu, 0xFF47);
-    const unsigned char sprite_palette1 = GG_Read8MMU(mmu, 0xFF48);
-    const unsigned char sprite_palette2 = GG_Read8MMU(mmu, 0xFF49);
-    
     const unsigned char wndy = GG_Read8MMU(mmu, 0xFF4A);
     const unsigned char wndx = GG_Read8MMU(mmu, 0xFF4B);
-    */
-    /* const unsigned char curline = GG_Read8MMU(mmu, 0xFF44); */
+    
     const unsigned char curline = gpu->line;
+    unsigned char *const dirty = GG_GetMMUDirtyTiles(mmu);
+    
+    /* The background and window colors before the palette, which sprites
+     * need for priority, and then the shades of the finished line. The line
+     * is drawn to the screen all at once at the end.
+     */
+    unsigned char background[160];
+    unsigned char line[160];
     
     register int i;
     
-    /* This should have been kept up to date */ /*
-    printf("%i == %i\n", curline, GG_Read8MMU(mmu, 0xFF44));
-    assert(curline == GG_Read8MMU(mmu, 0xFF44));
-    */
+    if(gpu->tiles_mmu != mmu){
+        memset(dirty, 1, GG_MMU_VRAM_TILES);
+        gpu->tiles_mmu = mmu;
+    }
     
-    if(lcdcontrol != 0)
-        printf("ldcontrol=0x%0.2X\n", lcdcontrol);
+    /* The window has its own line, which only moves when it is drawn */
+    if(curline == 0)
+        gpu->window_line = 0;
     
-    /* Draw Background. 
-     * Bit 0 of LCDCONTROL enables/disables the background
-     */
-    if(lcdcontrol & 1){
-        const unsigned short background_tileset_addr =
-            (lcdcontrol & (1<<3)) ? 0x8000 : 0x8800;
-        const unsigned short background_map_addr =
-            (lcdcontrol & (1<<3)) ? 0x9C00: 0x9800;
-        register int x;
-        const int tile_y = curline >> 3;
-        i = curline & 7;
-        /* TODO: Actually do scrolling. This just draws the first
-         * 20x18 tiles
-         */
-        for(x = 0; x < 20; x++){
-            /* Read what the tile is */
-            const unsigned char pattern_index = GG_Read8MMU(mmu,
-                background_map_addr + x + (tile_y << 5));
-            
-            /* Load and draw the tile */
-            const unsigned short tile_line = GG_Read16MMU(mmu,
-                background_tileset_addr + (pattern_index << 4) + (i << 1));
-            
-            GG_BlitLine(gpu->screen, tile_line, x << 3, curline);
-        }
+    if(!(lcdcontrol & GG_GPU_LCDC_ENABLE)){
+        memset(line, 0, sizeof(line));
+        GG_BlitScanline(gpu->screen, line, gg_gpu_shades, curline);
+        GG_Write8MMU(mmu, 0xFF44, ++(gpu->line));
+        return;
     }
     
-    /* Draw Sprites */
-    for(i = 0; i < 160; i+=4){
-        const unsigned char spritex = GG_Read8MMU(mmu, 0xFE00 + i);
-        const unsigned char spritey = GG_Read8MMU(mmu, 0xFE01 + i);
+    /* Bit 0 of LCDCONTROL turns off both the background and the window */
+    if(lcdcontrol & GG_GPU_LCDC_BG){
+        const unsigned background_map_addr =
+            (lcdcontrol & GG_GPU_LCDC_BG_MAP) ? 0x9C00 : 0x9800;
+        gg_gpu_render_map(gpu, mmu, dirty, lcdcontrol,
+            background_map_addr,
+            scrollx,
+            (curline + scrolly) & 0xFF,
+            background,
+            160);
         
-        if(spritex == 0 && spritey == 0){
-            /* Sprite is hidden */
-            continue;
+        /* The window's left edge is at WX - 7 */
+        if((lcdcontrol & GG_GPU_LCDC_WINDOW) && curline >= wndy && wndx < 167){
+            const unsigned window_map_addr =
+                (lcdcontrol & GG_GPU_LCDC_WINDOW_MAP) ? 0x9C00 : 0x9800;
+            const unsigned start = (wndx < 7) ? 0 : (wndx - 7);
+            gg_gpu_render_map(gpu, mmu, dirty, lcdcontrol,
+                window_map_addr,
+                start + 7 - wndx,
+                gpu->window_line,
+                background + start,
+                160 - start);
+            gpu->window_line++;
         }
-        else if(spritey > curline || spritey + 8 <= curline){
-            /* Sprite isn't present on this line. */
-            continue;
-        }
-        else{
-            const unsigned char pattern_line = curline - spritey;
-            const unsigned char pattern_index = GG_Read8MMU(mmu, 0xFE02 + i);
-            
-            /* Load and draw the sprite */
-            const unsigned short sprite_line = GG_Read16MMU(mmu,
-                0x8000 + (pattern_index << 4) + (pattern_line << 2));
-            
-            assert(pattern_line < 8);
-            
-            /* Draw the sprite line */
-            GG_BlitLine(gpu->screen, sprite_line, spritex, curline);
+        
+        for(i = 0; i < 160; i++){
+            line[i] =
+                (unsigned char)((backgnd_palette >> (background[i] << 1)) & 3);
         }
     }
+    else{
+        memset(background, 0, sizeof(background));
+        memset(line, 0, sizeof(line));
+    }
+    
+    if(lcdcontrol & GG_GPU_LCDC_SPRITES)
+        gg_gpu_render_sprites(gpu, mmu, dirty, lcdcontrol, background, line);
+    
+    GG_BlitScanline(gpu->screen, line, gg_gpu_shades, curline);
     
     /* Update GPU memory */
     GG_Write8MMU(mmu, 0xFF44, ++(gpu->line));
@@ -163,10 +376,10 @@ unsigned GG_GPU_Advance(GG_GPU *gpu,
         unsigned new_clock = old_clock + clock;
         switch(gpu->mode){
             case GG_GPU_HBLANK_MODE: /* 0 */
-                if(new_clock >= 816){
+                if(new_clock >= GG_GPU_HBLANK_CLOCKS){
                     const unsigned old_line = gpu->line;
-                    new_clock -= 816;
-                    if(old_line == 144){
+                    new_clock -= GG_GPU_HBLANK_CLOCKS;
+                    if(old_line == GG_GPU_LINES){
                         /* Enter VBLANK. */
                         gpu->mode = GG_GPU_VBLANK_MODE;
                         gg_gpu_flipscreen(gpu, win);
@@ -175,17 +388,17 @@ unsigned GG_GPU_Advance(GG_GPU *gpu,
                             cb(cb_arg);
                     }
                     else{
+                        /* The line was already advanced by the render. */
                         gpu->mode = GG_GPU_OAM_MODE;
-                        gpu->line = old_line + 1;
                     }
                 }
                 break;
             case GG_GPU_VBLANK_MODE: /* 1 */
-                if(new_clock >= 1824){
-                    new_clock -= 1824;
+                if(new_clock >= GG_GPU_VBLANK_CLOCKS){
+                    new_clock -= GG_GPU_VBLANK_CLOCKS;
                     /* VBLANK */
                     gpu->line++;
-                    if(gpu->line >= 144){
+                    if(gpu->line >= GG_GPU_LINES){
                         /* Restart scanline mode */
                         gpu->line = 0;
                         gpu->mode = GG_GPU_OAM_MODE;
@@ -194,14 +407,14 @@ unsigned GG_GPU_Advance(GG_GPU *gpu,
                 }
                 break;
             case GG_GPU_OAM_MODE: /* 2 */
-                if(new_clock >= 320){
-                    new_clock -= 320;
+                if(new_clock >= GG_GPU_OAM_CLOCKS){
+                    new_clock -= GG_GPU_OAM_CLOCKS;
                     gpu->mode = GG_GPU_VRAM_MODE;
                 }
                 break;
             case GG_GPU_VRAM_MODE: /* 3 */
-                if(new_clock >= 688){
-                    new_clock -= 688;
+                if(new_clock >= GG_GPU_VRAM_CLOCKS){
+                    new_clock -= GG_GPU_VRAM_CLOCKS;
                     gpu->mode = GG_GPU_HBLANK_MODE;
                     gg_gpu_render_line(gpu, mmu);
                 }
@@ -51,6 +51,16 @@ GG_GPU_FUNC(void) GG_GPU_SetLine(GG_GPU *gpu, unsigned char line);
 GG_GPU_FUNC(unsigned) GG_GPU_GetModeClock(GG_GPU *gpu);
 GG_GPU_FUNC(void) GG_GPU_SetModeClock(GG_GPU *gpu, unsigned modeclock);
 
+/* Returns how many clocks until the GPU next enters vblank. If the GPU is
+ * already in vblank, this is the clocks until the following vblank.
+ */
+GG_GPU_FUNC(unsigned) GG_GPU_GetClocksToVBlank(GG_GPU *gpu);
+
+/* Returns how many clocks until the GPU next changes mode, or changes line
+ * while in vblank. Advancing by less than this only updates the modeclock.
+ */
+GG_GPU_FUNC(unsigned) GG_GPU_GetClocksToUpdate(GG_GPU *gpu);
+
 typedef GG_GPU_CALLBACK(void, on_gpu_advance_callback)(void *arg);
 
 /* Returns the current mode */
@@ -76,25 +86,6 @@ GG_GPU_FUNC(unsigned) GG_GPU_Advance(GG_GPU *gpu,
 #define GG_GPU_GETMODECLOCK(GPU) (*GG_GPU_DATA(GPU, unsigned, 4))
 #define GG_GPU_SETMODECLOCK(GPU, ARG) (*GG_GPU_DATA(GPU, unsigned, 4) = (ARG))
 
-/* This is safe to use as a macro on any architecture, but it's only really
- * useful on x86. It tries to avoid diving into GG_GPU_Advance if possible.
- */
-#define GG_GPU_ADVANCE(GPU, WIN, MMU, CLOCK, CB, ARG) \
-    do{ \
-        const unsigned GG_GPU_ADVANCE_mode = GG_GPU_GETMODE(GPU);\
-        const unsigned GG_GPU_ADVANCE_modeclock = \
-            GG_GPU_GETMODECLOCK(GPU) + (CLOCK);\
-        if( (GG_GPU_ADVANCE_mode == 0 && GG_GPU_ADVANCE_modeclock >= 816) || \
-            (GG_GPU_ADVANCE_mode == 1 && GG_GPU_ADVANCE_modeclock >= 1824) || \
-            (GG_GPU_ADVANCE_mode == 2 && GG_GPU_ADVANCE_modeclock >= 320) || \
-            (GG_GPU_ADVANCE_mode == 3 && GG_GPU_ADVANCE_modeclock >= 688)) { \
-            GG_GPU_Advance(GPU, WIN, MMU, CLOCK, CB, ARG); \
-        } \
-        else {\
-            GG_GPU_SETMODECLOCK(GPU, GG_GPU_ADVANCE_modeclock);\
-        } \
-    }while(0)
-
 #else
 
 #define GG_GPU_GETMODE GG_GPU_GetMode
@@ -103,7 +94,6 @@ GG_GPU_FUNC(unsigned) GG_GPU_Advance(GG_GPU *gpu,
 #define GG_GPU_SETLINE GG_GPU_GetLine
 #define GG_GPU_GETMODECLOCK GG_GPU_GetModeClock
 #define GG_GPU_SETMODECLOCK GG_GPU_SetModeClock
-#define GG_GPU_ADVANCE GG_GPU_Advance
 
 #endif
 
@@ -0,0 +1,427 @@
+/* Copyright (c) 2019 Emily McDonough
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "mmu/mmu.h"
+#include "cpu/cpu.h"
+#include "gpu/gfx.h"
+#include "gpu/gpu.h"
+#include "test_random.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Checks the JIT against the interpreter.
+ * Every rom runs with the JIT off, on, and in check mode, and all three have
+ * to end with the same registers, cycles and memory. Check mode also has to
+ * report no mismatches. The roms are built here: a few cases for things the
+ * core, the JIT or the block cache got wrong before, and then random blocks
+ * of opcodes.
+ * Any roms on the command line are run as well. Returns non-zero if any rom
+ * failed.
+ * On anything but x86-64 every mode is the interpreter, so this always
+ * passes there.
+ */
+#if (defined _WIN32) || (defined WIN32) || (defined __CYGWIN__)
+#include "bufferfile_win32.c"
+#elif (defined __unix) && (!defined GG_NO_MMAP)
+#include "bufferfile_mmap.c"
+#else
+#include "bufferfile_unix.c"
+#endif
+
+/* Get alloca */
+#if (defined _MSC_VER) || (defined __WATCOMC__)
+#include <malloc.h>
+#elif (defined __TINYC__)
+#include <stddef.h>
+#else
+#include <alloca.h>
+#endif
+
+#define GG_JIT_TEST_ROM_SIZE 0x10000
+#define GG_JIT_TEST_RANDOM_ROMS 300
+#define GG_JIT_TEST_RANDOM_OPS 48
+
+/* Enough for the hot blocks to be compiled and run for a while */
+#define GG_JIT_TEST_CYCLES (70224 * 4)
+#define GG_JIT_TEST_DEFAULT_FRAMES 60
+
+static const char *const gg_jit_test_modes[] = {
+    "off",
+    "on",
+    "check"
+};
+
+/* Everything that has to come out the same in each mode */
+struct GG_JIT_TestState{
+    unsigned registers[6];
+    unsigned long cycles;
+    unsigned long instructions;
+    unsigned char memory[0x8000];
+};
+
+/* The next byte is assembled at at, and size is what the MMU is given */
+struct GG_JIT_TestRom{
+    unsigned char data[GG_JIT_TEST_ROM_SIZE];
+    unsigned size;
+    unsigned at;
+};
+
+static void gg_jit_test_byte(struct GG_JIT_TestRom *rom, unsigned value){
+    rom->data[rom->at++] = (unsigned char)value;
+}
+
+static void gg_jit_test_word(struct GG_JIT_TestRom *rom, unsigned value){
+    gg_jit_test_byte(rom, value & 0xFF);
+    gg_jit_test_byte(rom, value >> 8);
+}
+
+/* jp loop */
+static void gg_jit_test_loop(struct GG_JIT_TestRom *rom, unsigned loop){
+    gg_jit_test_byte(rom, 0xC3);
+    gg_jit_test_word(rom, loop);
+}
+
+/* A rom with no mapper that jumps to 0150, with the stack in work RAM */
+static void gg_jit_test_start(struct GG_JIT_TestRom *rom){
+    memset(rom->data, 0, sizeof(rom->data));
+    rom->size = 0x8000;
+    rom->at = 0x100;
+    /* nop ; jp 0150 */
+    gg_jit_test_byte(rom, 0x00);
+    gg_jit_test_byte(rom, 0xC3);
+    gg_jit_test_word(rom, 0x150);
+    rom->at = 0x150;
+    /* di ; ld sp, DFF0 */
+    gg_jit_test_byte(rom, 0xF3);
+    gg_jit_test_byte(rom, 0x31);
+    gg_jit_test_word(rom, 0xDFF0);
+}
+
+/* Writes to VRAM go through the MMU, and have to be read back in the same
+ * block.
+ */
+static void gg_jit_test_vram(struct GG_JIT_TestRom *rom){
+    unsigned loop;
+    gg_jit_test_start(rom);
+    loop = rom->at;
+    /* ld hl, 8940 ; inc (hl) ; sbc a, (hl) ; ld (hl), a ; add a, (hl) ;
+     * inc hl ; ld (hl+), a ; xor (hl)
+     */
+    gg_jit_test_byte(rom, 0x21);
+    gg_jit_test_word(rom, 0x8940);
+    gg_jit_test_byte(rom, 0x34);
+    gg_jit_test_byte(rom, 0x9E);
+    gg_jit_test_byte(rom, 0x77);
+    gg_jit_test_byte(rom, 0x86);
+    gg_jit_test_byte(rom, 0x23);
+    gg_jit_test_byte(rom, 0x22);
+    gg_jit_test_byte(rom, 0xAE);
+    gg_jit_test_loop(rom, loop);
+}
+
+/* jp a16 used to land two bytes past its target, and jp hl used to jump
+ * through memory at hl. Each jump lands on an ld a, imm that the broken
+ * version would skip, and the rom leaves what it loaded at C000 and C001.
+ */
+static const unsigned char gg_jit_test_jump_expect[] = { 0x11, 0x22 };
+
+static void gg_jit_test_jump(struct GG_JIT_TestRom *rom){
+    unsigned loop, target;
+    gg_jit_test_start(rom);
+    loop = rom->at;
+    /* xor a ; jp target */
+    gg_jit_test_byte(rom, 0xAF);
+    gg_jit_test_byte(rom, 0xC3);
+    target = rom->at + 2;
+    gg_jit_test_word(rom, target);
+    /* target: ld a, 11 ; ld (C000), a ; xor a ; ld hl, target ; jp hl */
+    gg_jit_test_byte(rom, 0x3E);
+    gg_jit_test_byte(rom, 0x11);
+    gg_jit_test_byte(rom, 0xEA);
+    gg_jit_test_word(rom, 0xC000);
+    gg_jit_test_byte(rom, 0xAF);
+    gg_jit_test_byte(rom, 0x21);
+    target = rom->at + 3;
+    gg_jit_test_word(rom, target);
+    gg_jit_test_byte(rom, 0xE9);
+    /* target: ld a, 22 ; ld (C001), a */
+    gg_jit_test_byte(rom, 0x3E);
+    gg_jit_test_byte(rom, 0x22);
+    gg_jit_test_byte(rom, 0xEA);
+    gg_jit_test_word(rom, 0xC001);
+    gg_jit_test_loop(rom, loop);
+}
+
+/* The immediate of an op at the end of bank 0 is in the switchable bank, so
+ * the op has to be decoded again for each bank. The rom calls the op at 3FFF
+ * with bank 1 and then bank 2, and leaves what it loaded at C000 and C001.
+ */
+static const unsigned char gg_jit_test_bank_expect[] = { 0x11, 0x22 };
+
+static void gg_jit_test_bank(struct GG_JIT_TestRom *rom){
+    unsigned loop, bank;
+    gg_jit_test_start(rom);
+    /* MBC1 with four banks */
+    rom->size = 0x10000;
+    rom->data[0x147] = 0x01;
+    rom->data[0x148] = 0x01;
+    loop = rom->at;
+    for(bank = 1; bank <= 2; bank++){
+        /* ld a, bank ; ld (2000), a ; call 3FFF ; ld (C000 + bank - 1), a */
+        gg_jit_test_byte(rom, 0x3E);
+        gg_jit_test_byte(rom, bank);
+        gg_jit_test_byte(rom, 0xEA);
+        gg_jit_test_word(rom, 0x2000);
+        gg_jit_test_byte(rom, 0xCD);
+        gg_jit_test_word(rom, 0x3FFF);
+        gg_jit_test_byte(rom, 0xEA);
+        gg_jit_test_word(rom, 0xC000 + bank - 1);
+    }
+    gg_jit_test_loop(rom, loop);
+    /* ld a, imm ; ret, with the immediate and the ret in each bank */
+    rom->data[0x3FFF] = 0x3E;
+    for(bank = 1; bank <= 3; bank++){
+        rom->data[bank << 14] = (unsigned char)(bank * 0x11);
+        rom->data[(bank << 14) + 1] = 0xC9;
+    }
+}
+
+/* Opcodes left out of random blocks. They leave the block, stop the CPU, or
+ * move the stack somewhere the next pass can't put back.
+ */
+static int gg_jit_test_skip_opcode(unsigned opcode){
+    switch(opcode){
+        case 0x10: case 0x18: case 0x20: case 0x28: case 0x30: case 0x38:
+        case 0x31: case 0x76: case 0xC0: case 0xC2: case 0xC3: case 0xC4:
+        case 0xC8: case 0xC9: case 0xCA: case 0xCC: case 0xCD: case 0xD0:
+        case 0xD2: case 0xD3: case 0xD4: case 0xD8: case 0xD9: case 0xDA:
+        case 0xDB: case 0xDC: case 0xDD: case 0xE3: case 0xE4: case 0xE8:
+        case 0xE9: case 0xEB: case 0xEC: case 0xED: case 0xF3: case 0xF4:
+        case 0xF9: case 0xFB: case 0xFC: case 0xFD:
+            return 1;
+    }
+    /* rst */
+    return (opcode & 0xC7) == 0xC7;
+}
+
+static unsigned gg_jit_test_opcode_length(unsigned opcode){
+    switch(opcode){
+        case 0x01: case 0x08: case 0x11: case 0x21: case 0xEA: case 0xFA:
+            return 3;
+        case 0x06: case 0x0E: case 0x16: case 0x1E: case 0x26: case 0x2E:
+        case 0x36: case 0x3E: case 0xC6: case 0xCB: case 0xCE: case 0xD6:
+        case 0xDE: case 0xE0: case 0xE6: case 0xEE: case 0xF0: case 0xF6:
+        case 0xF8: case 0xFE:
+            return 2;
+    }
+    return 1;
+}
+
+/* Every pass starts with the registers pointing into RAM, and then runs
+ * random opcodes with random immediates.
+ */
+static void gg_jit_test_random_rom(struct GG_JIT_TestRom *rom){
+    unsigned loop, i;
+    gg_jit_test_start(rom);
+    loop = rom->at;
+    /* ld sp, DFF0 ; ld bc, C100 ; ld de, 8900 ; ld hl, C080 */
+    gg_jit_test_byte(rom, 0x31);
+    gg_jit_test_word(rom, 0xDFF0);
+    gg_jit_test_byte(rom, 0x01);
+    gg_jit_test_word(rom, 0xC100);
+    gg_jit_test_byte(rom, 0x11);
+    gg_jit_test_word(rom, 0x8900);
+    gg_jit_test_byte(rom, 0x21);
+    gg_jit_test_word(rom, 0xC080);
+    for(i = 0; i < GG_JIT_TEST_RANDOM_OPS; i++){
+        unsigned opcode, length;
+        do{
+            opcode = gg_test_random() & 0xFF;
+        }while(gg_jit_test_skip_opcode(opcode));
+        length = gg_jit_test_opcode_length(opcode);
+        gg_jit_test_byte(rom, opcode);
+        while(--length != 0)
+            gg_jit_test_byte(rom, gg_test_random());
+    }
+    gg_jit_test_loop(rom, loop);
+}
+
+static void gg_jit_test_run(struct GG_JIT_TestState *state,
+    const void *rom,
+    unsigned rom_size,
+    unsigned mode,
+    unsigned long cycles,
+    unsigned long *mismatches){
+
+    GG_MMU *const mmu = GG_CreateMMU();
+    GG_CPU *const cpu = alloca(gg_cpu_struct_size);
+    GG_GPU *const gpu = alloca(gg_gpu_struct_size);
+    GG_Window *const win = GG_CreateWindow();
+    unsigned i;
+
+    GG_SetMMURom(mmu, rom, rom_size);
+    GG_CPU_Init(cpu, mmu);
+    GG_CPU_SetJIT(cpu, mode);
+    GG_GPU_Init(gpu);
+
+    while(GG_CPU_GetCycles(cpu) < cycles)
+        GG_CPU_RunCycles(cpu, mmu, gpu, win, NULL, NULL, NULL, 70224);
+
+    state->registers[0] = GG_CPU_GetAF(cpu);
+    state->registers[1] = GG_CPU_GetBC(cpu);
+    state->registers[2] = GG_CPU_GetDE(cpu);
+    state->registers[3] = GG_CPU_GetHL(cpu);
+    state->registers[4] = GG_CPU_GetSP(cpu);
+    state->registers[5] = GG_CPU_GetIP(cpu);
+    state->cycles = GG_CPU_GetCycles(cpu);
+    state->instructions = GG_CPU_GetInstructions(cpu);
+    for(i = 0; i < 0x8000; i++)
+        state->memory[i] = (unsigned char)GG_Read8MMU(mmu, 0x8000 + i);
+    *mismatches = GG_CPU_GetJITMismatches(cpu);
+
+    GG_DestroyWindow(win);
+    GG_DestroyMMU(mmu);
+    GG_CPU_Fini(cpu);
+    GG_GPU_Fini(gpu);
+}
+
+/* Returns non-zero and reports the first difference if the rom failed. If
+ * expect is not NULL, the rom also has to leave those bytes at C000.
+ */
+static int gg_jit_test_rom(const char *name,
+    const void *rom,
+    unsigned rom_size,
+    unsigned long cycles,
+    const unsigned char *expect,
+    unsigned expect_size){
+
+    static struct GG_JIT_TestState states[3];
+    unsigned long mismatches[3];
+    unsigned mode, i;
+    int failed = 0;
+
+    for(mode = GG_CPU_JIT_OFF; mode <= GG_CPU_JIT_CHECK; mode++)
+        gg_jit_test_run(states + mode, rom, rom_size, mode, cycles,
+            mismatches + mode);
+
+    for(mode = GG_CPU_JIT_ON; mode <= GG_CPU_JIT_CHECK; mode++){
+        const struct GG_JIT_TestState *const a = states + GG_CPU_JIT_OFF;
+        const struct GG_JIT_TestState *const b = states + mode;
+
+        if(memcmp(a->registers, b->registers, sizeof(a->registers)) != 0){
+            printf("%s: JIT %s ends with AF=%04X BC=%04X DE=%04X HL=%04X"
+                " SP=%04X IP=%04X, not AF=%04X BC=%04X DE=%04X HL=%04X"
+                " SP=%04X IP=%04X\n",
+                name, gg_jit_test_modes[mode],
+                b->registers[0], b->registers[1], b->registers[2],
+                b->registers[3], b->registers[4], b->registers[5],
+                a->registers[0], a->registers[1], a->registers[2],
+                a->registers[3], a->registers[4], a->registers[5]);
+            failed = 1;
+        }
+        if(a->cycles != b->cycles || a->instructions != b->instructions){
+            printf("%s: JIT %s ran %lu cycles and %lu instructions, not"
+                " %lu and %lu\n",
+                name, gg_jit_test_modes[mode], b->cycles, b->instructions,
+                a->cycles, a->instructions);
+            failed = 1;
+        }
+        for(i = 0; i < 0x8000; i++){
+            if(a->memory[i] != b->memory[i]){
+                printf("%s: JIT %s has %02X at %04X, not %02X\n",
+                    name, gg_jit_test_modes[mode], b->memory[i], 0x8000 + i,
+                    a->memory[i]);
+                failed = 1;
+                break;
+            }
+        }
+    }
+
+    for(i = 0; i < expect_size; i++){
+        const unsigned value = states[GG_CPU_JIT_OFF].memory[0x4000 + i];
+        if(value != expect[i]){
+            printf("%s: %02X at %04X, not %02X\n",
+                name, value, 0xC000 + i, expect[i]);
+            failed = 1;
+            break;
+        }
+    }
+
+    if(mismatches[GG_CPU_JIT_CHECK] != 0){
+        printf("%s: JIT check reported %lu mismatches\n",
+            name, mismatches[GG_CPU_JIT_CHECK]);
+        failed = 1;
+    }
+
+    return failed;
+}
+
+int main(int argc, char **argv){
+    static struct GG_JIT_TestRom rom;
+    unsigned long num_frames = GG_JIT_TEST_DEFAULT_FRAMES;
+    unsigned i, failed = 0, num_roms = 0;
+    char name[32];
+
+    if(argc >= 3 && strcmp(argv[1], "-f") == 0){
+        if((num_frames = strtoul(argv[2], NULL, 10)) == 0){
+            printf("Invalid number of frames %s\n", argv[2]);
+            return 1;
+        }
+        argv += 2;
+        argc -= 2;
+    }
+
+    GG_InitGraphics();
+
+    gg_jit_test_vram(&rom);
+    failed += gg_jit_test_rom("vram", rom.data, rom.size,
+        GG_JIT_TEST_CYCLES, NULL, 0);
+    num_roms++;
+
+    gg_jit_test_jump(&rom);
+    failed += gg_jit_test_rom("jump", rom.data, rom.size,
+        GG_JIT_TEST_CYCLES, gg_jit_test_jump_expect,
+        sizeof(gg_jit_test_jump_expect));
+    num_roms++;
+
+    gg_jit_test_bank(&rom);
+    failed += gg_jit_test_rom("bank", rom.data, rom.size,
+        GG_JIT_TEST_CYCLES, gg_jit_test_bank_expect,
+        sizeof(gg_jit_test_bank_expect));
+    num_roms++;
+
+    for(i = 0; i < GG_JIT_TEST_RANDOM_ROMS; i++){
+        gg_jit_test_random_rom(&rom);
+        sprintf(name, "random %u", i);
+        failed += gg_jit_test_rom(name, rom.data, rom.size,
+            GG_JIT_TEST_CYCLES, NULL, 0);
+        num_roms++;
+    }
+
+    for(i = 1; i < (unsigned)argc; i++){
+        int rom_size;
+        const void *const data = BufferFile(argv[i], &rom_size);
+        if(data == NULL){
+            printf("Could not open rom %s\n", argv[i]);
+            failed++;
+            continue;
+        }
+        failed += gg_jit_test_rom(argv[i], data, rom_size,
+            num_frames * 70224, NULL, 0);
+        num_roms++;
+        FreeBufferFile(data, rom_size);
+    }
+
+    if(failed != 0){
+        printf("FAILED %u of %u roms\n", failed, num_roms);
+        return 1;
+    }
+    printf("%u roms ok\n", num_roms);
+    return 0;
+}
@@ -16,13 +16,20 @@
 #include <assert.h>
 #include <stdlib.h>
 #include <stdio.h>
-#include <Windows.h>
 
 #if (defined _WIN32) || (defined WIN32) || (defined __CYGWIN__)
 #include "bufferfile_win32.c"
+#define GG_YIELD() SwitchToThread()
+#else
+/* The MMU maps the ROM straight out of the file where it can */
+#if (defined __unix) && (!defined GG_NO_MMAP)
+#include "bufferfile_mmap.c"
 #else
 #include "bufferfile_unix.c"
 #endif
+#include <sched.h>
+#define GG_YIELD() sched_yield()
+#endif
 
 /* Get alloca */
 #if (defined _MSC_VER) || (defined __WATCOMC__)
@@ -64,9 +71,9 @@ int main(int argc, char *argv[]){
     
     /* Create and show the window */
     win = GG_CreateWindow();
-    SwitchToThread();
+    GG_YIELD();
     GG_Flipscreen(win, NULL);
-    SwitchToThread();
+    GG_YIELD();
     
     /* Get the rom name. */
     
@@ -140,6 +147,7 @@ int main(int argc, char *argv[]){
     
     GG_DestroyWindow(win);
     GG_DestroyMMU(mmu);
+    GG_CPU_Fini(cpu);
     GG_GPU_Fini(gpu);
     return 0;
 }
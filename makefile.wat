@@ -1,25 +1,26 @@
 # Any copyright is dedicated to the Public Domain.
 # http://creativecommons.org/publicdomain/zero/1.0/
 
-all: gg.exe gg_disasm.exe gg_dbg_test.exe
+all: gg.exe gg_disasm.exe gg_dbg_test.exe gg_blit_test.exe
 
 # TODO: Swap bc to be bg?
 WCCFLAGS=-ox -zw -bc -br -6r -we -wx -hd -ri -i=cpu -i=mmu -i=gpu -i=dbg -dWIN32 -q
 WLINKFLAGS=op map SYS nt op quiet
 PROGRAM=gg.exe
 DISASM_PROGRAM=gg_disasm.exe
-CPU_OBJECTS=cpu_timings.obj cpu_length.obj cpu.obj
+CPU_OBJECTS=cpu_timings.obj cpu_length.obj cpu_flow.obj cpu_access.obj cpu_block.obj cpu_jit.obj cpu_sched.obj cpu_timer.obj cpu_profile.obj cpu.obj
 GPU_OBJECTS=gpu.obj blit.obj gfx.win32.obj 
-DBG_OBJECTS=dbg_ui.obj dbg.win32.obj dbg_disasm.obj dbg_gg.obj
+DBG_OBJECTS=dbg_ui.obj dbg.win32.obj dbg_disasm.obj dbg_cond.obj dbg_gg.obj
 OBJECTS=main.obj mmu.obj $(CPU_OBJECTS) $(GPU_OBJECTS) $(DBG_OBJECTS)
 DISASM_OBJECTS=mmu.obj disasm.obj cpu_timings.obj cpu_length.obj dbg_disasm.obj
 DBG_TEST_OBJECTS=dbg_test.obj mmu.obj $(DBG_OBJECTS)
+BLIT_TEST_OBJECTS=blit_test.obj blit.obj
 
 hybrid: main.obj cpu.obj gg.dll gg.def
 	wlink $(WLINKFLAGS) FILE { main.obj cpu.obj } LIBRARY gg.lib NAME gg.exe
 	type nul > hybrid
 
-cpu.obj: cpu\cpu.c cpu\cpu.h cpu\cpu_dummy.h cpu\cpu.inc mmu\mmu.h
+cpu.obj: cpu\cpu.c cpu\cpu.h cpu\cpu_defs.h cpu\cpu_sched.h cpu\cpu_timer.h cpu\cpu_profile.h cpu\cpu_block.h cpu\cpu_jit.h cpu\cpu_dummy.h cpu\cpu_run.inc cpu\cpu.inc cpu\cpu_cb.inc mmu\mmu.h gpu\gpu.h
 	wcc386 cpu\cpu.c $(WCCFLAGS)
 
 cpu_length.obj: cpu\cpu_length.c cpu\cpu.inc
@@ -28,6 +29,27 @@ cpu_length.obj: cpu\cpu_length.c cpu\cpu.inc
 cpu_timings.obj: cpu\cpu_timings.c cpu\cpu.inc
 	wcc386 cpu\cpu_timings.c $(WCCFLAGS)
 
+cpu_flow.obj: cpu\cpu_flow.c cpu\cpu_flow.h cpu\cpu.inc
+	wcc386 cpu\cpu_flow.c $(WCCFLAGS)
+
+cpu_access.obj: cpu\cpu_access.c cpu\cpu_access.h cpu\cpu_dummy_meta.h cpu\cpu.inc cpu\cpu_cb.inc
+	wcc386 cpu\cpu_access.c $(WCCFLAGS)
+
+cpu_block.obj: cpu\cpu_block.c cpu\cpu_block.h cpu\cpu_jit.h cpu\cpu_access.h cpu\cpu_flow.h cpu\cpu_length.h cpu\cpu_timings.h mmu\mmu.h
+	wcc386 cpu\cpu_block.c $(WCCFLAGS)
+
+cpu_sched.obj: cpu\cpu_sched.c cpu\cpu_sched.h
+	wcc386 cpu\cpu_sched.c $(WCCFLAGS)
+
+cpu_timer.obj: cpu\cpu_timer.c cpu\cpu_timer.h cpu\cpu_sched.h cpu\cpu.h gpu\gpu.h mmu\mmu.h
+	wcc386 cpu\cpu_timer.c $(WCCFLAGS)
+
+cpu_profile.obj: cpu\cpu_profile.c cpu\cpu_profile.h cpu\cpu.h gpu\gpu.h mmu\mmu.h dbg_core\dbg_core.h
+	wcc386 cpu\cpu_profile.c $(WCCFLAGS)
+
+cpu_jit.obj: cpu\cpu_jit.c cpu\cpu_jit.h cpu\cpu_defs.h cpu\cpu_sched.h cpu\cpu_timer.h cpu\cpu_profile.h cpu\cpu_block.h cpu\cpu_length.h cpu\cpu_dummy_meta.h cpu\cpu.inc
+	wcc386 cpu\cpu_jit.c $(WCCFLAGS)
+
 dbg_ui.obj: dbg\dbg_ui.c dbg\dbg.h
 	wcc386 dbg\dbg_ui.c $(WCCFLAGS)
 
@@ -40,6 +62,9 @@ dbg.win32.obj: dbg\dbg.win32.c dbg\dbg.h
 dbg_disasm.obj: dbg\dbg_disasm.c dbg\dbg.h cpu\cpu.inc cpu\cpu_dummy.h
 	wcc386 dbg\dbg_disasm.c $(WCCFLAGS)
 
+dbg_cond.obj: dbg_core\dbg_cond.c dbg_core\dbg_cond.h dbg_core\dbg_core.h cpu\cpu.h gpu\gpu.h cpu\cpu_defs.h mmu\mmu.h
+	wcc386 dbg_core\dbg_cond.c $(WCCFLAGS)
+
 mmu.obj: mmu\mmu.c mmu\mmu.h
 	wcc386 mmu\mmu.c $(WCCFLAGS)
 
@@ -64,6 +89,9 @@ disasm.obj: disasm.c mmu\mmu.h dbg\dbg.h
 dbg_test.obj: dbg_test.c dbg\dbg.h
 	wcc386 dbg_test.c $(WCCFLAGS)
 
+blit_test.obj: blit_test.c gpu\blit.h test_random.h
+	wcc386 blit_test.c $(WCCFLAGS)
+
 gg.exe: $(OBJECTS)
 	wlink $(WLINKFLAGS) FILE { $(OBJECTS) } NAME gg.exe
 
@@ -72,3 +100,6 @@ gg_disasm.exe: $(DISASM_OBJECTS)
 
 gg_dbg_test.exe: $(DBG_TEST_OBJECTS)
 	wlink $(WLINKFLAGS) FILE { $(DBG_TEST_OBJECTS) } NAME gg_dbg_test.exe
+
+gg_blit_test.exe: $(BLIT_TEST_OBJECTS)
+	wlink $(WLINKFLAGS) FILE { $(BLIT_TEST_OBJECTS) } NAME gg_blit_test.exe
@@ -1,6 +1,9 @@
 #include "mmu.h"
 
+#include <assert.h>
 #include <string.h>
+#include <stdlib.h>
+#include <time.h>
 
 #ifndef NDEBUG
 #include <stdio.h>
@@ -9,25 +12,117 @@
 #define DEBUG_ONLY(X)
 #endif
 
-union GG_MMU_u {
-    unsigned char mem[0x10000];
-    struct {
-        const char rom[0x8000];
-        char ram[0x8000];
-    } rw;
+/* Everything from 0x8000 up. The ROM and cartridge RAM live outside of this,
+ * and are only reached through the page table.
+ */
+union GG_MMU_Memory {
+    unsigned char mem[0x8000];
     struct {
-        char bank0[0x4000];
-        char bank1[0x4000]; /* TODO! */
         char vram[0x2000];
-        char extram[0x2000];
-        char ram[0x2000]; /* MIRRORED! */
-        char ram_mirror[0x1E00]; /* MIRRORED! */
+        char extram[0x2000]; /* Only used if the cart has no mapper */
+        char ram[0x2000];
+        char echo[0x1E00]; /* Never used, echo RAM reads and writes ram */
         char sprites[0x100];
         char mmio[0x80];
         char zero[0x80];
     } banks;
 };
 
+#define GG_MMU_NONE 0
+#define GG_MMU_MBC1 1
+#define GG_MMU_MBC3 2
+#define GG_MMU_MBC5 3
+
+/* MBC3 clock registers, selected by writing 0x08 to 0x0C to 0x4000 */
+#define GG_MMU_RTC_SECONDS 0
+#define GG_MMU_RTC_MINUTES 1
+#define GG_MMU_RTC_HOURS 2
+#define GG_MMU_RTC_DAY_LOW 3
+#define GG_MMU_RTC_DAY_HIGH 4
+#define GG_MMU_RTC_REGISTERS 5
+
+#define GG_MMU_RTC_HALT 0x40
+#define GG_MMU_RTC_CARRY 0x80
+
+/* The clock runs off the host's time. While it is halted, seconds holds the
+ * count, otherwise the count is the seconds since base.
+ */
+struct GG_MMU_RTC {
+    time_t base;
+    unsigned long seconds;
+    unsigned char halted, carry;
+    unsigned char latch_ready;
+    unsigned char latched[GG_MMU_RTC_REGISTERS];
+};
+
+/* Handlers for one MMIO register, see GG_SetMMUIOHandler */
+struct GG_MMU_IO {
+    GG_MMU_IORead read;
+    GG_MMU_IOWrite write;
+    void *arg;
+};
+
+struct GG_MMU_s {
+    /* The macros in mmu.h use read, write, and banks directly, so these have
+     * to stay first and in this order.
+     *
+     * Indexed by address >> 12, the byte at an address is
+     * read[address >> 12][address & 0xFFF]. Bank switches only swap these.
+     */
+    const unsigned char *read[16];
+    /* NULL where writes go to the mapper instead of memory, and for VRAM so
+     * that writes there mark tiles as dirty. Page F is NULL for both, see
+     * GG_MMU_HIGH.
+     */
+    unsigned char *write[16];
+    /* Bank mapped at 0x0000 and 0x4000, after masking */
+    unsigned short banks[2];
+    /* The read pages and then the write pages, less the page's address, for
+     * GG_GetMMUPages
+     */
+    const unsigned char *jit_pages[32];
+
+    /* The ROM as passed to GG_SetMMURom, which is not copied */
+    const unsigned char *rom;
+    /* Whole 4KB pages in the ROM */
+    unsigned rom_pages;
+    /* The ROM size rounded up to a power of two banks, at least two */
+    unsigned rom_banks;
+    /* At least one bank if there is any RAM at all */
+    unsigned char *ram;
+    unsigned ram_banks;
+
+    unsigned char mapper;
+    unsigned char has_rtc;
+    unsigned char ram_enabled;
+    /* MBC1 banking mode */
+    unsigned char mode;
+    /* The bank register as written. For MBC1 this is only the low 5 bits. */
+    unsigned rom_bank;
+    /* RAM bank, MBC1 upper bank bits, or an RTC register from 0x08 */
+    unsigned char ram_bank;
+
+    struct GG_MMU_RTC rtc;
+
+    /* Read by anything that isn't mapped, including past the end of ROM */
+    unsigned char unmapped[0x1000];
+    /* The last page of a ROM that isn't a whole number of pages, padded */
+    unsigned char rom_tail[0x1000];
+    /* The latched RTC register, when one is mapped */
+    unsigned char rtc_page[0x1000];
+    
+    /* Indexed by address & 0x7F, only for FF00 to FF7F */
+    struct GG_MMU_IO io[0x80];
+    
+    /* See GG_GetMMUDirtyTiles */
+    unsigned char dirty_tiles[GG_MMU_VRAM_TILES];
+
+    union GG_MMU_Memory memory;
+};
+
+/* Read by the ROM pages before a ROM is loaded */
+static const unsigned char gg_mmu_empty_page[0x1000];
+
 #if (defined __unix) && (!defined GG_NO_MMAP)
 
 #include <unistd.h>
@@ -37,62 +132,374 @@ union GG_MMU_u {
 #define MAP_ANONYMOUS MAP_ANON
 #endif
 
-static union GG_MMU_u *gg_alloc_mmu(void){
+static struct GG_MMU_s *gg_alloc_mmu(void){
     void *const r = mmap(NULL,
-        sizeof(union GG_MMU_u),
+        sizeof(struct GG_MMU_s),
         PROT_READ|PROT_WRITE,
         MAP_PRIVATE|MAP_ANONYMOUS,
         -1, 0);
     return r;
 }
 
-static void gg_dealloc_mmu(const union GG_MMU_u *mmu){
-    munmap((void*)mmu, sizeof(union GG_MMU_u));
+static void gg_dealloc_mmu(const struct GG_MMU_s *mmu){
+    munmap((void*)mmu, sizeof(struct GG_MMU_s));
 }
 
 #elif (defined WIN32) || (defined _WIN32)
 
 #include <Windows.h>
 
-static union GG_MMU_u *gg_alloc_mmu(void){
+static struct GG_MMU_s *gg_alloc_mmu(void){
     void *const data = VirtualAlloc(NULL,
-        sizeof(union GG_MMU_u),
+        sizeof(struct GG_MMU_s),
         MEM_COMMIT|MEM_RESERVE,
         PAGE_READWRITE);
     
-    VirtualLock(data, sizeof(union GG_MMU_u));
+    VirtualLock(data, sizeof(struct GG_MMU_s));
     
     return data;
 }
-    
-static void gg_dealloc_mmu(const union GG_MMU_u *mmu){
+
+static void gg_dealloc_mmu(const struct GG_MMU_s *mmu){
     VirtualFree((void*)mmu, 0, MEM_RELEASE);
 }
 
 #else
 
-#include <stdlib.h>
-static union GG_MMU_u *gg_alloc_mmu(void){
-    return malloc(sizeof(union GG_MMU_u));
+static struct GG_MMU_s *gg_alloc_mmu(void){
+    return malloc(sizeof(struct GG_MMU_s));
 }
 
-static void gg_dealloc_mmu(const union GG_MMU_u *mmu){
+static void gg_dealloc_mmu(const struct GG_MMU_s *mmu){
     free((void*)mmu);
 }
 
 #endif
 
-void GG_SetMMURom(GG_MMU *mmu, const void *rom, unsigned len){
-    if(len < 0x8000){
-        memcpy(mmu->mem, rom, len);
+static void gg_mmu_map(GG_MMU *mmu,
+    unsigned page,
+    const unsigned char *read,
+    unsigned char *write){
+    
+    mmu->read[page] = read;
+    mmu->write[page] = write;
+    mmu->jit_pages[page] = (read != NULL) ? (read - (page << 12)) : NULL;
+    mmu->jit_pages[16 + page] = (write != NULL) ? (write - (page << 12)) : NULL;
+}
+
+/*****************************************************************************/
+/* MBC3 clock */
+
+static unsigned long gg_mmu_rtc_seconds(const struct GG_MMU_RTC *rtc){
+    double seconds;
+    if(rtc->halted)
+        return rtc->seconds;
+    /* The host's clock can go backwards */
+    seconds = difftime(time(NULL), rtc->base);
+    return (seconds > 0) ? (unsigned long)seconds : 0;
+}
+
+static void gg_mmu_rtc_set_seconds(struct GG_MMU_RTC *rtc,
+    unsigned long seconds){
+    
+    rtc->seconds = seconds;
+    if(!rtc->halted)
+        rtc->base = time(NULL) - (time_t)seconds;
+}
+
+static void gg_mmu_rtc_init(struct GG_MMU_RTC *rtc){
+    rtc->halted = 0;
+    rtc->carry = 0;
+    rtc->latch_ready = 0;
+    gg_mmu_rtc_set_seconds(rtc, 0);
+    memset(rtc->latched, 0, GG_MMU_RTC_REGISTERS);
+}
+
+/* The day counter is nine bits, and sets the carry when it overflows */
+static unsigned long gg_mmu_rtc_wrap(struct GG_MMU_RTC *rtc){
+    const unsigned long limit = 512ul * 24 * 60 * 60;
+    unsigned long seconds = gg_mmu_rtc_seconds(rtc);
+    if(seconds >= limit){
+        seconds %= limit;
+        rtc->carry = 1;
+        gg_mmu_rtc_set_seconds(rtc, seconds);
+    }
+    return seconds;
+}
+
+static void gg_mmu_rtc_latch(struct GG_MMU_RTC *rtc){
+    const unsigned long seconds = gg_mmu_rtc_wrap(rtc);
+    const unsigned long days = seconds / (24 * 60 * 60);
+    rtc->latched[GG_MMU_RTC_SECONDS] = (unsigned char)(seconds % 60);
+    rtc->latched[GG_MMU_RTC_MINUTES] = (unsigned char)((seconds / 60) % 60);
+    rtc->latched[GG_MMU_RTC_HOURS] = (unsigned char)((seconds / 3600) % 24);
+    rtc->latched[GG_MMU_RTC_DAY_LOW] = (unsigned char)days;
+    rtc->latched[GG_MMU_RTC_DAY_HIGH] = (unsigned char)((days >> 8) |
+        (rtc->halted ? GG_MMU_RTC_HALT : 0) |
+        (rtc->carry ? GG_MMU_RTC_CARRY : 0));
+}
+
+static void gg_mmu_rtc_write(struct GG_MMU_RTC *rtc,
+    unsigned reg,
+    unsigned val){
+    
+    const unsigned long old = gg_mmu_rtc_wrap(rtc);
+    unsigned long seconds = old % 60;
+    unsigned long minutes = (old / 60) % 60;
+    unsigned long hours = (old / 3600) % 24;
+    unsigned long days = old / (24 * 60 * 60);
+    
+    switch(reg){
+        case GG_MMU_RTC_SECONDS: seconds = (val & 0x3F) % 60; break;
+        case GG_MMU_RTC_MINUTES: minutes = (val & 0x3F) % 60; break;
+        case GG_MMU_RTC_HOURS: hours = (val & 0x1F) % 24; break;
+        case GG_MMU_RTC_DAY_LOW: days = (days & 0x100) | (val & 0xFF); break;
+        case GG_MMU_RTC_DAY_HIGH:
+            days = (days & 0xFF) | ((val & 1) << 8);
+            rtc->carry = (val & GG_MMU_RTC_CARRY) != 0;
+            /* While halted the count is kept in seconds */
+            rtc->halted = (val & GG_MMU_RTC_HALT) != 0;
+            break;
+    }
+    
+    gg_mmu_rtc_set_seconds(rtc,
+        seconds + (60 * (minutes + (60 * (hours + (24 * days))))));
+}
+
+/*****************************************************************************/
+
+/* The memory for a 4KB page of the ROM */
+static const unsigned char *gg_mmu_rom_page(const GG_MMU *mmu,
+    unsigned page){
+    
+    if(mmu->rom == NULL)
+        return gg_mmu_empty_page;
+    if(page < mmu->rom_pages)
+        return mmu->rom + ((unsigned long)page << 12);
+    if(page == mmu->rom_pages)
+        return mmu->rom_tail;
+    return mmu->unmapped;
+}
+
+/* Maps the ROM banks, and the RAM or RTC register, for the mapper state */
+static void gg_mmu_map_cart(GG_MMU *mmu){
+    const unsigned rom_mask = mmu->rom_banks - 1;
+    unsigned low = 0, high = mmu->rom_bank, ram_bank = 0, i;
+    
+    switch(mmu->mapper){
+        case GG_MMU_MBC1:
+            high = ((unsigned)mmu->ram_bank << 5) | (high ? high : 1);
+            if(mmu->mode){
+                low = (unsigned)mmu->ram_bank << 5;
+                ram_bank = mmu->ram_bank;
+            }
+            break;
+        case GG_MMU_MBC3:
+            if(high == 0)
+                high = 1;
+            ram_bank = mmu->ram_bank;
+            break;
+        case GG_MMU_MBC5:
+            ram_bank = mmu->ram_bank;
+            break;
+        default:
+            high = 1;
+    }
+    
+    mmu->banks[0] = (unsigned short)(low & rom_mask);
+    mmu->banks[1] = (unsigned short)(high & rom_mask);
+    
+    for(i = 0; i < 4; i++){
+        gg_mmu_map(mmu, i,
+            gg_mmu_rom_page(mmu, ((unsigned)mmu->banks[0] << 2) + i),
+            NULL);
+        gg_mmu_map(mmu, i + 4,
+            gg_mmu_rom_page(mmu, ((unsigned)mmu->banks[1] << 2) + i),
+            NULL);
+    }
+    
+    if(mmu->mapper == GG_MMU_NONE){
+        /* Without a mapper there is nothing to enable, so this is RAM */
+        unsigned char *const ram = (mmu->ram != NULL) ?
+            mmu->ram : (unsigned char*)mmu->memory.banks.extram;
+        gg_mmu_map(mmu, 0xA, ram, ram);
+        gg_mmu_map(mmu, 0xB, ram + 0x1000, ram + 0x1000);
+    }
+    else if(!mmu->ram_enabled){
+        gg_mmu_map(mmu, 0xA, mmu->unmapped, NULL);
+        gg_mmu_map(mmu, 0xB, mmu->unmapped, NULL);
+    }
+    else if(mmu->mapper == GG_MMU_MBC3 && ram_bank >= 0x08){
+        /* Writes to the clock go through the mapper */
+        const unsigned reg = ram_bank - 0x08;
+        memset(mmu->rtc_page,
+            (mmu->has_rtc && reg < GG_MMU_RTC_REGISTERS) ?
+                mmu->rtc.latched[reg] : 0xFF,
+            0x1000);
+        gg_mmu_map(mmu, 0xA, mmu->rtc_page, NULL);
+        gg_mmu_map(mmu, 0xB, mmu->rtc_page, NULL);
+    }
+    else if(mmu->ram_banks != 0){
+        unsigned char *const ram =
+            mmu->ram + ((unsigned long)(ram_bank & (mmu->ram_banks - 1)) << 13);
+        gg_mmu_map(mmu, 0xA, ram, ram);
+        gg_mmu_map(mmu, 0xB, ram + 0x1000, ram + 0x1000);
     }
     else{
-        memcpy(mmu->mem, rom, 0x8000);
+        gg_mmu_map(mmu, 0xA, mmu->unmapped, NULL);
+        gg_mmu_map(mmu, 0xB, mmu->unmapped, NULL);
+    }
+}
+
+/* Writes to the ROM, or to cartridge RAM that isn't writable right now */
+static void gg_mmu_write_cart(GG_MMU *mmu, unsigned i, unsigned val){
+    val &= 0xFF;
+    
+    if(i >= 0x8000){
+        /* Writes to the clock registers while they are mapped */
+        if(mmu->mapper == GG_MMU_MBC3 && mmu->has_rtc && mmu->ram_enabled &&
+            mmu->ram_bank >= 0x08 &&
+            mmu->ram_bank - 0x08 < GG_MMU_RTC_REGISTERS){
+            gg_mmu_rtc_write(&mmu->rtc, mmu->ram_bank - 0x08, val);
+            /* Reads still come from the latched value */
+        }
+        return;
+    }
+    
+    switch(mmu->mapper){
+        case GG_MMU_MBC1:
+            switch(i >> 13){
+                case 0: mmu->ram_enabled = ((val & 0x0F) == 0x0A); break;
+                case 1: mmu->rom_bank = val & 0x1F; break;
+                case 2: mmu->ram_bank = (unsigned char)(val & 0x03); break;
+                case 3: mmu->mode = (unsigned char)(val & 0x01); break;
+            }
+            break;
+        case GG_MMU_MBC3:
+            switch(i >> 13){
+                case 0: mmu->ram_enabled = ((val & 0x0F) == 0x0A); break;
+                case 1: mmu->rom_bank = val & 0x7F; break;
+                case 2: mmu->ram_bank = (unsigned char)val; break;
+                case 3:
+                    /* Writing 0 and then 1 latches the clock */
+                    if(val == 1 && mmu->rtc.latch_ready && mmu->has_rtc)
+                        gg_mmu_rtc_latch(&mmu->rtc);
+                    mmu->rtc.latch_ready = (val == 0);
+                    break;
+            }
+            break;
+        case GG_MMU_MBC5:
+            switch(i >> 12){
+                case 0: case 1:
+                    mmu->ram_enabled = ((val & 0x0F) == 0x0A);
+                    break;
+                case 2:
+                    mmu->rom_bank = (mmu->rom_bank & 0x100) | val;
+                    break;
+                case 3:
+                    mmu->rom_bank = (mmu->rom_bank & 0xFF) | ((val & 1) << 8);
+                    break;
+                case 4: case 5:
+                    mmu->ram_bank = (unsigned char)(val & 0x0F);
+                    break;
+            }
+            break;
+        default:
+            return;
+    }
+    
+    gg_mmu_map_cart(mmu);
+}
+
+/*****************************************************************************/
+
+static void gg_mmu_unload(GG_MMU *mmu){
+    free(mmu->ram);
+    mmu->rom = NULL;
+    mmu->ram = NULL;
+    mmu->rom_pages = 0;
+    mmu->rom_banks = 2;
+    mmu->ram_banks = 0;
+    mmu->mapper = GG_MMU_NONE;
+    mmu->has_rtc = 0;
+}
+
+static void gg_mmu_reset_cart(GG_MMU *mmu){
+    mmu->ram_enabled = 0;
+    mmu->mode = 0;
+    mmu->rom_bank = 1;
+    mmu->ram_bank = 0;
+    gg_mmu_rtc_init(&mmu->rtc);
+    gg_mmu_map_cart(mmu);
+}
+
+/* Reads the mapper and RAM size out of the cartridge header */
+static void gg_mmu_read_header(GG_MMU *mmu,
+    const unsigned char *rom,
+    unsigned len){
+    
+    unsigned ram_size = 0;
+    
+    mmu->mapper = GG_MMU_NONE;
+    mmu->has_rtc = 0;
+    if(len < 0x150)
+        return;
+    
+    switch(rom[0x147]){
+        case 0x01: case 0x02: case 0x03:
+            mmu->mapper = GG_MMU_MBC1;
+            break;
+        case 0x0F: case 0x10:
+            mmu->has_rtc = 1;
+            /* FALLTHROUGH */
+        case 0x11: case 0x12: case 0x13:
+            mmu->mapper = GG_MMU_MBC3;
+            break;
+        case 0x19: case 0x1A: case 0x1B: case 0x1C: case 0x1D: case 0x1E:
+            mmu->mapper = GG_MMU_MBC5;
+            break;
+    }
+    
+    switch(rom[0x149]){
+        case 0x01: /* 2KB, but it still gets a whole bank */
+        case 0x02: ram_size = 1; break;
+        case 0x03: ram_size = 4; break;
+        case 0x04: ram_size = 16; break;
+        case 0x05: ram_size = 8; break;
+    }
+    mmu->ram_banks = ram_size;
+}
+
+void GG_SetMMURom(GG_MMU *mmu, const void *rom, unsigned len){
+    unsigned banks = 2;
+    
+    gg_mmu_unload(mmu);
+    
+    while(((unsigned long)banks << 14) < len && banks < 0x200)
+        banks <<= 1;
+    if(len > ((unsigned long)banks << 14))
+        len = (unsigned)((unsigned long)banks << 14);
+    
+    /* Only a partial page at the end is copied */
+    mmu->rom = rom;
+    mmu->rom_pages = len >> 12;
+    mmu->rom_banks = banks;
+    memset(mmu->rom_tail, 0xFF, 0x1000);
+    memcpy(mmu->rom_tail,
+        mmu->rom + ((unsigned long)mmu->rom_pages << 12),
+        len & 0xFFF);
+    
+    gg_mmu_read_header(mmu, rom, len);
+    if(mmu->ram_banks != 0 &&
+        (mmu->ram = calloc(mmu->ram_banks, 0x2000)) == NULL){
+        mmu->ram_banks = 0;
     }
+    
+    gg_mmu_reset_cart(mmu);
 }
 
-const unsigned gg_mmu_struct_size = sizeof(union GG_MMU_u);
-const unsigned _gg_mmu_struct_size = sizeof(union GG_MMU_u);
+const unsigned gg_mmu_struct_size = sizeof(struct GG_MMU_s);
+const unsigned _gg_mmu_struct_size = sizeof(struct GG_MMU_s);
 
 GG_MMU *GG_CreateMMU(void){
     return GG_InitMMU(gg_alloc_mmu());
@@ -102,96 +509,192 @@ void GG_DestroyMMU(GG_MMU *mmu){
     gg_dealloc_mmu(GG_FiniMMU(mmu));
 }
 
+/* OAM DMA. The whole copy happens at once, instead of over 160 cycles. */
+static GG_MMU_FUNC(void) gg_mmu_dma_write(void *arg,
+    GG_MMU *mmu,
+    unsigned address,
+    unsigned value){
+    
+    const unsigned source = (value & 0xFF) << 8;
+    unsigned i;
+    (void)arg;
+    
+    GG_SetMMUIO(mmu, address, value);
+    for(i = 0; i < 0xA0; i++)
+        mmu->memory.banks.sprites[i] = (char)GG_Read8MMU(mmu, source + i);
+}
+
 GG_MMU *GG_InitMMU(GG_MMU *mmu){
-    (void)mmu;
+    unsigned char *const mem = mmu->memory.mem;
+    unsigned i;
+    
+    memset(mmu->unmapped, 0xFF, 0x1000);
+    
+    for(i = 0; i < 0x80; i++)
+        GG_SetMMUIOHandler(mmu, 0xFF00 + i, NULL, NULL, NULL);
+    GG_SetMMUIOHandler(mmu, 0xFF46, NULL, gg_mmu_dma_write, NULL);
+    
+    /* The cart pages are mapped by gg_mmu_reset_cart. VRAM is only mapped
+     * for reads, see gg_mmu_write_vram.
+     */
+    gg_mmu_map(mmu, 8, mem, NULL);
+    gg_mmu_map(mmu, 9, mem + 0x1000, NULL);
+    memset(mmu->dirty_tiles, 1, GG_MMU_VRAM_TILES);
+    for(i = 0xC; i < 15; i++)
+        gg_mmu_map(mmu, i, mem + ((i - 8) << 12), mem + ((i - 8) << 12));
+    /* The first page of echo RAM is the same memory as work RAM */
+    gg_mmu_map(mmu, 0xE, mem + 0x4000, mem + 0x4000);
+    gg_mmu_map(mmu, 0xF, NULL, NULL);
+    
+    mmu->rom = NULL;
+    mmu->ram = NULL;
+    gg_mmu_unload(mmu);
+    gg_mmu_reset_cart(mmu);
     return mmu;
 }
 
 GG_MMU *GG_FiniMMU(GG_MMU *mmu){
+    gg_mmu_unload(mmu);
     return mmu;
 }
 
-unsigned GG_Read8MMU(const GG_MMU *mmu, unsigned i){
-    return (unsigned)(mmu->mem[i]);
+unsigned char *GG_GetMMUDirtyTiles(GG_MMU *mmu){
+    return mmu->dirty_tiles;
+}
+
+const unsigned char *const *GG_GetMMUPages(const GG_MMU *mmu){
+    return mmu->jit_pages;
 }
 
-#if (defined __i386) || (defined _M_IX86) || (defined __x86_64__)
+unsigned GG_GetMMUBank(const GG_MMU *mmu, unsigned i){
+    return (i & 0x8000) ? 0 : mmu->banks[(i >> 14) & 1];
+}
 
-#define GG_WRITE16(TO, VAL) do{ \
-        ((unsigned short*)(TO))[0] = (VAL); \
-    } while(0)
+void GG_SetMMUIOHandler(GG_MMU *mmu,
+    unsigned address,
+    GG_MMU_IORead read,
+    GG_MMU_IOWrite write,
+    void *arg){
+    
+    struct GG_MMU_IO *const io = mmu->io + (address & 0x7F);
+    assert((address & 0xFF80) == 0xFF00);
+    io->read = read;
+    io->write = write;
+    io->arg = arg;
+}
 
-#define GG_READ16(FRM) (0+(*((unsigned short*)(FRM))))
+int GG_HasMMUIOHandler(const GG_MMU *mmu, unsigned address){
+    const struct GG_MMU_IO *const io = mmu->io + (address & 0x7F);
+    assert((address & 0xFF80) == 0xFF00);
+    return io->read != NULL || io->write != NULL;
+}
 
-#else
+unsigned GG_GetMMUIO(const GG_MMU *mmu, unsigned address){
+    assert((address & 0xFF80) == 0xFF00);
+    return (unsigned char)mmu->memory.banks.mmio[address & 0x7F];
+}
 
-#define GG_WRITE16(TO, VAL) do{ \
-        ((char*)(TO))[0] = (VAL); \
-        ((char*)(TO))[1] = (VAL) << 8; \
-    } while(0)
+void GG_SetMMUIO(GG_MMU *mmu, unsigned address, unsigned val){
+    assert((address & 0xFF80) == 0xFF00);
+    mmu->memory.banks.mmio[address & 0x7F] = (char)val;
+}
 
-#define GG_READ16(FRM) ( \
-        ((unsigned char*)(FRM))[0] | \
-        ((unsigned char*)(FRM))[1] \
-    )
+int GG_IsMMUBankFixed(const GG_MMU *mmu, unsigned i){
+    if(i & 0x8000)
+        return 1;
+    if(i & 0x4000)
+        return mmu->mapper == GG_MMU_NONE;
+    /* Only MBC1 carts with more than 512KB of ROM can switch the low bank */
+    return mmu->mapper != GG_MMU_MBC1 || mmu->rom_banks <= 0x20;
+}
 
-#endif
+unsigned GG_ReadBankMMU(const GG_MMU *mmu, unsigned bank, unsigned i){
+    unsigned page;
+    if(i & 0x8000)
+        return GG_Read8MMU(mmu, i);
+    page = ((bank & (mmu->rom_banks - 1)) << 2) | ((i >> 12) & 3);
+    return gg_mmu_rom_page(mmu, page)[i & 0xFFF];
+}
+
+#define GG_MMU_PAGE(I) (((I) >> 12) & 0xF)
+#define GG_MMU_OFFSET(I) ((I) & 0xFFF)
+
+/* Page F is the rest of echo RAM below FE00, and OAM, MMIO, and HRAM above
+ * it. Those can't share one page, so it isn't in the page table.
+ */
+#define GG_MMU_HIGH(MMU, I) ((MMU)->memory.mem + \
+    (((I) < 0xFE00) ? ((I) - 0xA000) : ((I) - 0x8000)))
+
+/* The handlers for I, if it is an MMIO register */
+#define GG_MMU_IO(MMU, I) \
+    ((((I) & 0xFF80) == 0xFF00) ? ((MMU)->io + ((I) & 0x7F)) : NULL)
+
+static unsigned gg_mmu_read_high(const GG_MMU *mmu, unsigned i){
+    const struct GG_MMU_IO *const io = GG_MMU_IO(mmu, i);
+    /* Handlers can bring their registers up to date, so they get to write */
+    if(io != NULL && io->read != NULL)
+        return io->read(io->arg, (GG_MMU*)mmu, i) & 0xFF;
+    return (unsigned char)*GG_MMU_HIGH(mmu, i);
+}
+
+static void gg_mmu_write_high(GG_MMU *mmu, unsigned i, unsigned val){
+    const struct GG_MMU_IO *const io = GG_MMU_IO(mmu, i);
+    if(io != NULL && io->write != NULL)
+        io->write(io->arg, mmu, i, val & 0xFF);
+    else
+        *GG_MMU_HIGH(mmu, i) = (char)val;
+}
+
+unsigned GG_Read8MMU(const GG_MMU *mmu, unsigned i){
+    const unsigned char *const page = mmu->read[GG_MMU_PAGE(i)];
+    if(page != NULL)
+        return (unsigned)(page[GG_MMU_OFFSET(i)]);
+    return gg_mmu_read_high(mmu, i & 0xFFFF);
+}
 
 unsigned GG_Read16MMU(const GG_MMU *mmu, unsigned i){
-    const char *mem = mmu->mem;
-    return GG_READ16(mem+i);
+    const unsigned char *const page = mmu->read[GG_MMU_PAGE(i)];
+    /* Both bytes are on the same page unless this is the last byte */
+    if(GG_MMU_OFFSET(i) != 0xFFF && page != NULL)
+        return GG_READ16(page + GG_MMU_OFFSET(i));
+    return GG_Read8MMU(mmu, i) | (GG_Read8MMU(mmu, i + 1) << 8);
 }
 
-#define GG_RAM_IS_LO_MIRROR(SI) ((SI) >= 0x4000 && (SI) < 0x5E00)
-#define GG_RAM_IS_HI_MIRROR(SI) ((SI) >= 0x6000 && (SI) < 0x7E00)
-#define GG_RAM_LO(MMU, SI) ((MMU)->banks.ram[((SI) - 0x6000)])
-#define GG_RAM_HI(MMU, SI) ((MMU)->banks.ram_mirror[((SI) - 0x4000)])
+/* VRAM writes also mark the tile, if it is in the tile data (to 97FF) */
+static void gg_mmu_write_vram(GG_MMU *mmu, unsigned i, unsigned val){
+    const unsigned offset = i - 0x8000;
+    mmu->memory.banks.vram[offset] = (char)val;
+    if(offset < (GG_MMU_VRAM_TILES << 4))
+        mmu->dirty_tiles[offset >> 4] = 1;
+}
 
+/* Writes through the page table. Anything that isn't mapped is either VRAM,
+ * the mapper, or page F, which has the MMIO handlers.
+ */
 #define GG_RAM_WRITE8(MMU, I, VAL) do{ \
-        unsigned GG_val; \
-        const int GG_si = (I) - 0x8000; \
-        union GG_MMU_u *const GG_mmu = (MMU); \
-        \
-        if(GG_si < 0) break; \
+        GG_MMU *const GG_mmu = (MMU); \
+        const unsigned GG_i = (I) & 0xFFFF; \
+        unsigned char *const GG_page = GG_mmu->write[GG_MMU_PAGE(GG_i)]; \
+        const unsigned GG_val = (VAL); \
         \
-        GG_val = (VAL); \
-        \
-        GG_mmu->rw.ram[GG_si] = GG_val; \
-        if(GG_RAM_IS_LO_MIRROR(GG_si)){ \
-            GG_RAM_HI(GG_mmu, GG_si) = GG_val; \
-        } \
-        else if(GG_RAM_IS_HI_MIRROR(GG_si)){ \
-            GG_RAM_LO(GG_mmu, GG_si) = GG_val; \
-        } \
-    }while(0)
-
-#define GG_RAM_WRITE16(MMU, I, VAL) do{ \
-        unsigned GG_val; \
-        const int GG_si = (I) - 0x8000; \
-        union GG_MMU_u *const GG_mmu = (MMU); \
-        \
-        if(GG_si < 0) break; \
-        \
-        GG_val = (VAL); \
-        \
-        GG_mmu->rw.ram[GG_si] = GG_val; \
-        GG_mmu->rw.ram[GG_si+1] = GG_val >> 8; \
-        if(GG_RAM_IS_LO_MIRROR(GG_si)){ \
-            GG_WRITE16(&GG_RAM_HI(GG_mmu, GG_si), GG_val); \
-        } \
-        else if(GG_RAM_IS_HI_MIRROR(GG_si)){ \
-            GG_WRITE16(&GG_RAM_LO(GG_mmu, GG_si), GG_val); \
-        } \
+        if(GG_page != NULL) \
+            GG_page[GG_MMU_OFFSET(GG_i)] = GG_val; \
+        else if(GG_i >= 0xF000) \
+            gg_mmu_write_high(GG_mmu, GG_i, GG_val); \
+        else if((GG_i & 0xE000) == 0x8000) \
+            gg_mmu_write_vram(GG_mmu, GG_i, GG_val); \
+        else \
+            gg_mmu_write_cart(GG_mmu, GG_i, GG_val); \
     }while(0)
 
 unsigned GG_Inc8MMU(GG_MMU *mmu, unsigned i){
-    unsigned result = mmu->mem[i];
+    unsigned result = GG_Read8MMU(mmu, i);
     GG_RAM_WRITE8(mmu, i, ++result);
     return result;
 }
 
 unsigned GG_Dec8MMU(GG_MMU *mmu, unsigned i){
-    unsigned result = mmu->mem[i];
+    unsigned result = GG_Read8MMU(mmu, i);
     GG_RAM_WRITE8(mmu, i, --result);
     return result;
 }
@@ -200,8 +703,14 @@ void GG_Write8MMU(GG_MMU *mmu, unsigned i, unsigned val){
     GG_RAM_WRITE8(mmu, i, val);
 }
 
-/* TODO! This needs better checks on the borders of ram areas. */
 void GG_Write16MMU(GG_MMU *mmu, unsigned i, unsigned val){
-    GG_RAM_WRITE8(mmu, i, val);
+    unsigned char *const page = mmu->write[GG_MMU_PAGE(i)];
+    /* Otherwise each byte can be somewhere else, such as the mapper or MMIO */
+    if(GG_MMU_OFFSET(i) != 0xFFF && page != NULL){
+        GG_WRITE16(page + GG_MMU_OFFSET(i), val);
+    }
+    else{
+        GG_RAM_WRITE8(mmu, i, val);
+        GG_RAM_WRITE8(mmu, i + 1, val >> 8);
+    }
 }
-
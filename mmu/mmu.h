@@ -17,10 +17,25 @@
 #define GG_MMU_FUNC GG_STDCALL
 #endif
 
-union GG_MMU_u;
-typedef union GG_MMU_u GG_MMU;
+#define GG_MMU_CALLBACK GG_STDCALL_CALLBACK
+
+struct GG_MMU_s;
+typedef struct GG_MMU_s GG_MMU;
 typedef GG_MMU *GG_MMU_ptr;
 
+/* Handlers for an MMIO register (FF00 to FF7F). Reads and writes of the
+ * register go to these instead, and they can use GG_GetMMUIO and
+ * GG_SetMMUIO to get at the register itself. Reads also get the MMU as
+ * writable, so that a handler can bring its registers up to date first.
+ */
+typedef GG_MMU_CALLBACK(unsigned, GG_MMU_IORead)(void *arg,
+    GG_MMU *mmu,
+    unsigned address);
+typedef GG_MMU_CALLBACK(void, GG_MMU_IOWrite)(void *arg,
+    GG_MMU *mmu,
+    unsigned address,
+    unsigned value);
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -48,8 +63,60 @@ GG_MMU_FUNC(GG_MMU_ptr) GG_InitMMU(GG_MMU *);
 /* Finalizes an MMU struct. */
 GG_MMU_FUNC(GG_MMU_ptr) GG_FiniMMU(GG_MMU *);
 
+/* Maps the ROM, and sets up the mapper (MBC1, MBC3, or MBC5) and the
+ * cartridge RAM from the header. Anything else only gets the first 32KB.
+ * The ROM is not copied, so it must stay valid until the MMU is finalized
+ * or given another ROM. A read-only mapping of the file is fine.
+ */
 GG_MMU_FUNC(void) GG_SetMMURom(GG_MMU *, const void *rom, unsigned len);
 
+/* The page tables used by the JIT, 16 entries for reads and then 16 for
+ * writes. Entry N is the memory mapped at page N less N * 0x1000, so
+ * [address >> 12][address] is the byte at address. Entries change with bank
+ * switches. Page F (the end of echo RAM, OAM, MMIO, and HRAM) is always NULL,
+ * and needs to use GG_Read8MMU or GG_Write8MMU. Writes are also NULL wherever
+ * GG_MMU_WRITE_PAGE is.
+ */
+GG_MMU_FUNC(const unsigned char *const *) GG_GetMMUPages(const GG_MMU *mmu);
+
+#define GG_MMU_VRAM_TILES 384
+
+/* One byte for each tile in VRAM (8000 to 97FF), which is set to non-zero
+ * when any write goes to the tile. They all start out set. The GPU clears
+ * them once it has decoded the tile again.
+ */
+GG_MMU_FUNC(unsigned char *) GG_GetMMUDirtyTiles(GG_MMU *mmu);
+
+/* The ROM bank mapped at the address, or zero for anything that isn't ROM */
+GG_MMU_FUNC(unsigned) GG_GetMMUBank(const GG_MMU *mmu, unsigned address);
+
+/* Non-zero if the bank mapped at the address can never be switched */
+GG_MMU_FUNC(int) GG_IsMMUBankFixed(const GG_MMU *mmu, unsigned address);
+
+/* The byte at the address in a ROM bank, numbered as in GG_GetMMUBank, even if
+ * that bank is not mapped right now. Anything that isn't ROM reads the same as
+ * GG_Read8MMU.
+ */
+GG_MMU_FUNC(unsigned) GG_ReadBankMMU(const GG_MMU *mmu,
+    unsigned bank,
+    unsigned address);
+
+/* Sets the handlers for an MMIO register. Either one can be NULL to use the
+ * register as plain memory, which is how they all start except for DMA.
+ */
+GG_MMU_FUNC(void) GG_SetMMUIOHandler(GG_MMU *mmu,
+    unsigned address,
+    GG_MMU_IORead read,
+    GG_MMU_IOWrite write,
+    void *arg);
+
+/* Non-zero if the MMIO register has a read or write handler */
+GG_MMU_FUNC(int) GG_HasMMUIOHandler(const GG_MMU *mmu, unsigned address);
+
+/* An MMIO register itself, without going through its handlers */
+GG_MMU_FUNC(unsigned) GG_GetMMUIO(const GG_MMU *mmu, unsigned address);
+GG_MMU_FUNC(void) GG_SetMMUIO(GG_MMU *mmu, unsigned address, unsigned val);
+
 GG_MMU_FUNC(unsigned) GG_Read8MMU(const GG_MMU *mmu, unsigned i);
 GG_MMU_FUNC(unsigned) GG_Read16MMU(const GG_MMU *mmu, unsigned i);
 
@@ -59,4 +126,83 @@ GG_MMU_FUNC(unsigned) GG_Dec8MMU(GG_MMU *mmu, unsigned i);
 GG_MMU_FUNC(void) GG_Write8MMU(GG_MMU *mmu, unsigned i, unsigned val);
 GG_MMU_FUNC(void) GG_Write16MMU(GG_MMU *mmu, unsigned i, unsigned val);
 
+/* A 16-bit value in memory, little endian. x86 can do this unaligned. */
+#if (defined __i386) || (defined _M_IX86) || (defined __x86_64__)
+
+#define GG_WRITE16(TO, VAL) do{ \
+        ((unsigned short*)(TO))[0] = (unsigned short)(VAL); \
+    } while(0)
+
+#define GG_READ16(FRM) (0+(*((const unsigned short*)(FRM))))
+
+#else
+
+#define GG_WRITE16(TO, VAL) do{ \
+        ((unsigned char*)(TO))[0] = (unsigned char)(VAL); \
+        ((unsigned char*)(TO))[1] = (unsigned char)((VAL) >> 8); \
+    } while(0)
+
+#define GG_READ16(FRM) ( \
+        ((const unsigned char*)(FRM))[0] | \
+        (((const unsigned char*)(FRM))[1] << 8) \
+    )
+
+#endif
+
+/* The MMU starts with its page tables, 16 read pages and then 16 write
+ * pages, and then the two ROM banks that are mapped. This is the same on
+ * every compiler. This lets cpu.c access plain memory and check the bank
+ * without a call, and only call into the MMU for page F (OAM, MMIO, and
+ * HRAM), the mapper, and writes to VRAM.
+ * These evaluate their arguments more than once.
+ */
+#ifndef GG_NO_MMU_MACROS
+
+#define GG_MMU_READ_PAGE(MMU, I) \
+    (((const unsigned char *const *)(const void *)(MMU))[((I) >> 12) & 0xF])
+#define GG_MMU_WRITE_PAGE(MMU, I) \
+    (((unsigned char *const *)(const void *)(MMU))[16 + (((I) >> 12) & 0xF)])
+
+/* Same as GG_GetMMUBank */
+#define GG_GETMMUBANK(MMU, I) (((I) & 0x8000) ? 0u : (unsigned) \
+    ((const unsigned short *)(const void *) \
+        ((const unsigned char *const *)(const void *)(MMU) + 32)) \
+        [((I) >> 14) & 1])
+
+#define GG_READ8MMU(MMU, I) ((GG_MMU_READ_PAGE((MMU), (I)) != NULL) ? \
+    (unsigned)GG_MMU_READ_PAGE((MMU), (I))[(I) & 0xFFF] : \
+    GG_Read8MMU((MMU), (I)))
+
+/* The last byte of a page always takes the call */
+#define GG_READ16MMU(MMU, I) \
+    ((GG_MMU_READ_PAGE((MMU), (I)) != NULL && ((I) & 0xFFF) != 0xFFF) ? \
+        (unsigned)GG_READ16(GG_MMU_READ_PAGE((MMU), (I)) + ((I) & 0xFFF)) : \
+        GG_Read16MMU((MMU), (I)))
+
+#define GG_WRITE8MMU(MMU, I, VAL) do{ \
+        unsigned char *const GG_page = GG_MMU_WRITE_PAGE((MMU), (I)); \
+        if(GG_page != NULL) \
+            GG_page[(I) & 0xFFF] = (unsigned char)(VAL); \
+        else \
+            GG_Write8MMU((MMU), (I), (VAL)); \
+    }while(0)
+
+#define GG_WRITE16MMU(MMU, I, VAL) do{ \
+        unsigned char *const GG_page = GG_MMU_WRITE_PAGE((MMU), (I)); \
+        if(GG_page != NULL && ((I) & 0xFFF) != 0xFFF) \
+            GG_WRITE16(GG_page + ((I) & 0xFFF), (VAL)); \
+        else \
+            GG_Write16MMU((MMU), (I), (VAL)); \
+    }while(0)
+
+#else
+
+#define GG_READ8MMU GG_Read8MMU
+#define GG_READ16MMU GG_Read16MMU
+#define GG_WRITE8MMU GG_Write8MMU
+#define GG_WRITE16MMU GG_Write16MMU
+#define GG_GETMMUBANK GG_GetMMUBank
+
+#endif
+
 #endif /* GG_MMU_H */
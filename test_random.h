@@ -0,0 +1,23 @@
+/* Copyright (c) 2019 Emily McDonough
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef GG_TEST_RANDOM_H
+#define GG_TEST_RANDOM_H
+#pragma once
+
+/* Random numbers for the test programs. The seed is fixed, so a failure
+ * happens the same way every run.
+ */
+static unsigned long gg_test_seed = 1;
+
+/* Returns 16 random bits */
+static unsigned gg_test_random(void){
+    gg_test_seed = (gg_test_seed * 1103515245UL + 12345UL) & 0xFFFFFFFFUL;
+    return (unsigned)(gg_test_seed >> 16) & 0xFFFF;
+}
+
+#endif /* GG_TEST_RANDOM_H */